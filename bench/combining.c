@@ -0,0 +1,117 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "ticket_lock.h"
+#include "fc.h"
+
+#define DEFAULT_THREADS_PER_CPU 2
+#define DEFAULT_OPS 200000L // Operations per thread.
+#define WORK_ITERATIONS 50 // Busy work between operations.
+#define TABLE_SIZE 256 // Counters the operation updates, so it touches more than one line.
+
+/*
+ * Contended throughput of flat combining against a plain lock: every thread repeatedly
+ * runs a short operation on a shared table, then does a little work of its own. With the
+ * ticket lock each operation moves the lock and the table to the caller's cache; with
+ * fc_execute the combiner runs the pending operations of every thread in one pass.
+ */
+
+typedef struct {
+    long counts[TABLE_SIZE];
+    long total;
+} table;
+
+static ticket_lock lock;
+static fc_lock fc;
+static table shared; // Protected by the lock under test.
+static int use_fc; // fc_execute rather than the ticket lock.
+static long ops_per_thread;
+
+/**
+ * A short, non-optimizable delay.
+ */
+static void busy_work(void) {
+    for (volatile int i = 0; i < WORK_ITERATIONS; i++) {
+    }
+}
+
+/**
+ * The operation: bumps one counter of the table and the total.
+ */
+static void* table_add(void* ctx, void* arg) {
+    table* t = ctx;
+    t->counts[(long)arg % TABLE_SIZE]++;
+    t->total++;
+    return NULL;
+}
+
+/**
+ * Benchmark thread.
+ */
+static void* worker(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 0; i < ops_per_thread; i++) {
+        void* key = (void*)(id * 31 + i);
+        if (use_fc) {
+            fc_execute(&fc, table_add, key);
+        } else {
+            ticketlock_acquire(&lock);
+            table_add(&shared, key);
+            ticketlock_release(&lock);
+        }
+        busy_work();
+    }
+    if (use_fc) {
+        fc_thread_exit(&fc);
+    }
+    return NULL;
+}
+
+/**
+ * Runs one configuration and prints its throughput.
+ */
+static void run(const char* name, int threads) {
+    pthread_t* tids = malloc(sizeof(pthread_t) * threads);
+    long* ids = malloc(sizeof(long) * threads);
+    struct timespec start, end;
+    shared.total = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++) {
+        ids[i] = i;
+        pthread_create(&tids[i], NULL, worker, &ids[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(tids);
+    free(ids);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%-8s %3d threads: %8.3f s, %10.0f ops/s%s\n", name, threads, elapsed, shared.total / elapsed,
+           shared.total == ops_per_thread * threads ? "" : " (COUNT MISMATCH)");
+}
+
+int main(int argc, char* argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = argc > 1 ? atoi(argv[1]) : (int)(cpus * DEFAULT_THREADS_PER_CPU);
+    ops_per_thread = argc > 2 ? atol(argv[2]) : DEFAULT_OPS;
+    if (threads > FC_MAX_RECORDS) {
+        printf("at most %d threads\n", FC_MAX_RECORDS);
+        exit(1);
+    }
+    printf("%ld online CPUs, %d threads, %ld ops per thread\n", cpus, threads, ops_per_thread);
+
+    ticketlock_init(&lock);
+    use_fc = 0;
+    run("ticket", threads);
+
+    fc_init(&fc, &shared);
+    use_fc = 1;
+    run("fc", threads);
+    long passes, combined;
+    fc_stats(&fc, &passes, &combined);
+    printf("fc: %ld passes, %.2f operations per pass\n", passes, passes ? (double)combined / passes : 0.0);
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "executor.h"
+#include "local_storage.h"
+
+#define DEFAULT_TASKS 20000L // Tasks per configuration.
+#define BATCH 64 // Tasks in flight per batch in the throughput runs.
+#define TASK_ITERATIONS 200 // Busy work per task.
+
+/*
+ * Thread-per-task versus the executor: the latency of one task run and awaited at a
+ * time, and the throughput of batches of BATCH tasks in flight.
+ */
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void report(const char* name, long long start, long tasks) {
+    long long elapsed = now_ns() - start;
+    printf("%-36s %10.0f ns/task, %10.0f tasks/s\n", name, (double)elapsed / tasks, tasks * 1e9 / elapsed);
+}
+
+/**
+ * The benchmark task: a short, non-optimizable delay.
+ */
+static void* task(void* arg) {
+    for (volatile int i = 0; i < TASK_ITERATIONS; i++) {
+    }
+    return arg;
+}
+
+int main(int argc, char* argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = argc > 1 ? atoi(argv[1]) : (int)cpus;
+    long tasks = argc > 2 ? atol(argv[2]) : DEFAULT_TASKS;
+    tasks -= tasks % BATCH;
+    printf("%ld online CPUs, %d workers, %ld tasks\n", cpus, workers, tasks);
+    init_storage();
+
+    long long start = now_ns();
+    for (long i = 0; i < tasks; i++) {
+        pthread_t tid;
+        pthread_create(&tid, NULL, task, NULL);
+        pthread_join(tid, NULL);
+    }
+    report("thread per task, one at a time", start, tasks);
+
+    pthread_t tids[BATCH];
+    start = now_ns();
+    for (long i = 0; i < tasks; i += BATCH) {
+        for (int j = 0; j < BATCH; j++) {
+            pthread_create(&tids[j], NULL, task, NULL);
+        }
+        for (int j = 0; j < BATCH; j++) {
+            pthread_join(tids[j], NULL);
+        }
+    }
+    report("thread per task, batches", start, tasks);
+
+    executor ex;
+    executor_init(&ex, workers);
+    executor_future futures[BATCH];
+    start = now_ns();
+    for (long i = 0; i < tasks; i++) {
+        executor_submit(&ex, &futures[0], task, NULL);
+        executor_future_wait(&futures[0]);
+    }
+    report("executor, one at a time", start, tasks);
+
+    start = now_ns();
+    for (long i = 0; i < tasks; i += BATCH) {
+        for (int j = 0; j < BATCH; j++) {
+            executor_submit(&ex, &futures[j], task, NULL);
+        }
+        for (int j = 0; j < BATCH; j++) {
+            executor_future_wait(&futures[j]);
+        }
+    }
+    report("executor, batches", start, tasks);
+
+    long executed, stolen, inline_runs;
+    executor_stats(&ex, &executed, &stolen, &inline_runs);
+    executor_shutdown(&ex);
+    printf("executor: %ld executed, %ld stolen, %ld run inline\n", executed, stolen, inline_runs);
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "ticket_lock.h"
+#include "tp_lock.h"
+#include "reactive_lock.h"
+
+#define DEFAULT_OVERSUBSCRIPTION 4 // Threads per online CPU.
+#define DEFAULT_OPS 200000L // Critical sections per thread.
+#define WORK_ITERATIONS 50 // Busy work inside and outside the critical section.
+
+#define BENCH_TICKET 0
+#define BENCH_TP 1
+#define BENCH_REACTIVE 2
+
+/*
+ * Lock throughput with more threads than CPUs: every thread repeatedly takes the lock,
+ * does a little work, releases it and does a little more work outside.
+ * Compares the FIFO ticket lock with the time-published and the reactive lock.
+ */
+
+static ticket_lock ticket;
+static tp_lock tp;
+static reactive_lock reactive;
+static int lock_kind; // Lock under test.
+static long ops_per_thread;
+static volatile long shared_counter; // Protected by the lock under test.
+
+/**
+ * A short, non-optimizable delay.
+ */
+static void busy_work(void) {
+    for (volatile int i = 0; i < WORK_ITERATIONS; i++) {
+    }
+}
+
+/**
+ * Benchmark thread.
+ */
+static void* worker(void* arg) {
+    (void)arg;
+    for (long i = 0; i < ops_per_thread; i++) {
+        if (lock_kind == BENCH_TP) {
+            tp_lock_acquire(&tp);
+        } else if (lock_kind == BENCH_REACTIVE) {
+            reactive_lock_acquire(&reactive);
+        } else {
+            ticketlock_acquire(&ticket);
+        }
+        shared_counter++;
+        busy_work();
+        if (lock_kind == BENCH_TP) {
+            tp_lock_release(&tp);
+        } else if (lock_kind == BENCH_REACTIVE) {
+            reactive_lock_release(&reactive);
+        } else {
+            ticketlock_release(&ticket);
+        }
+        busy_work();
+    }
+    return NULL;
+}
+
+/**
+ * Runs one configuration and prints its throughput.
+ * @return Elapsed seconds.
+ */
+static double run(const char* name, int threads) {
+    pthread_t* tids = malloc(sizeof(pthread_t) * threads);
+    struct timespec start, end;
+    shared_counter = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tids[i], NULL, worker, NULL);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(tids);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%-8s %3d threads: %8.3f s, %10.0f ops/s%s\n", name, threads, elapsed, shared_counter / elapsed,
+           shared_counter == ops_per_thread * threads ? "" : " (COUNT MISMATCH)");
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = argc > 1 ? atoi(argv[1]) : (int)(cpus * DEFAULT_OVERSUBSCRIPTION);
+    ops_per_thread = argc > 2 ? atol(argv[2]) : DEFAULT_OPS;
+    long patience = argc > 3 ? atol(argv[3]) : 0;
+    printf("%ld online CPUs, %d threads, %ld ops per thread\n", cpus, threads, ops_per_thread);
+
+    ticketlock_init(&ticket);
+    lock_kind = BENCH_TICKET;
+    run("ticket", threads);
+
+    tp_lock_init(&tp, patience);
+    lock_kind = BENCH_TP;
+    run("tp", threads);
+    long acquisitions, handoffs, skips, rejoins;
+    tp_lock_stats(&tp, &acquisitions, &handoffs, &skips, &rejoins);
+    printf("tp: %ld acquisitions, %ld handoffs, %ld skips, %ld rejoins\n", acquisitions, handoffs, skips, rejoins);
+
+    reactive_lock_init(&reactive);
+    lock_kind = BENCH_REACTIVE;
+    run("reactive", threads);
+    long tas_acquires, queue_acquires, switches;
+    reactive_lock_stats(&reactive, &tas_acquires, &queue_acquires, &switches);
+    printf("reactive: %ld TAS acquisitions, %ld queue acquisitions, %ld mode switches\n",
+           tas_acquires, queue_acquires, switches);
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "token_semaphore.h"
+#ifdef BENCH_TAS_SEMAPHORE
+#include "tas_semaphore.h"
+#define SEMAPHORE_NAME "tas"
+#else
+#include "tl_semaphore.h"
+#define SEMAPHORE_NAME "tl"
+#endif
+
+#define DEFAULT_THREADS_PER_CPU 2
+#define DEFAULT_OPS 200000L // Permits taken per thread.
+#define DEFAULT_PERMITS 4
+#define WORK_ITERATIONS 50 // Busy work while holding a permit and between permits.
+
+/*
+ * Semaphore throughput with many threads sharing a few permits (connection-pool style):
+ * every thread takes a permit, works, returns it and works some more. Built once with the
+ * task1 (TAS) and once with the task2 (ticket) semaphore, each run against the
+ * token_semaphore. The task2 semaphore admits one ticket at a time whatever its value,
+ * so it runs the same loop as a mutex; the peak holders column shows it.
+ */
+
+static token_semaphore token;
+static semaphore task_sem;
+static int use_token; // token_semaphore rather than the task semaphore.
+static long ops_per_thread;
+static atomic_int holders; // Threads holding a permit right now.
+static atomic_int most_holders; // Most holders seen at once.
+
+/**
+ * A short, non-optimizable delay.
+ */
+static void busy_work(void) {
+    for (volatile int i = 0; i < WORK_ITERATIONS; i++) {
+    }
+}
+
+/**
+ * Benchmark thread.
+ */
+static void* worker(void* arg) {
+    (void)arg;
+    for (long i = 0; i < ops_per_thread; i++) {
+        if (use_token) {
+            token_semaphore_wait(&token);
+        } else {
+            semaphore_wait(&task_sem);
+        }
+        int now = atomic_fetch_add_explicit(&holders, 1, memory_order_relaxed) + 1;
+        int most = atomic_load_explicit(&most_holders, memory_order_relaxed);
+        while (now > most && !atomic_compare_exchange_weak_explicit(&most_holders, &most, now, memory_order_relaxed,
+                                                                    memory_order_relaxed)) {
+        }
+        busy_work();
+        atomic_fetch_sub_explicit(&holders, 1, memory_order_relaxed);
+        if (use_token) {
+            token_semaphore_signal(&token);
+        } else {
+            semaphore_signal(&task_sem);
+        }
+        busy_work();
+    }
+    return NULL;
+}
+
+/**
+ * Runs one configuration and prints its throughput.
+ */
+static void run(const char* name, int threads) {
+    pthread_t* tids = malloc(sizeof(pthread_t) * threads);
+    struct timespec start, end;
+    atomic_store(&most_holders, 0);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tids[i], NULL, worker, NULL);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(tids);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%-6s %3d threads: %8.3f s, %10.0f ops/s, peak holders %d\n", name, threads, elapsed,
+           ops_per_thread * threads / elapsed, atomic_load(&most_holders));
+}
+
+int main(int argc, char* argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = argc > 1 ? atoi(argv[1]) : (int)(cpus * DEFAULT_THREADS_PER_CPU);
+    ops_per_thread = argc > 2 ? atol(argv[2]) : DEFAULT_OPS;
+    int permits = argc > 3 ? atoi(argv[3]) : DEFAULT_PERMITS;
+    printf("%ld online CPUs, %d threads, %ld ops per thread, %d permits\n", cpus, threads, ops_per_thread, permits);
+
+    semaphore_init(&task_sem, permits);
+    use_token = 0;
+    run(SEMAPHORE_NAME, threads);
+    semaphore_destroy(&task_sem);
+
+    token_semaphore_init(&token, permits, 0);
+    use_token = 1;
+    run("token", threads);
+    long refills, flushes, steals;
+    token_semaphore_stats(&token, &refills, &flushes, &steals);
+    printf("token: %ld refills, %ld flushes, %ld steals\n", refills, flushes, steals);
+    return 0;
+}
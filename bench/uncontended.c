@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ticket_lock.h"
+#include "tl_semaphore.h"
+#include "cond_var.h"
+#include "rw_lock.h"
+#include "latch.h"
+#include "fc.h"
+#include "reactive_lock.h"
+#include "sharded_counter.h"
+#include "token_semaphore.h"
+#include "eventcount.h"
+
+#define DEFAULT_ITERATIONS 10000000L
+
+/*
+ * Single-threaded timings of the uncontended paths of each primitive.
+ * Every operation pair runs 'iterations' times; results are in nanoseconds per pair.
+ */
+
+static long counter; // Touched inside the critical sections so they aren't empty.
+
+/**
+ * Returns CLOCK_MONOTONIC in nanoseconds.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Prints one result line.
+ */
+static void report(const char* name, long long start, long iterations) {
+    printf("%-32s %8.2f ns/op\n", name, (double)(now_ns() - start) / iterations);
+}
+
+/**
+ * Trivial combined operation for the fc_lock benchmark.
+ */
+static void* fc_increment(void* ctx, void* arg) {
+    (void)arg;
+    (*(long*)ctx)++;
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    long long start;
+
+    ticket_lock lock;
+    ticketlock_init(&lock);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        ticketlock_acquire(&lock);
+        counter++;
+        ticketlock_release(&lock);
+    }
+    report("ticketlock acquire/release", start, iterations);
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        if (ticketlock_try_acquire(&lock)) {
+            counter++;
+            ticketlock_release(&lock);
+        }
+    }
+    report("ticketlock try_acquire/release", start, iterations);
+
+    reactive_lock reactive;
+    reactive_lock_init(&reactive);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        reactive_lock_acquire(&reactive);
+        counter++;
+        reactive_lock_release(&reactive);
+    }
+    report("reactive acquire/release", start, iterations);
+
+    semaphore sem;
+    semaphore_init(&sem, 1);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        semaphore_wait(&sem);
+        counter++;
+        semaphore_signal(&sem);
+    }
+    report("semaphore wait/signal", start, iterations);
+    semaphore_destroy(&sem);
+
+    rwlock rw;
+    rwlock_init(&rw);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        rwlock_acquire_read(&rw);
+        counter++;
+        rwlock_release_read(&rw);
+    }
+    report("rwlock read acquire/release", start, iterations);
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        rwlock_acquire_write(&rw);
+        counter++;
+        rwlock_release_write(&rw);
+    }
+    report("rwlock write acquire/release", start, iterations);
+    rwlock_destroy(&rw);
+
+    condition_variable cv;
+    condition_variable_init(&cv);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        ticketlock_acquire(&lock);
+        condition_variable_signal(&cv); // Nobody waits.
+        ticketlock_release(&lock);
+    }
+    report("lock + signal (no waiters)", start, iterations);
+    condition_variable_destroy(&cv);
+
+    eventcount ec;
+    eventcount_init(&ec);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        counter++;
+        eventcount_notify_one(&ec); // Nobody waits.
+    }
+    report("eventcount notify (no waiters)", start, iterations);
+
+    latch done;
+    latch_init(&done, 1);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        counter += latch_try_wait(&done);
+    }
+    report("latch_try_wait", start, iterations);
+
+    static fc_lock fc;
+    long fc_counter = 0;
+    fc_init(&fc, &fc_counter);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        fc_execute(&fc, fc_increment, NULL);
+    }
+    report("fc_execute", start, iterations);
+    fc_thread_exit(&fc);
+
+    static sharded_counter sharded;
+    sharded_counter_init(&sharded);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        sharded_counter_add(&sharded, 1);
+    }
+    report("sharded_counter_add", start, iterations);
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        counter += sharded_counter_reached(&sharded, 2 * iterations);
+    }
+    report("sharded_counter_reached", start, iterations);
+
+    static token_semaphore tokens;
+    token_semaphore_init(&tokens, 1024, 0);
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        token_semaphore_wait(&tokens);
+        counter++;
+        token_semaphore_signal(&tokens);
+    }
+    report("token_semaphore wait/signal", start, iterations);
+
+    printf("(checksum %ld)\n", counter + fc_counter + sharded_counter_sum(&sharded));
+    return 0;
+}
@@ -0,0 +1,297 @@
+#include "ebr.h"
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Returns CLOCK_MONOTONIC in nanoseconds.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Raises a statistics maximum.
+ * @param max The maximum.
+ * @param value The candidate.
+ */
+static void raise_max(atomic_llong* max, long long value) {
+    long long seen = atomic_load_explicit(max, memory_order_relaxed);
+    while (value > seen && !atomic_compare_exchange_weak_explicit(max, &seen, value, memory_order_relaxed,
+                                                                  memory_order_relaxed)) {
+        // 'seen' was reloaded.
+    }
+}
+
+/**
+ * Appends an entry to a growable array of retired objects.
+ * @param list In/out: the array.
+ * @param count In/out: used entries.
+ * @param capacity In/out: allocated entries.
+ * @param r The entry.
+ */
+static void append(ebr_retired** list, int* count, int* capacity, ebr_retired r) {
+    if (*count == *capacity) {
+        *capacity = *capacity > 0 ? *capacity * 2 : EBR_DEFAULT_BATCH;
+        *list = realloc(*list, sizeof(ebr_retired) * *capacity);
+    }
+    (*list)[(*count)++] = r;
+}
+
+/**
+ * Initializes a reclamation domain.
+ * @param domain The domain.
+ * @param mode EBR_EPOCH or EBR_INTERVAL.
+ * @param batch Retirements between scans (<= 0 for EBR_DEFAULT_BATCH).
+ * @param object_size Bytes per object, for ebr_stats.
+ * @param free_fn Frees a reclaimed object.
+ */
+void ebr_init(ebr_domain* domain, int mode, int batch, size_t object_size, ebr_free_fn free_fn) {
+    atomic_init(&domain->epoch, 1);
+    domain->mode = mode;
+    domain->batch = batch > 0 ? batch : EBR_DEFAULT_BATCH;
+    domain->object_size = object_size;
+    domain->free_fn = free_fn;
+    for (int i = 0; i < MAX_THREADS; i++) {
+        atomic_init(&domain->slots[i].lower, EBR_IDLE);
+        atomic_init(&domain->slots[i].upper, 0);
+    }
+    atomic_init(&domain->used, 0);
+    ticketlock_init(&domain->orphan_lock);
+    domain->orphans = NULL;
+    domain->orphan_count = 0;
+    domain->orphan_capacity = 0;
+    atomic_init(&domain->has_orphans, 0);
+    atomic_init(&domain->retired, 0);
+    atomic_init(&domain->freed, 0);
+    atomic_init(&domain->scans, 0);
+    atomic_init(&domain->deferred, 0);
+    atomic_init(&domain->peak_deferred, 0);
+    atomic_init(&domain->latency_total_ns, 0);
+    atomic_init(&domain->latency_max_ns, 0);
+}
+
+/**
+ * Frees the orphans. No thread may be registered any more.
+ * @param domain The domain.
+ */
+void ebr_destroy(ebr_domain* domain) {
+    long long now = now_ns();
+    long long latency_max = 0;
+    for (int i = 0; i < domain->orphan_count; i++) {
+        domain->free_fn(NULL, domain->orphans[i].ptr);
+        long long latency = now - domain->orphans[i].retired_ns;
+        atomic_fetch_add_explicit(&domain->latency_total_ns, latency, memory_order_relaxed);
+        latency_max = latency > latency_max ? latency : latency_max;
+    }
+    raise_max(&domain->latency_max_ns, latency_max);
+    atomic_fetch_add_explicit(&domain->freed, domain->orphan_count, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&domain->deferred, domain->orphan_count, memory_order_relaxed);
+    free(domain->orphans);
+    domain->orphans = NULL;
+    domain->orphan_count = 0;
+    domain->orphan_capacity = 0;
+}
+
+/**
+ * Registers the calling thread in the domain, in the slot of its task5 TLS entry.
+ * @param domain The domain.
+ * @param t The thread's handle.
+ * @param free_ctx Passed to the free function for objects this thread reclaims.
+ */
+void ebr_thread_register(ebr_domain* domain, ebr_thread* t, void* free_ctx) {
+    tls_thread_alloc(); // No-op if the thread already has an entry.
+    int index = tls_thread_index();
+    t->domain = domain;
+    t->slot = &domain->slots[index];
+    t->free_ctx = free_ctx;
+    t->retired = NULL;
+    t->count = 0;
+    t->capacity = 0;
+    t->since_scan = 0;
+    t->allocs = 0;
+    atomic_store_explicit(&t->slot->lower, EBR_IDLE, memory_order_relaxed);
+    int used = atomic_load_explicit(&domain->used, memory_order_relaxed);
+    while (used <= index && !atomic_compare_exchange_weak_explicit(&domain->used, &used, index + 1,
+                                                                   memory_order_seq_cst, memory_order_relaxed)) {
+        // 'used' was reloaded.
+    }
+}
+
+/**
+ * Checks whether any announcement overlaps a retired object.
+ * @param lowers Snapshot of the announced lower epochs of active threads.
+ * @param uppers Their upper epochs.
+ * @param n Active threads in the snapshot.
+ * @param r The object.
+ * @return 1 if some thread may still hold it.
+ */
+static int reserved(const uint64_t* lowers, const uint64_t* uppers, int n, const ebr_retired* r) {
+    for (int i = 0; i < n; i++) {
+        if (r->retire >= lowers[i] && r->birth <= uppers[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Adopts the orphans, if there are any and nobody else is adopting them.
+ * @param t The adopting thread.
+ */
+static void adopt_orphans(ebr_thread* t) {
+    ebr_domain* domain = t->domain;
+    if (!atomic_load_explicit(&domain->has_orphans, memory_order_relaxed)
+        || !ticketlock_try_acquire(&domain->orphan_lock)) {
+        return;
+    }
+    for (int i = 0; i < domain->orphan_count; i++) {
+        append(&t->retired, &t->count, &t->capacity, domain->orphans[i]);
+    }
+    domain->orphan_count = 0;
+    atomic_store_explicit(&domain->has_orphans, 0, memory_order_relaxed);
+    ticketlock_release(&domain->orphan_lock);
+}
+
+/**
+ * Frees every object of the thread's deferred list that no announcement overlaps.
+ * In EBR_EPOCH mode the birth epochs are 0, so only the lower bounds matter.
+ * @param t The thread.
+ */
+static void scan(ebr_thread* t) {
+    ebr_domain* domain = t->domain;
+    uint64_t lowers[MAX_THREADS];
+    uint64_t uppers[MAX_THREADS];
+    int n = 0;
+    adopt_orphans(t);
+    t->since_scan = 0;
+    if (t->count == 0) {
+        return;
+    }
+    int used = atomic_load_explicit(&domain->used, memory_order_seq_cst);
+    for (int i = 0; i < used; i++) {
+        uint64_t lower = atomic_load_explicit(&domain->slots[i].lower, memory_order_seq_cst);
+        if (lower != EBR_IDLE) {
+            lowers[n] = lower;
+            uppers[n] = domain->mode == EBR_INTERVAL
+                ? atomic_load_explicit(&domain->slots[i].upper, memory_order_seq_cst) : EBR_IDLE;
+            n++;
+        }
+    }
+    long long now = now_ns();
+    long long latency_total = 0;
+    long long latency_max = 0;
+    int kept = 0;
+    for (int i = 0; i < t->count; i++) {
+        ebr_retired* r = &t->retired[i];
+        if (reserved(lowers, uppers, n, r)) {
+            t->retired[kept++] = *r;
+            continue;
+        }
+        domain->free_fn(t->free_ctx, r->ptr);
+        long long latency = now - r->retired_ns;
+        latency_total += latency;
+        latency_max = latency > latency_max ? latency : latency_max;
+    }
+    int freed = t->count - kept;
+    t->count = kept;
+    atomic_fetch_add_explicit(&domain->scans, 1, memory_order_relaxed);
+    if (freed > 0) {
+        atomic_fetch_add_explicit(&domain->freed, freed, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&domain->deferred, freed, memory_order_relaxed);
+        atomic_fetch_add_explicit(&domain->latency_total_ns, latency_total, memory_order_relaxed);
+        raise_max(&domain->latency_max_ns, latency_max);
+    }
+}
+
+/**
+ * Unregisters the calling thread. What is still reserved goes to the orphans.
+ * @param t The thread's handle.
+ */
+void ebr_thread_unregister(ebr_thread* t) {
+    ebr_domain* domain = t->domain;
+    atomic_store_explicit(&t->slot->lower, EBR_IDLE, memory_order_release);
+    atomic_fetch_add_explicit(&domain->epoch, 1, memory_order_seq_cst); // Let our latest retirements age.
+    scan(t);
+    if (t->count > 0) {
+        ticketlock_acquire(&domain->orphan_lock);
+        for (int i = 0; i < t->count; i++) {
+            append(&domain->orphans, &domain->orphan_count, &domain->orphan_capacity, t->retired[i]);
+        }
+        atomic_store_explicit(&domain->has_orphans, 1, memory_order_relaxed);
+        ticketlock_release(&domain->orphan_lock);
+    }
+    free(t->retired);
+    t->retired = NULL;
+    t->count = 0;
+    t->capacity = 0;
+}
+
+/**
+ * Allocation hook: returns the birth epoch; every EBR_EPOCH_FREQ calls advances the
+ * epoch and scans, so reclamation runs in step with allocation.
+ * @param t The thread's handle.
+ * @return The epoch to record as the object's birth.
+ */
+uint64_t ebr_alloc(ebr_thread* t) {
+    if (++t->allocs >= EBR_EPOCH_FREQ) {
+        t->allocs = 0;
+        atomic_fetch_add_explicit(&t->domain->epoch, 1, memory_order_seq_cst);
+        if (t->count > 0) {
+            scan(t);
+        }
+    }
+    return atomic_load_explicit(&t->domain->epoch, memory_order_acquire);
+}
+
+/**
+ * Defers freeing an unlinked object; every 'batch' retirements scans the deferred list.
+ * @param t The thread's handle.
+ * @param ptr The object.
+ * @param birth Its birth epoch from ebr_alloc (ignored in EBR_EPOCH mode).
+ */
+void ebr_retire(ebr_thread* t, void* ptr, uint64_t birth) {
+    ebr_domain* domain = t->domain;
+    ebr_retired r;
+    r.ptr = ptr;
+    r.birth = domain->mode == EBR_INTERVAL ? birth : 0;
+    r.retire = atomic_load_explicit(&domain->epoch, memory_order_seq_cst); // After the unlink.
+    r.retired_ns = now_ns();
+    append(&t->retired, &t->count, &t->capacity, r);
+    atomic_fetch_add_explicit(&domain->retired, 1, memory_order_relaxed);
+    raise_max(&domain->peak_deferred, atomic_fetch_add_explicit(&domain->deferred, 1, memory_order_relaxed) + 1);
+    if (++t->since_scan >= domain->batch) {
+        scan(t);
+    }
+}
+
+/**
+ * Scans the deferred list ahead of its batch, after moving the epoch past its retirements.
+ * @param t The thread's handle.
+ */
+void ebr_flush(ebr_thread* t) {
+    if (t->count > 0) {
+        atomic_fetch_add_explicit(&t->domain->epoch, 1, memory_order_seq_cst);
+        scan(t);
+    }
+}
+
+/**
+ * Reports the domain's statistics.
+ * @param domain The domain.
+ * @param retired Out: objects retired.
+ * @param freed Out: objects freed.
+ * @param peak_bytes Out: most memory deferred at once.
+ * @param mean_latency_ns Out: mean time from retirement to free (0 if nothing was freed).
+ * @param max_latency_ns Out: longest time from retirement to free.
+ */
+void ebr_stats(ebr_domain* domain, long* retired, long* freed, size_t* peak_bytes,
+               long long* mean_latency_ns, long long* max_latency_ns) {
+    *retired = atomic_load_explicit(&domain->retired, memory_order_relaxed);
+    *freed = atomic_load_explicit(&domain->freed, memory_order_relaxed);
+    *peak_bytes = (size_t)atomic_load_explicit(&domain->peak_deferred, memory_order_relaxed) * domain->object_size;
+    long long total = atomic_load_explicit(&domain->latency_total_ns, memory_order_relaxed);
+    *mean_latency_ns = *freed > 0 ? total / *freed : 0;
+    *max_latency_ns = atomic_load_explicit(&domain->latency_max_ns, memory_order_relaxed);
+}
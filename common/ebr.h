@@ -0,0 +1,179 @@
+#ifndef EBR_H
+#define EBR_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "local_storage.h" // MAX_THREADS: one announcement slot per task5 TLS entry.
+#include "ticket_lock.h"
+
+#define EBR_EPOCH 0 // Classic epochs: a thread inside a critical section holds back every later retirement.
+#define EBR_INTERVAL 1 // Interval-based: a stalled thread only holds back objects born before its last read.
+#define EBR_IDLE UINT64_MAX // Slot 'lower' of a thread outside any critical section.
+#define EBR_DEFAULT_BATCH 64 // Retirements between scans of a thread's deferred list.
+#define EBR_EPOCH_FREQ 64 // Allocations per thread between epoch advances.
+
+/*
+ * Frees a reclaimed object. 'ctx' is the reclaiming thread's context given to
+ * ebr_thread_register (its allocator cache, say), or NULL from ebr_destroy.
+ */
+typedef void (*ebr_free_fn)(void* ctx, void* ptr);
+
+/*
+ * A retired object waiting for every reader that might still hold it.
+ */
+typedef struct {
+    void* ptr;
+    uint64_t birth; // Epoch it was allocated in (EBR_INTERVAL).
+    uint64_t retire; // Epoch it was unlinked in.
+    long long retired_ns; // When it was retired, for the latency statistics.
+} ebr_retired;
+
+/*
+ * A thread's announcement: the epochs of the pointers it may hold.
+ * One cache line each, so announcing never contends with other threads.
+ */
+typedef struct {
+    _Alignas(64) _Atomic uint64_t lower; // Epoch the current critical section began in, EBR_IDLE outside.
+    _Atomic uint64_t upper; // EBR_INTERVAL: epoch of its latest validated read.
+} ebr_slot;
+
+struct ebr_domain;
+
+/*
+ * Per-thread handle, owned by its thread like a node_cache. The deferred list is private.
+ */
+typedef struct {
+    struct ebr_domain* domain;
+    ebr_slot* slot; // This thread's announcement, indexed by its task5 TLS entry.
+    void* free_ctx; // Passed to the domain's free function.
+    ebr_retired* retired; // Deferred objects.
+    int count; // Used entries of 'retired'.
+    int capacity; // Allocated entries of 'retired'.
+    int since_scan; // Retirements since the last scan.
+    int allocs; // Allocations since this thread last advanced the epoch.
+} ebr_thread;
+
+/*
+ * Reclamation domain: the global epoch, one announcement slot per thread, and what
+ * departed threads left behind.
+ *
+ * A reader brackets its accesses with ebr_enter/ebr_exit; a writer that unlinked an
+ * object hands it to ebr_retire instead of freeing it. Objects are freed in batches by
+ * the retiring thread, once no announcement overlaps them: in EBR_EPOCH mode once every
+ * thread inside a critical section entered after the retirement; in EBR_INTERVAL mode
+ * (2GE-IBR) also when a thread's reads all predate the object's birth, so one stalled
+ * reader pins a bounded set of objects instead of everything retired after it stalled.
+ * Interval mode needs each shared pointer load to be followed by ebr_validate (and the
+ * load repeated until it succeeds) and the birth epoch of every object (ebr_alloc).
+ * Allocations drive the epoch, so reclamation keeps pace with allocation pressure.
+ *
+ * Memory ordering: announcements are seq_cst stores and the scan reads them with seq_cst
+ * loads after the retiring thread's seq_cst epoch read; the unlink itself must be a
+ * seq_cst store or RMW. Readers load shared pointers with seq_cst (plain loads on x86).
+ */
+typedef struct ebr_domain {
+    _Alignas(64) _Atomic uint64_t epoch;
+    int mode; // EBR_EPOCH or EBR_INTERVAL.
+    int batch; // Retirements between scans.
+    size_t object_size; // Bytes per object, for the deferred-memory statistics.
+    ebr_free_fn free_fn;
+    ebr_slot slots[MAX_THREADS];
+    atomic_int used; // Slots [0, used) may be announced.
+    ticket_lock orphan_lock; // Protects the orphans.
+    ebr_retired* orphans; // Left by threads that unregistered before their objects were free.
+    int orphan_count;
+    int orphan_capacity;
+    atomic_int has_orphans; // Lets scans skip orphan_lock.
+    atomic_long retired; // Statistics: objects retired.
+    atomic_long freed; // Statistics: objects freed.
+    atomic_long scans; // Statistics: scans of a deferred list.
+    atomic_long deferred; // Objects retired but not yet freed.
+    atomic_llong peak_deferred; // Statistics: highest 'deferred' seen.
+    atomic_llong latency_total_ns; // Statistics: summed retire-to-free time.
+    atomic_llong latency_max_ns; // Statistics: longest retire-to-free time.
+} ebr_domain;
+
+/*
+ * Initializes a domain whose reclaimed objects go to free_fn. 'batch' <= 0 means
+ * EBR_DEFAULT_BATCH; 'object_size' only scales the statistics.
+ */
+void ebr_init(ebr_domain* domain, int mode, int batch, size_t object_size, ebr_free_fn free_fn);
+
+/*
+ * Frees everything still deferred. Every thread must have unregistered.
+ */
+void ebr_destroy(ebr_domain* domain);
+
+/*
+ * Registers the calling thread, allocating its task5 TLS entry if it has none
+ * (init_storage() must have run). 'free_ctx' is passed to the free function.
+ */
+void ebr_thread_register(ebr_domain* domain, ebr_thread* t, void* free_ctx);
+
+/*
+ * Frees what it can of the thread's deferred list and leaves the rest to the domain.
+ * The thread's TLS entry stays allocated.
+ */
+void ebr_thread_unregister(ebr_thread* t);
+
+/*
+ * Starts a critical section: pointers read until ebr_exit stay valid.
+ */
+static inline void ebr_enter(ebr_thread* t) {
+    uint64_t e = atomic_load_explicit(&t->domain->epoch, memory_order_acquire);
+    atomic_store_explicit(&t->slot->upper, e, memory_order_relaxed); // Published by the store below.
+    atomic_store_explicit(&t->slot->lower, e, memory_order_seq_cst); // Before any shared pointer load.
+}
+
+/*
+ * Ends a critical section.
+ */
+static inline void ebr_exit(ebr_thread* t) {
+    atomic_store_explicit(&t->slot->lower, EBR_IDLE, memory_order_release); // After the last use of a pointer.
+}
+
+/*
+ * Called right after loading a shared pointer. Returns 1 if the pointer is protected;
+ * 0 if the epoch moved and the announcement was extended, in which case the load must
+ * be repeated (the loaded object may be newer than the old announcement).
+ * Always 1 in EBR_EPOCH mode.
+ */
+static inline int ebr_validate(ebr_thread* t) {
+    if (t->domain->mode != EBR_INTERVAL) {
+        return 1;
+    }
+    uint64_t e = atomic_load_explicit(&t->domain->epoch, memory_order_seq_cst);
+    if (e == atomic_load_explicit(&t->slot->upper, memory_order_relaxed)) {
+        return 1;
+    }
+    atomic_store_explicit(&t->slot->upper, e, memory_order_seq_cst); // Before the repeated load.
+    return 0;
+}
+
+/*
+ * Called for every object allocation: returns the birth epoch to pass to ebr_retire, and
+ * every EBR_EPOCH_FREQ allocations advances the epoch and scans the deferred list.
+ */
+uint64_t ebr_alloc(ebr_thread* t);
+
+/*
+ * Defers freeing an object that was just unlinked (with a seq_cst store or RMW).
+ * May free earlier retirements.
+ */
+void ebr_retire(ebr_thread* t, void* ptr, uint64_t birth);
+
+/*
+ * Advances the epoch and frees what it can of the thread's deferred list now, rather
+ * than at its next batch. For a thread about to go idle.
+ */
+void ebr_flush(ebr_thread* t);
+
+/*
+ * Reports objects retired and freed, the peak deferred memory in bytes, and the mean
+ * and longest time from retirement to free.
+ */
+void ebr_stats(ebr_domain* domain, long* retired, long* freed, size_t* peak_bytes,
+               long long* mean_latency_ns, long long* max_latency_ns);
+
+#endif // EBR_H
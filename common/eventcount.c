@@ -0,0 +1,99 @@
+#include "eventcount.h"
+#include "sync_wait.h" // Spin policy and futex wait/wake.
+
+/**
+ * Initializes the eventcount.
+ * @param ec Pointer to the eventcount.
+ */
+void eventcount_init(eventcount* ec) {
+    atomic_init(&ec->epoch, 0);
+    atomic_init(&ec->waiters, 0);
+    atomic_init(&ec->sleepers, 0);
+    atomic_init(&ec->sleeps, 0);
+    atomic_init(&ec->notifies, 0);
+}
+
+/**
+ * Announces a waiter. The key is read after the announcement, so a notify that misses
+ * the announcement also precedes the caller's recheck, which then sees the condition.
+ * @param ec Pointer to the eventcount.
+ * @return The epoch to pass to eventcount_commit_wait.
+ */
+int eventcount_prepare_wait(eventcount* ec) {
+    atomic_fetch_add_explicit(&ec->waiters, 1, memory_order_seq_cst); // Store half of the handshake.
+    return atomic_load_explicit(&ec->epoch, memory_order_seq_cst); // Must not move above the announcement.
+}
+
+/**
+ * Withdraws a waiter announced by eventcount_prepare_wait.
+ * @param ec Pointer to the eventcount.
+ */
+void eventcount_cancel_wait(eventcount* ec) {
+    atomic_fetch_sub_explicit(&ec->waiters, 1, memory_order_relaxed); // A stale count only costs a spare wake.
+}
+
+/**
+ * Spins per the sync_wait policy, then sleeps while the epoch still equals 'key'.
+ * @param ec Pointer to the eventcount.
+ * @param key The value eventcount_prepare_wait returned.
+ */
+void eventcount_commit_wait(eventcount* ec, int key) {
+    int budget = sync_backoff_budget(NULL);
+    for (int round = 0; round < budget; ) {
+        if (atomic_load_explicit(&ec->epoch, memory_order_acquire) != key) {
+            atomic_fetch_sub_explicit(&ec->waiters, 1, memory_order_relaxed);
+            return;
+        }
+        sync_backoff(&round, NULL);
+    }
+    // Announce before the kernel rechecks the epoch; pairs with sync_wake in notify.
+    atomic_fetch_add_explicit(&ec->sleepers, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&ec->epoch, memory_order_seq_cst) == key) {
+        atomic_fetch_add_explicit(&ec->sleeps, 1, memory_order_relaxed);
+        sync_futex_wait(&ec->epoch, key, SYNC_BITSET_ALL, SYNC_PRIVATE, NULL);
+    }
+    atomic_fetch_sub_explicit(&ec->sleepers, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&ec->waiters, 1, memory_order_relaxed);
+}
+
+/**
+ * Bumps the epoch if anybody announced itself, and wakes up to 'count' of the waiters
+ * that went to sleep (spinning ones see the new epoch).
+ * @param ec Pointer to the eventcount.
+ * @param count How many sleepers to wake.
+ */
+static void notify(eventcount* ec, int count) {
+    if (atomic_load_explicit(&ec->waiters, memory_order_seq_cst) == 0) { // Load half of the handshake.
+        return;
+    }
+    atomic_fetch_add_explicit(&ec->epoch, 1, memory_order_seq_cst); // Store half of the sleepers handshake.
+    atomic_fetch_add_explicit(&ec->notifies, 1, memory_order_relaxed);
+    sync_wake(&ec->epoch, count, &ec->sleepers, SYNC_PRIVATE);
+}
+
+/**
+ * Wakes one waiter, if any.
+ * @param ec Pointer to the eventcount.
+ */
+void eventcount_notify_one(eventcount* ec) {
+    notify(ec, 1);
+}
+
+/**
+ * Wakes every waiter.
+ * @param ec Pointer to the eventcount.
+ */
+void eventcount_notify_all(eventcount* ec) {
+    notify(ec, SYNC_WAKE_ALL);
+}
+
+/**
+ * Reports the eventcount's statistics.
+ * @param ec Pointer to the eventcount.
+ * @param sleeps Out: commits that blocked in the kernel.
+ * @param notifies Out: notifies that found waiters.
+ */
+void eventcount_stats(eventcount* ec, long* sleeps, long* notifies) {
+    *sleeps = atomic_load_explicit(&ec->sleeps, memory_order_relaxed);
+    *notifies = atomic_load_explicit(&ec->notifies, memory_order_relaxed);
+}
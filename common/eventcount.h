@@ -0,0 +1,71 @@
+#ifndef EVENTCOUNT_H
+#define EVENTCOUNT_H
+
+#include <stdatomic.h>
+
+/*
+ * Eventcount: lets a thread sleep until some lock-free condition holds, without a lock
+ * on the notifying side. A waiter takes a key, rechecks its condition and then either
+ * cancels or commits to sleep on that key; any notify after the key was taken makes
+ * the commit return. Notifiers pay one load when nobody waits.
+ *
+ *     for (;;) {
+ *         if (try_take(...)) break;
+ *         int key = eventcount_prepare_wait(&ec);
+ *         if (try_take(...)) { eventcount_cancel_wait(&ec); break; }
+ *         eventcount_commit_wait(&ec, key);
+ *     }
+ *
+ * Memory ordering: the notifier must publish its change with a seq_cst store or RMW
+ * (or follow it with a seq_cst fence) before notifying, and the waiter's recheck must
+ * use seq_cst loads. With the seq_cst 'waiters' increment in prepare_wait and load in
+ * notify, that is the same store->load handshake the sync_wait sleepers counters use.
+ * A committed waiter spins on the epoch first; notifies only make the wake syscall when
+ * a waiter actually sleeps.
+ */
+typedef struct {
+    atomic_int epoch; // Bumped by every notify that found waiters; the futex word.
+    atomic_int waiters; // Threads between prepare_wait and the end of cancel/commit.
+    atomic_int sleepers; // Waiters in (or about to enter) the kernel; only they need a futex wake.
+    atomic_long sleeps; // Statistics: commits that blocked in the kernel.
+    atomic_long notifies; // Statistics: notifies that found waiters.
+} eventcount;
+
+/*
+ * Initializes the eventcount with no waiters.
+ */
+void eventcount_init(eventcount* ec);
+
+/*
+ * Announces the caller as a waiter and returns the key to commit on.
+ * Must be followed by eventcount_cancel_wait or eventcount_commit_wait.
+ */
+int eventcount_prepare_wait(eventcount* ec);
+
+/*
+ * Withdraws the announcement after the recheck found the condition true.
+ */
+void eventcount_cancel_wait(eventcount* ec);
+
+/*
+ * Sleeps until a notify after 'key' was taken (returns at once if one already came).
+ * Wakeups may be spurious; the caller rechecks its condition.
+ */
+void eventcount_commit_wait(eventcount* ec, int key);
+
+/*
+ * Wakes one waiter, if any.
+ */
+void eventcount_notify_one(eventcount* ec);
+
+/*
+ * Wakes every waiter.
+ */
+void eventcount_notify_all(eventcount* ec);
+
+/*
+ * Reports commits that slept and notifies that found waiters.
+ */
+void eventcount_stats(eventcount* ec, long* sleeps, long* notifies);
+
+#endif // EVENTCOUNT_H
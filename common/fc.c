@@ -0,0 +1,162 @@
+#include "fc.h"
+#include <pthread.h> // For pthread_self().
+#include <stdio.h> // For printf.
+#include <stdlib.h> // For exit.
+#include "sync_wait.h" // For sync_backoff().
+
+#define FC_FREE 0 // Record never used.
+#define FC_RELEASED -1 // Record used by a thread that has exited.
+#define FC_COMBINE_PASSES 2 // Scans of the records per combining turn.
+
+/*
+ * Memory ordering: a record's 'op' carries the handoff both ways - the owner's release
+ * store publishes 'arg', the combiner's release store of NULL publishes 'result', and
+ * each side reads it with acquire. Operations are serialized by the combiner lock.
+ * The active list is only an index: a combiner that misses a fresh entry just leaves
+ * that record to the next pass.
+ */
+
+/**
+ * Finds the calling thread's record by open addressing on its thread id.
+ * Probing stops at a never-used record; released records are reused.
+ * @param fc Pointer to the wrapper.
+ * @param claim Non-zero to claim a record if the thread has none.
+ * @return The record, or NULL if the thread has none and 'claim' is 0.
+ */
+static fc_record* fc_find_record(fc_lock* fc, int claim) {
+    long long self = (long long)pthread_self();
+    unsigned start = (unsigned)(((uint64_t)self * 0x9E3779B97F4A7C15ULL) >> 32) % FC_MAX_RECORDS;
+    while (1) {
+        int reuse = -1;
+        long long reuse_owner = FC_FREE;
+        for (int i = 0; i < FC_MAX_RECORDS; i++) {
+            int idx = (start + i) % FC_MAX_RECORDS;
+            long long owner = atomic_load_explicit(&fc->records[idx].owner, memory_order_relaxed);
+            if (owner == self) {
+                return &fc->records[idx];
+            }
+            if (owner == FC_RELEASED && reuse < 0) {
+                reuse = idx;
+                reuse_owner = owner;
+            }
+            if (owner == FC_FREE) {
+                if (reuse < 0) {
+                    reuse = idx;
+                    reuse_owner = owner;
+                }
+                break; // Our record can't be past a never-used one.
+            }
+        }
+        if (!claim) {
+            return NULL;
+        }
+        if (reuse < 0) {
+            printf("thread [%lld] failed to get a combining record, more than %d threads\n", self, FC_MAX_RECORDS);
+            exit(1);
+        }
+        // Acquire pairs with the release in fc_thread_exit: the old owner is done with the record.
+        if (atomic_compare_exchange_strong_explicit(&fc->records[reuse].owner, &reuse_owner, self,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            if (reuse_owner == FC_FREE) {
+                // First use of this record: list it for the combiners. Reused records are listed already.
+                int slot = atomic_fetch_add_explicit(&fc->nactive, 1, memory_order_relaxed);
+                atomic_store_explicit(&fc->active[slot], reuse, memory_order_relaxed);
+            }
+            return &fc->records[reuse];
+        }
+        // Another thread took that record - probe again.
+    }
+}
+
+/**
+ * One combining turn: runs every published operation, scanning the records a few times
+ * so that operations published while combining are picked up too.
+ * Must be called with the combiner lock held.
+ * @param fc Pointer to the wrapper.
+ */
+static void fc_combine(fc_lock* fc) {
+    long done = 0;
+    for (int pass = 0; pass < FC_COMBINE_PASSES; pass++) {
+        int n = atomic_load_explicit(&fc->nactive, memory_order_relaxed);
+        for (int i = 0; i < n; i++) {
+            int idx = atomic_load_explicit(&fc->active[i], memory_order_relaxed);
+            if (idx < 0) {
+                continue; // Still being appended - its owner can't have published yet.
+            }
+            fc_record* r = &fc->records[idx];
+            fc_op op = atomic_load_explicit(&r->op, memory_order_acquire);
+            if (op != NULL) {
+                r->result = op(fc->ctx, r->arg);
+                atomic_store_explicit(&r->op, NULL, memory_order_release); // Hands the result back.
+                done++;
+            }
+        }
+    }
+    atomic_fetch_add_explicit(&fc->passes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&fc->combined, done, memory_order_relaxed);
+}
+
+/**
+ * Initializes the wrapper.
+ * @param fc Pointer to the wrapper.
+ * @param ctx The data structure the operations work on.
+ */
+void fc_init(fc_lock* fc, void* ctx) {
+    ticketlock_init(&fc->combiner);
+    fc->ctx = ctx;
+    atomic_init(&fc->nactive, 0);
+    atomic_init(&fc->passes, 0);
+    atomic_init(&fc->combined, 0);
+    for (int i = 0; i < FC_MAX_RECORDS; i++) {
+        atomic_init(&fc->records[i].op, NULL);
+        fc->records[i].arg = NULL;
+        fc->records[i].result = NULL;
+        atomic_init(&fc->records[i].owner, FC_FREE);
+        atomic_init(&fc->active[i], -1);
+    }
+}
+
+/**
+ * Publishes an operation and waits until some combiner (possibly the caller) ran it.
+ * @param fc Pointer to the wrapper.
+ * @param op The operation.
+ * @param arg Its argument.
+ * @return The operation's result.
+ */
+void* fc_execute(fc_lock* fc, fc_op op, void* arg) {
+    fc_record* me = fc_find_record(fc, 1);
+    me->arg = arg;
+    atomic_store_explicit(&me->op, op, memory_order_release); // Publish.
+    int round = 0;
+    while (atomic_load_explicit(&me->op, memory_order_acquire) != NULL) {
+        if (ticketlock_try_acquire(&fc->combiner)) {
+            fc_combine(fc); // Runs ours too - it was published before we got the lock.
+            ticketlock_release(&fc->combiner);
+        } else {
+            sync_backoff(&round, NULL); // Pause, then yield to let the combiner run.
+        }
+    }
+    return me->result;
+}
+
+/**
+ * Releases the calling thread's record so another thread can reuse it.
+ * @param fc Pointer to the wrapper.
+ */
+void fc_thread_exit(fc_lock* fc) {
+    fc_record* me = fc_find_record(fc, 0);
+    if (me != NULL) {
+        atomic_store_explicit(&me->owner, FC_RELEASED, memory_order_release);
+    }
+}
+
+/**
+ * Reports combining statistics; combined / passes is the average batch size.
+ * @param fc Pointer to the wrapper.
+ * @param passes Out: combining turns.
+ * @param combined Out: operations executed in them.
+ */
+void fc_stats(fc_lock* fc, long* passes, long* combined) {
+    *passes = atomic_load_explicit(&fc->passes, memory_order_relaxed);
+    *combined = atomic_load_explicit(&fc->combined, memory_order_relaxed);
+}
@@ -0,0 +1,63 @@
+#ifndef FC_H
+#define FC_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "ticket_lock.h"
+
+#define FC_MAX_RECORDS 128 // Threads that can use one fc_lock at the same time.
+
+/*
+ * Operation run by the combiner on behalf of the publishing thread.
+ * 'ctx' is the protected data structure, 'arg' the caller's argument.
+ */
+typedef void* (*fc_op)(void* ctx, void* arg);
+
+/*
+ * Per-thread publication record, one cache line each (the alignment pads it to 64 bytes).
+ */
+typedef struct {
+    _Alignas(64) _Atomic(fc_op) op; // Pending operation, NULL when idle or done.
+    void* arg; // Argument of the pending operation.
+    void* result; // Result, valid once 'op' is cleared.
+    atomic_llong owner; // Owning thread id, 0 if never used, -1 if released.
+} fc_record;
+
+/*
+ * Flat-combining wrapper around a sequential data structure.
+ * Threads publish their operation in their record; whichever thread gets the
+ * combiner lock runs every pending operation in one pass, so the structure stays
+ * hot in a single cache instead of bouncing with the lock.
+ */
+typedef struct {
+    ticket_lock combiner; // Held by the thread currently combining.
+    void* ctx; // The protected data structure.
+    atomic_int nactive; // Records ever claimed, listed in 'active'.
+    atomic_int active[FC_MAX_RECORDS]; // Indices of claimed records (-1 while being appended), so combiners skip unused ones.
+    atomic_long passes; // Combining passes run.
+    atomic_long combined; // Operations executed by combiners.
+    fc_record records[FC_MAX_RECORDS];
+} fc_lock;
+
+/*
+ * Initializes the wrapper around the data structure 'ctx'.
+ */
+void fc_init(fc_lock* fc, void* ctx);
+
+/*
+ * Runs 'op(ctx, arg)' under mutual exclusion with every other operation on 'fc'
+ * and returns its result. The calling thread may end up running other threads' operations too.
+ */
+void* fc_execute(fc_lock* fc, fc_op op, void* arg);
+
+/*
+ * Releases the calling thread's publication record (call before the thread exits).
+ */
+void fc_thread_exit(fc_lock* fc);
+
+/*
+ * Reports how many combining passes ran and how many operations they executed.
+ */
+void fc_stats(fc_lock* fc, long* passes, long* combined);
+
+#endif // FC_H
@@ -0,0 +1,122 @@
+#include "reactive_lock.h"
+#include "sync_wait.h" // For sync_backoff().
+
+/**
+ * Initializes the lock in RL_TAS mode.
+ * @param lock Pointer to the lock.
+ */
+void reactive_lock_init(reactive_lock* lock) {
+    atomic_init(&lock->word, 0);
+    atomic_init(&lock->mode, RL_TAS);
+    atomic_init(&lock->contended, 0);
+    ticketlock_init(&lock->queue);
+    lock->score = 0;
+    lock->idle = 0;
+    lock->tas_acquires = 0;
+    lock->queue_acquires = 0;
+    lock->switches = 0;
+}
+
+/*
+ * Memory ordering: 'word' is an acquire exchange / release store spinlock, and the
+ * holder-only fields (score, idle, counters) ride on it. 'mode' and 'contended' are
+ * hints - a thread acting on a stale mode still has to win 'word' - so they are relaxed.
+ */
+
+/**
+ * Switches the mode. Called by the holder only.
+ */
+static void reactive_switch(reactive_lock* lock, int mode) {
+    atomic_store_explicit(&lock->mode, mode, memory_order_relaxed);
+    lock->score = 0;
+    lock->idle = 0;
+    lock->switches++;
+}
+
+/**
+ * Competes for the lock word directly (test-and-test-and-set with backoff).
+ * Gives up without the lock if the holder switched to RL_QUEUE meanwhile.
+ * @param lock Pointer to the lock.
+ * @return 1 with the lock held, 0 if the caller should take the queue instead.
+ */
+static int reactive_acquire_tas(reactive_lock* lock) {
+    int round = 0;
+    while (atomic_load_explicit(&lock->word, memory_order_relaxed) != 0
+           || atomic_exchange_explicit(&lock->word, 1, memory_order_acquire) != 0) {
+        if (!atomic_load_explicit(&lock->contended, memory_order_relaxed)) {
+            atomic_store_explicit(&lock->contended, 1, memory_order_relaxed); // Tell the holder.
+        }
+        if (atomic_load_explicit(&lock->mode, memory_order_relaxed) != RL_TAS) {
+            return 0;
+        }
+        sync_backoff(&round, NULL);
+    }
+    lock->tas_acquires++;
+    return 1;
+}
+
+/**
+ * Takes a ticket, and once at the head of the queue competes for the word - usually
+ * only against the holder, so the spin is short and nobody else stampedes.
+ * @param lock Pointer to the lock.
+ */
+static void reactive_acquire_queue(reactive_lock* lock) {
+    int my_ticket = ticketlock_take_ticket(&lock->queue);
+    if (atomic_load_explicit(&lock->queue.cur_ticket, memory_order_acquire) != my_ticket) {
+        ticketlock_wait_turn(&lock->queue, my_ticket);
+    }
+    int round = 0;
+    while (atomic_load_explicit(&lock->word, memory_order_relaxed) != 0
+           || atomic_exchange_explicit(&lock->word, 1, memory_order_acquire) != 0) {
+        sync_backoff(&round, NULL);
+    }
+    int alone = atomic_load_explicit(&lock->queue.ticket, memory_order_relaxed) == (int)((unsigned)my_ticket + 1u); // Nobody queued behind us.
+    ticketlock_release(&lock->queue); // The next in line may start spinning on the word.
+    lock->queue_acquires++;
+    if (atomic_load_explicit(&lock->mode, memory_order_relaxed) == RL_QUEUE) {
+        if (!alone) {
+            lock->idle = 0;
+        } else if (++lock->idle >= RL_TO_TAS_IDLE) {
+            reactive_switch(lock, RL_TAS);
+        }
+    }
+}
+
+/**
+ * Slow path of reactive_lock_acquire.
+ * @param lock Pointer to the lock.
+ */
+void reactive_lock_acquire_slow(reactive_lock* lock) {
+    while (atomic_load_explicit(&lock->mode, memory_order_relaxed) == RL_TAS) {
+        if (reactive_acquire_tas(lock)) {
+            return;
+        }
+    }
+    reactive_acquire_queue(lock);
+}
+
+/**
+ * Slow path of reactive_lock_release: somebody spun on the word during this critical
+ * section. Counts it towards RL_TO_QUEUE_SCORE, then frees the word.
+ * @param lock Pointer to the lock.
+ */
+void reactive_lock_release_slow(reactive_lock* lock) {
+    atomic_store_explicit(&lock->contended, 0, memory_order_relaxed);
+    if (atomic_load_explicit(&lock->mode, memory_order_relaxed) == RL_TAS && ++lock->score >= RL_TO_QUEUE_SCORE) {
+        reactive_switch(lock, RL_QUEUE);
+    }
+    atomic_store_explicit(&lock->word, 0, memory_order_release);
+}
+
+/**
+ * Reports the lock's statistics.
+ * @param lock Pointer to the lock.
+ * @param tas_acquires Out: acquisitions in RL_TAS mode.
+ * @param queue_acquires Out: acquisitions through the queue.
+ * @param switches Out: mode changes.
+ */
+void reactive_lock_stats(reactive_lock* lock, long* tas_acquires, long* queue_acquires, long* switches) {
+    *tas_acquires = lock->tas_acquires;
+    *queue_acquires = lock->queue_acquires;
+    *switches = lock->switches;
+}
@@ -0,0 +1,76 @@
+#ifndef REACTIVE_LOCK_H
+#define REACTIVE_LOCK_H
+
+#include <stdatomic.h>
+#include "ticket_lock.h"
+
+#define RL_TAS 0 // Threads compete directly for the lock word.
+#define RL_QUEUE 1 // Threads line up in a ticket queue; only its head competes for the word.
+
+/*
+ * Reactive lock: a test-and-set word that is approached either directly (cheap when
+ * uncontended) or through a ticket queue (no stampede on the word under contention).
+ * Ownership is always "holding the TAS word", so threads that still follow the old mode
+ * after a switch stay correct. Spinning waiters flag 'contended'; the holder scores each
+ * critical section on release and switches the mode: RL_TAS -> RL_QUEUE once contended
+ * sections outweigh uncontended ones by RL_TO_QUEUE_SCORE, RL_QUEUE -> RL_TAS after
+ * RL_TO_TAS_IDLE acquisitions in a row found nobody queued behind them. The different
+ * thresholds are the hysteresis.
+ * Statistics are updated by the holder and should be read once the lock is quiet.
+ */
+typedef struct {
+    atomic_int word; // 0 free, 1 held.
+    atomic_int mode; // RL_TAS or RL_QUEUE; written only by the holder.
+    atomic_int contended; // RL_TAS: set by a waiter that found the word held.
+    ticket_lock queue; // RL_QUEUE: orders the contenders for 'word'.
+    int score; // RL_TAS: contended minus uncontended critical sections, floored at 0.
+    int idle; // RL_QUEUE: consecutive acquisitions with an empty queue.
+    long tas_acquires; // Acquisitions in RL_TAS mode.
+    long queue_acquires; // Acquisitions through the queue.
+    long switches; // Mode changes in either direction.
+} reactive_lock;
+
+#define RL_TO_QUEUE_SCORE 16
+#define RL_TO_TAS_IDLE 64
+
+/*
+ * Initializes the lock in RL_TAS mode.
+ */
+void reactive_lock_init(reactive_lock* lock);
+
+/*
+ * Out-of-line part of acquire: contended TAS and the queue path.
+ */
+void reactive_lock_acquire_slow(reactive_lock* lock);
+
+/*
+ * Out-of-line part of release: scores a contended section and may switch to RL_QUEUE.
+ */
+void reactive_lock_release_slow(reactive_lock* lock);
+
+/*
+ * Reports acquisitions per mode and the number of mode switches.
+ */
+void reactive_lock_stats(reactive_lock* lock, long* tas_acquires, long* queue_acquires, long* switches);
+
+static inline void reactive_lock_acquire(reactive_lock* lock) {
+    // Uncontended TAS mode: one exchange. Anything else goes out of line.
+    if (atomic_load_explicit(&lock->mode, memory_order_relaxed) == RL_TAS && !atomic_exchange_explicit(&lock->word, 1, memory_order_acquire)) {
+        lock->tas_acquires++;
+        return;
+    }
+    reactive_lock_acquire_slow(lock);
+}
+
+static inline void reactive_lock_release(reactive_lock* lock) {
+    if (atomic_load_explicit(&lock->contended, memory_order_relaxed)) {
+        reactive_lock_release_slow(lock);
+        return;
+    }
+    if (lock->score > 0) {
+        lock->score--;
+    }
+    atomic_store_explicit(&lock->word, 0, memory_order_release); // A plain mov on x86, no xchg.
+}
+
+#endif // REACTIVE_LOCK_H
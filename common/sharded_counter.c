@@ -0,0 +1,72 @@
+#define _GNU_SOURCE // For sched_getcpu().
+#include "sharded_counter.h"
+#include <sched.h> // For sched_getcpu().
+#include <unistd.h> // For sysconf().
+
+/**
+ * Initializes the counter. Uses the next power of two at or above the number of
+ * online CPUs, capped at SC_MAX_SHARDS.
+ * @param c Pointer to the counter.
+ */
+void sharded_counter_init(sharded_counter* c) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int n = 1;
+    while (n < cpus && n < SC_MAX_SHARDS) {
+        n <<= 1;
+    }
+    c->nshards = n;
+    for (int i = 0; i < SC_MAX_SHARDS; i++) {
+        atomic_init(&c->slots[i].value, 0);
+    }
+    atomic_init(&c->approx, 0);
+}
+
+/**
+ * Adds to the calling CPU's slot. Positive updates that carry the slot across a
+ * multiple of SC_BATCH also publish those batches to 'approx'.
+ * @param c Pointer to the counter.
+ * @param n The amount to add.
+ */
+void sharded_counter_add(sharded_counter* c, long n) {
+    int cpu = sched_getcpu();
+    sc_slot* slot = &c->slots[(cpu < 0 ? 0 : cpu) & (c->nshards - 1)];
+    long old = atomic_fetch_add_explicit(&slot->value, n, memory_order_seq_cst);
+    if (n > 0 && old >= 0) {
+        long batches = (old + n) / SC_BATCH - old / SC_BATCH;
+        if (batches > 0) {
+            atomic_fetch_add_explicit(&c->approx, batches * SC_BATCH, memory_order_seq_cst);
+        }
+    }
+}
+
+/**
+ * Sums every slot.
+ * @param c Pointer to the counter.
+ * @return The total.
+ */
+long sharded_counter_sum(sharded_counter* c) {
+    long sum = 0;
+    for (int i = 0; i < c->nshards; i++) {
+        sum += atomic_load_explicit(&c->slots[i].value, memory_order_seq_cst);
+    }
+    return sum;
+}
+
+/**
+ * Threshold check for a growing counter. Each slot holds less than SC_BATCH beyond
+ * what it flushed (plus updates still in flight), so 'approx' brackets the sum:
+ * approx <= sum < approx + nshards * SC_BATCH.
+ * @param c Pointer to the counter.
+ * @param threshold The value to compare against.
+ * @return 1 if the sum is at least 'threshold', 0 otherwise.
+ */
+int sharded_counter_reached(sharded_counter* c, long threshold) {
+    long approx = atomic_load_explicit(&c->approx, memory_order_seq_cst);
+    if (approx >= threshold) {
+        return 1;
+    }
+    if (approx + (long)c->nshards * SC_BATCH <= threshold) {
+        return 0; // Too far below for the unflushed remainders to make up.
+    }
+    return sharded_counter_sum(c) >= threshold;
+}
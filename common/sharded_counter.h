@@ -0,0 +1,57 @@
+#ifndef SHARDED_COUNTER_H
+#define SHARDED_COUNTER_H
+
+#include <stdatomic.h>
+
+#define SC_MAX_SHARDS 64 // Upper bound on slots; the count in use follows the online CPUs.
+#define SC_BATCH 64 // A slot publishes into 'approx' every SC_BATCH units.
+
+/*
+ * One slot per CPU, alone on its cache line: the alignment also pads it to 64 bytes, and
+ * keeps a static or stack counter from straddling lines.
+ */
+typedef struct {
+    _Alignas(64) atomic_long value;
+} sc_slot;
+
+/*
+ * Counter sharded over per-CPU slots (picked with sched_getcpu, which glibc serves from
+ * rseq), so concurrent updates from different CPUs never share a cache line. Reading the
+ * exact value sums every slot. 'approx' collects whole batches of SC_BATCH from the slots
+ * and lets sharded_counter_reached decide most threshold checks without summing.
+ * A thread may migrate between its updates; only the sum is meaningful, never one slot.
+ *
+ * Memory ordering: updates and sum loads are seq_cst, so two threads that each update
+ * and then sum can't both miss the other's update (on x86 that is still one lock xadd
+ * per update and plain loads).
+ */
+typedef struct {
+    sc_slot slots[SC_MAX_SHARDS];
+    atomic_long approx; // Flushed batches; never more than the sum of positive updates.
+    int nshards; // Slots in use, a power of two.
+} sharded_counter;
+
+/*
+ * Initializes the counter to zero.
+ */
+void sharded_counter_init(sharded_counter* c);
+
+/*
+ * Adds 'n' (may be negative) to the calling CPU's slot.
+ */
+void sharded_counter_add(sharded_counter* c, long n);
+
+/*
+ * Sums every slot. Exact once updates have stopped; under concurrent updates it
+ * counts each finished update and may or may not count the ones in flight.
+ */
+long sharded_counter_sum(sharded_counter* c);
+
+/*
+ * Returns 1 if the sum has reached 'threshold'. For counters that only grow; usually
+ * answered from 'approx' alone, and only summed when the threshold is within one batch
+ * per slot.
+ */
+int sharded_counter_reached(sharded_counter* c, long threshold);
+
+#endif // SHARDED_COUNTER_H
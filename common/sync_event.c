@@ -0,0 +1,85 @@
+#include "sync_event.h"
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/**
+ * Initializes the event.
+ * @param ev The event.
+ */
+void sync_event_init(sync_event* ev) {
+    atomic_init(&ev->fd, -1);
+    atomic_init(&ev->armed, 0);
+}
+
+/**
+ * Closes the eventfd.
+ * @param ev The event.
+ */
+void sync_event_destroy(sync_event* ev) {
+    int fd = atomic_exchange_explicit(&ev->fd, -1, memory_order_relaxed);
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+/**
+ * Returns the eventfd, creating it on first use. Concurrent first calls race with a
+ * CAS; the loser closes its fd and returns the winner's.
+ * @param ev The event.
+ * @return The fd, or -1 if eventfd() failed.
+ */
+int sync_event_fd(sync_event* ev) {
+    int fd = atomic_load_explicit(&ev->fd, memory_order_acquire);
+    if (fd >= 0) {
+        return fd;
+    }
+    int created = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (created < 0) {
+        return -1;
+    }
+    if (!atomic_compare_exchange_strong_explicit(&ev->fd, &fd, created, memory_order_acq_rel, memory_order_acquire)) {
+        close(created);
+        return fd;
+    }
+    return created;
+}
+
+/**
+ * Registers interest in the next post.
+ * @param ev The event.
+ */
+void sync_event_arm(sync_event* ev) {
+    sync_event_fd(ev); // Posts need an fd to write to.
+    atomic_store_explicit(&ev->armed, 1, memory_order_seq_cst); // Store half of the handshake.
+}
+
+/**
+ * Drains the eventfd counter, so the fd stops being readable until the next post.
+ * @param ev The event.
+ */
+void sync_event_consume(sync_event* ev) {
+    int fd = atomic_load_explicit(&ev->fd, memory_order_acquire);
+    uint64_t count;
+    if (fd >= 0) {
+        ssize_t n = read(fd, &count, sizeof(count));
+        (void)n; // EAGAIN: nothing was posted since the last read.
+    }
+}
+
+/**
+ * Disarms the event and makes the fd readable. Registrations that lose the race for
+ * the released primitive arm again.
+ * @param ev The event.
+ */
+void sync_event_post_slow(sync_event* ev) {
+    if (atomic_exchange_explicit(&ev->armed, 0, memory_order_acq_rel) == 0) {
+        return; // Another releaser posted first.
+    }
+    int fd = atomic_load_explicit(&ev->fd, memory_order_acquire);
+    uint64_t one = 1;
+    if (fd >= 0) {
+        ssize_t n = write(fd, &one, sizeof(one));
+        (void)n; // Only fails if the counter would overflow - it is readable then anyway.
+    }
+}
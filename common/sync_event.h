@@ -0,0 +1,66 @@
+#ifndef SYNC_EVENT_H
+#define SYNC_EVENT_H
+
+#include <stdatomic.h>
+
+// -----------------------------------------------------
+// Readiness notification for event-loop callers.
+// A loop thread that must not block registers interest in a primitive instead of
+// waiting on it; the primitive's eventfd then becomes readable on the next release
+// that may let it through, and the loop completes the acquisition with a try call
+// (registering again if it loses the race). One fd per primitive, whatever the
+// number of registrations, so a loop can multiplex any number of pending waits.
+//
+// Releasers pay one load while nobody is registered: the arm is a seq_cst store made
+// before the registrant's last try, and the releaser loads 'armed' seq_cst after its
+// seq_cst release - the same store->load handshake as the futex sleepers (sync_wait.h).
+// The fd belongs to the process that created it; don't register on process-shared objects.
+// -----------------------------------------------------
+
+typedef struct {
+    atomic_int fd; // The eventfd, -1 until the first sync_event_fd call.
+    atomic_int armed; // Someone registered since the last post.
+} sync_event;
+
+/*
+ * Initializes the event with no fd and nobody registered.
+ */
+void sync_event_init(sync_event* ev);
+
+/*
+ * Closes the eventfd, if one was created.
+ */
+void sync_event_destroy(sync_event* ev);
+
+/*
+ * Returns the eventfd to poll for EPOLLIN (non-blocking, close-on-exec), creating it on
+ * first use; -1 if it can't be created.
+ */
+int sync_event_fd(sync_event* ev);
+
+/*
+ * Registers interest; the next post makes the fd readable. Retry the acquisition
+ * afterwards, in case the release happened just before.
+ */
+void sync_event_arm(sync_event* ev);
+
+/*
+ * Clears the fd's readability (read it before retrying the registered acquisitions).
+ */
+void sync_event_consume(sync_event* ev);
+
+/*
+ * Slow half of sync_event_post: disarms and signals the fd.
+ */
+void sync_event_post_slow(sync_event* ev);
+
+/*
+ * Called by releasers after their seq_cst release: signals the fd if anyone registered.
+ */
+static inline void sync_event_post(sync_event* ev) {
+    if (atomic_load_explicit(&ev->armed, memory_order_seq_cst)) {
+        sync_event_post_slow(ev);
+    }
+}
+
+#endif // SYNC_EVENT_H
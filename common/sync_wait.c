@@ -0,0 +1,452 @@
+#define _GNU_SOURCE // For syscall().
+#include "sync_wait.h"
+#include <errno.h> // For ETIMEDOUT / ENOSYS.
+#include <sched.h> // For sched_yield().
+#include <stdio.h> // For printf().
+#include <stdlib.h> // For exit().
+#include <stdint.h> // For uintptr_t.
+#include <linux/futex.h> // For the FUTEX_* operations.
+#include <sys/syscall.h> // For SYS_futex / SYS_futex_waitv.
+#include <unistd.h> // For syscall().
+
+#define SYNC_WAITV_POLL_NS 1000000L // Fallback futex_waitv: sleep slice on the first word.
+#define SYNC_AUTO_SPINS 64 // Default spins on a multiprocessor.
+
+sync_wait_policy sync_default_policy = { -1, 16 }; // Spins (-1: automatic), then yields, before sleeping.
+static atomic_int auto_spins = -1; // Resolved value of an automatic spin count.
+
+static int stats_enabled = 0; // Set by sync_wait_enable_stats().
+static atomic_long stat_spin_hits, stat_sleeps, stat_timeouts, stat_wake_calls, stat_woken, stat_requeued;
+
+/**
+ * Adds to a statistics counter if statistics are enabled.
+ */
+static void stat_add(atomic_long* counter, long n) {
+    if (stats_enabled) {
+        atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+    }
+}
+
+/**
+ * Hints the CPU that we are busy-waiting.
+ */
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Resolves NULL to the default policy and an automatic spin count to a number.
+ * On a single CPU spinning can't help - the thread we wait for isn't running -
+ * so the automatic count is 0 there.
+ * @param policy The caller's policy, or NULL.
+ * @param spins Out: the spin count to use.
+ * @return The policy to use.
+ */
+static const sync_wait_policy* resolve_policy(const sync_wait_policy* policy, int* spins) {
+    if (policy == NULL) {
+        policy = &sync_default_policy;
+    }
+    *spins = policy->spins;
+    if (*spins < 0) {
+        *spins = atomic_load_explicit(&auto_spins, memory_order_relaxed);
+        if (*spins < 0) {
+            *spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SYNC_AUTO_SPINS : 0;
+            atomic_store_explicit(&auto_spins, *spins, memory_order_relaxed);
+        }
+    }
+    return policy;
+}
+
+/**
+ * Returns CLOCK_MONOTONIC in nanoseconds.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Applies the private flag to a futex operation unless the word is process-shared.
+ */
+static int futex_op(int op, int flags) {
+    return (flags & SYNC_SHARED) ? op : (op | FUTEX_PRIVATE_FLAG);
+}
+
+/**
+ * Sets the default spin and yield budget.
+ * @param spins Polls with a pause hint (-1 for automatic).
+ * @param yields Rounds of sched_yield() after spinning.
+ */
+void sync_wait_set_policy(int spins, int yields) {
+    sync_default_policy.spins = spins;
+    sync_default_policy.yields = yields;
+}
+
+/**
+ * Turns the statistics counters on or off.
+ * @param enable Non-zero to collect statistics.
+ */
+void sync_wait_enable_stats(int enable) {
+    stats_enabled = enable;
+}
+
+/**
+ * Reads the statistics counters.
+ * @param out Receives the counters.
+ */
+void sync_wait_get_stats(sync_wait_stats* out) {
+    out->spin_hits = atomic_load_explicit(&stat_spin_hits, memory_order_relaxed);
+    out->sleeps = atomic_load_explicit(&stat_sleeps, memory_order_relaxed);
+    out->timeouts = atomic_load_explicit(&stat_timeouts, memory_order_relaxed);
+    out->wake_calls = atomic_load_explicit(&stat_wake_calls, memory_order_relaxed);
+    out->woken = atomic_load_explicit(&stat_woken, memory_order_relaxed);
+    out->requeued = atomic_load_explicit(&stat_requeued, memory_order_relaxed);
+}
+
+/**
+ * One step of a polling loop: pause while in the spin budget, then yield.
+ * @param round In/out: steps taken so far, start at 0.
+ * @param policy Spin budget, NULL for the default.
+ */
+void sync_backoff(int* round, const sync_wait_policy* policy) {
+    int spins;
+    resolve_policy(policy, &spins);
+    if ((*round)++ < spins) {
+        cpu_relax();
+    } else {
+        sched_yield();
+    }
+}
+
+/**
+ * Steps of sync_backoff a waiter takes before it should sleep.
+ * @param policy Spin budget, NULL for the default.
+ * @return Spins plus yields.
+ */
+int sync_backoff_budget(const sync_wait_policy* policy) {
+    int spins;
+    policy = resolve_policy(policy, &spins);
+    return spins + policy->yields;
+}
+
+/**
+ * Spins, then yields, until the word holds 'target'.
+ * @param addr The word.
+ * @param target The awaited value.
+ * @param policy Spin budget, NULL for the default.
+ * @return 1 if the word reached 'target', 0 if the budget ran out.
+ */
+int sync_spin_until(atomic_int* addr, int target, const sync_wait_policy* policy) {
+    int spins;
+    policy = resolve_policy(policy, &spins);
+    for (int i = 0; i < spins + policy->yields; i++) {
+        if (atomic_load_explicit(addr, memory_order_acquire) == target) {
+            stat_add(&stat_spin_hits, 1);
+            return 1;
+        }
+        if (i < spins) {
+            cpu_relax();
+        } else {
+            sched_yield();
+        }
+    }
+    return atomic_load_explicit(addr, memory_order_acquire) == target;
+}
+
+/**
+ * Sleep phase of sync_wait_while: announces the waiter and sleeps until the word changes.
+ * @param addr The word.
+ * @param value The value to wait out.
+ * @param sleepers Counter of sleeping waiters, checked by sync_wake.
+ * @param flags SYNC_PRIVATE or SYNC_SHARED.
+ * @param deadline Absolute CLOCK_MONOTONIC deadline, or NULL.
+ * @return 0 once the value changed, SYNC_TIMEDOUT if the deadline passed.
+ */
+static int sleep_while(atomic_int* addr, int value, atomic_int* sleepers, int flags,
+                       const struct timespec* deadline) {
+    int result = 0;
+    // Announce before the final check, so wakers see us. seq_cst on both sides of this
+    // store->load pair: either the waker's sleepers load sees the increment, or our load
+    // below sees the waker's (seq_cst) update of the word.
+    atomic_fetch_add_explicit(sleepers, 1, memory_order_seq_cst);
+    while (atomic_load_explicit(addr, memory_order_seq_cst) == value) {
+        if (sync_futex_wait(addr, value, SYNC_BITSET_ALL, flags, deadline) == SYNC_TIMEDOUT) {
+            result = atomic_load_explicit(addr, memory_order_acquire) == value ? SYNC_TIMEDOUT : 0;
+            break;
+        }
+    }
+    atomic_fetch_sub_explicit(sleepers, 1, memory_order_relaxed); // Only ever makes wakers more eager.
+    return result;
+}
+
+/**
+ * Blocks while the word holds 'value'.
+ * @param addr The word.
+ * @param value The value to wait out.
+ * @param sleepers Counter of sleeping waiters, checked by sync_wake.
+ * @param flags SYNC_PRIVATE or SYNC_SHARED.
+ * @param deadline Absolute CLOCK_MONOTONIC deadline, or NULL.
+ * @return 0 once the value changed, SYNC_TIMEDOUT if the deadline passed.
+ */
+int sync_wait_while(atomic_int* addr, int value, atomic_int* sleepers, int flags,
+                    const struct timespec* deadline) {
+    int spins;
+    const sync_wait_policy* policy = resolve_policy(NULL, &spins);
+    for (int i = 0; i < spins + policy->yields; i++) {
+        if (atomic_load_explicit(addr, memory_order_acquire) != value) {
+            stat_add(&stat_spin_hits, 1);
+            return 0;
+        }
+        if (i < spins) {
+            cpu_relax();
+        } else {
+            sched_yield();
+        }
+    }
+    return sleep_while(addr, value, sleepers, flags, deadline);
+}
+
+/**
+ * Initializes a learned spin budget.
+ * @param adaptive The budget.
+ */
+void sync_adaptive_init(sync_adaptive* adaptive) {
+    atomic_init(&adaptive->wait_ns, 0);
+}
+
+/**
+ * Current spin budget: twice the average wait, within [SYNC_ADAPTIVE_MIN_NS,
+ * SYNC_ADAPTIVE_MAX_NS]. Paths whose waits average more than the ceiling only spin
+ * for the floor - a wake-up is cheaper than spinning through them.
+ * @param adaptive The budget.
+ * @return Nanoseconds to spin before sleeping.
+ */
+long sync_adaptive_budget(sync_adaptive* adaptive) {
+    long budget = 2 * atomic_load_explicit(&adaptive->wait_ns, memory_order_relaxed);
+    if (budget > 2 * SYNC_ADAPTIVE_MAX_NS || budget < SYNC_ADAPTIVE_MIN_NS) {
+        return SYNC_ADAPTIVE_MIN_NS;
+    }
+    return budget > SYNC_ADAPTIVE_MAX_NS ? SYNC_ADAPTIVE_MAX_NS : budget;
+}
+
+/**
+ * Folds one wait into the moving average. Concurrent updates may lose one another,
+ * which only makes the average a little less smooth.
+ * @param adaptive The budget.
+ * @param start When the wait began (CLOCK_MONOTONIC ns).
+ */
+void sync_adaptive_record(sync_adaptive* adaptive, long long start) {
+    long waited = (long)(now_ns() - start);
+    long average = atomic_load_explicit(&adaptive->wait_ns, memory_order_relaxed);
+    atomic_store_explicit(&adaptive->wait_ns, average + (waited - average) / 8, memory_order_relaxed);
+}
+
+/**
+ * Spins and yields until the word reaches (or leaves) a value, for at most the
+ * learned budget and the policy's step budget.
+ * @param adaptive The budget.
+ * @param addr The word.
+ * @param value The value awaited ('until') or waited out (!'until').
+ * @param until Non-zero to wait for '*addr' == 'value', zero for '*addr' != 'value'.
+ * @param start Out: when the wait began.
+ * @return 1 if the condition held in time, 0 if the budget ran out.
+ */
+static int adaptive_spin(sync_adaptive* adaptive, atomic_int* addr, int value, int until, long long* start) {
+    *start = now_ns();
+    long long end = *start + sync_adaptive_budget(adaptive);
+    int steps = sync_backoff_budget(NULL);
+    int round = 0;
+    while (1) {
+        if ((atomic_load_explicit(addr, memory_order_acquire) == value) == (until != 0)) {
+            stat_add(&stat_spin_hits, 1);
+            sync_adaptive_record(adaptive, *start);
+            return 1;
+        }
+        if (round >= steps || now_ns() >= end) {
+            return 0;
+        }
+        sync_backoff(&round, NULL);
+    }
+}
+
+/**
+ * Blocks while the word holds 'value', spinning first for the learned budget.
+ * @param adaptive The budget; updated with this wait's duration.
+ * @param addr The word.
+ * @param value The value to wait out.
+ * @param sleepers Counter of sleeping waiters, checked by sync_wake.
+ * @param flags SYNC_PRIVATE or SYNC_SHARED.
+ * @param deadline Absolute CLOCK_MONOTONIC deadline, or NULL.
+ * @return 0 once the value changed, SYNC_TIMEDOUT if the deadline passed.
+ */
+int sync_adaptive_wait_while(sync_adaptive* adaptive, atomic_int* addr, int value, atomic_int* sleepers,
+                             int flags, const struct timespec* deadline) {
+    long long start;
+    if (adaptive_spin(adaptive, addr, value, 0, &start)) {
+        return 0;
+    }
+    int result = sleep_while(addr, value, sleepers, flags, deadline);
+    sync_adaptive_record(adaptive, start);
+    return result;
+}
+
+/**
+ * Spin phase of a wait that sleeps on its own futex protocol.
+ * @param adaptive The budget.
+ * @param addr The word.
+ * @param target The awaited value.
+ * @param start Out: when the wait began, for sync_adaptive_record.
+ * @return 1 if the word reached 'target', 0 if the caller must sleep.
+ */
+int sync_adaptive_spin_until(sync_adaptive* adaptive, atomic_int* addr, int target, long long* start) {
+    return adaptive_spin(adaptive, addr, target, 1, start);
+}
+
+/**
+ * Sleeps on a futex word (FUTEX_WAIT_BITSET, which takes an absolute deadline).
+ * @param addr The word.
+ * @param expected Sleep only if the word still holds this.
+ * @param bitset Wakes that must match to end the wait.
+ * @param flags SYNC_PRIVATE or SYNC_SHARED.
+ * @param deadline Absolute CLOCK_MONOTONIC deadline, or NULL.
+ * @return 0 (woken, changed or interrupted), SYNC_TIMEDOUT if the deadline passed.
+ */
+int sync_futex_wait(atomic_int* addr, int expected, unsigned bitset, int flags,
+                    const struct timespec* deadline) {
+    stat_add(&stat_sleeps, 1);
+    if (syscall(SYS_futex, addr, futex_op(FUTEX_WAIT_BITSET, flags), expected, deadline, NULL, bitset) == -1
+        && errno == ETIMEDOUT) {
+        stat_add(&stat_timeouts, 1);
+        return SYNC_TIMEDOUT;
+    }
+    return 0;
+}
+
+/**
+ * Wakes sleepers of a futex word whose bitset matches.
+ * @param addr The word.
+ * @param count How many to wake.
+ * @param bitset Which waiters to consider.
+ * @param flags SYNC_PRIVATE or SYNC_SHARED.
+ * @return The number of threads woken.
+ */
+int sync_futex_wake(atomic_int* addr, int count, unsigned bitset, int flags) {
+    long woken = syscall(SYS_futex, addr, futex_op(FUTEX_WAKE_BITSET, flags), count, NULL, NULL, bitset);
+    if (woken < 0) {
+        woken = 0;
+    }
+    stat_add(&stat_wake_calls, 1);
+    stat_add(&stat_woken, woken);
+    return (int)woken;
+}
+
+/**
+ * Wakes some waiters of one word and moves others onto a second word (FUTEX_CMP_REQUEUE).
+ * Fails harmlessly (returns 0) if 'from' no longer holds 'expected'.
+ * @param from The word the waiters sleep on.
+ * @param expected Value 'from' must still hold.
+ * @param wake How many to wake.
+ * @param requeue How many to move.
+ * @param to The word to move them to.
+ * @param flags SYNC_PRIVATE or SYNC_SHARED.
+ * @return The number of threads woken or moved.
+ */
+int sync_futex_requeue(atomic_int* from, int expected, int wake, int requeue, atomic_int* to, int flags) {
+    long moved = syscall(SYS_futex, from, futex_op(FUTEX_CMP_REQUEUE, flags), wake, (void*)(uintptr_t)requeue, to, expected);
+    if (moved < 0) {
+        moved = 0;
+    }
+    stat_add(&stat_requeued, moved);
+    return (int)moved;
+}
+
+/**
+ * Returns the index of the first word that no longer holds its expected value, or -1.
+ */
+static int first_changed(atomic_int* const* addrs, const int* expected, int n) {
+    for (int i = 0; i < n; i++) {
+        if (atomic_load_explicit(addrs[i], memory_order_acquire) != expected[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Sleeps on several words at once.
+ * @param addrs The words.
+ * @param expected Their expected values.
+ * @param n Number of words, 1..SYNC_WAITV_MAX.
+ * @param flags SYNC_PRIVATE or SYNC_SHARED.
+ * @param deadline Absolute CLOCK_MONOTONIC deadline, or NULL.
+ * @return Index of a woken or changed word, or SYNC_TIMEDOUT.
+ */
+int sync_futex_waitv(atomic_int* const* addrs, const int* expected, int n, int flags,
+                     const struct timespec* deadline) {
+    if (n < 1 || n > SYNC_WAITV_MAX) {
+        printf("sync_futex_waitv: %d words, must be 1..%d\n", n, SYNC_WAITV_MAX);
+        exit(1);
+    }
+#ifdef SYS_futex_waitv
+    _Static_assert(SYNC_WAITV_MAX == FUTEX_WAITV_MAX, "SYNC_WAITV_MAX must match the kernel's limit");
+    struct futex_waitv waiters[SYNC_WAITV_MAX];
+    for (int i = 0; i < n; i++) {
+        waiters[i].val = (uint32_t)expected[i];
+        waiters[i].uaddr = (uintptr_t)addrs[i];
+        waiters[i].flags = FUTEX_32 | ((flags & SYNC_SHARED) ? 0 : FUTEX_PRIVATE_FLAG);
+        waiters[i].__reserved = 0;
+    }
+    stat_add(&stat_sleeps, 1);
+    long woken = syscall(SYS_futex_waitv, waiters, n, 0, deadline, CLOCK_MONOTONIC);
+    if (woken >= 0) {
+        return (int)woken;
+    }
+    if (errno != ENOSYS) {
+        int changed = first_changed(addrs, expected, n);
+        if (changed >= 0) {
+            return changed;
+        }
+        if (errno == ETIMEDOUT) {
+            stat_add(&stat_timeouts, 1);
+            return SYNC_TIMEDOUT;
+        }
+        return 0; // Interrupted - report the first word, callers recheck anyway.
+    }
+#endif
+    // No futex_waitv: sleep on the first word in short slices and recheck the others.
+    while (1) {
+        int changed = first_changed(addrs, expected, n);
+        if (changed >= 0) {
+            return changed;
+        }
+        struct timespec slice;
+        sync_deadline_after(&slice, SYNC_WAITV_POLL_NS);
+        if (deadline != NULL && (deadline->tv_sec < slice.tv_sec
+            || (deadline->tv_sec == slice.tv_sec && deadline->tv_nsec < slice.tv_nsec))) {
+            slice = *deadline;
+        }
+        if (sync_futex_wait(addrs[0], expected[0], SYNC_BITSET_ALL, flags, &slice) == SYNC_TIMEDOUT
+            && deadline != NULL && slice.tv_sec == deadline->tv_sec && slice.tv_nsec == deadline->tv_nsec) {
+            changed = first_changed(addrs, expected, n);
+            return changed >= 0 ? changed : SYNC_TIMEDOUT;
+        }
+    }
+}
+
+/**
+ * Computes an absolute deadline.
+ * @param deadline Out: now + 'ns' on CLOCK_MONOTONIC.
+ * @param ns Nanoseconds from now.
+ */
+void sync_deadline_after(struct timespec* deadline, long ns) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += ns / 1000000000L;
+    deadline->tv_nsec += ns % 1000000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
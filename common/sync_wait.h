@@ -0,0 +1,182 @@
+#ifndef SYNC_WAIT_H
+#define SYNC_WAIT_H
+
+#include <limits.h> // For INT_MAX.
+#include <stdatomic.h>
+#include <time.h> // For struct timespec.
+
+// -----------------------------------------------------
+// Wait-on-address layer shared by every blocking primitive.
+// Waiters spin, then yield, then sleep on a futex word; wakers only enter
+// the kernel when a sleeper announced itself. Tuning and instrumentation
+// of all blocking paths happen here.
+//
+// Memory ordering: a wait that returns because the word changed has acquired it,
+// so the waker's writes before its update are visible. The sleeper handshake is a
+// store->load pair on both sides and needs seq_cst: the waker must update the word
+// with a seq_cst store or RMW before calling sync_wake, whose sleepers load is
+// seq_cst too (a plain load on x86; the RMWs are locked instructions anyway).
+// -----------------------------------------------------
+
+#define SYNC_PRIVATE 0 // Waiters are threads of one process.
+#define SYNC_SHARED 1 // The word may live in shared memory, waiters in other processes.
+
+#define SYNC_BITSET_ALL 0xFFFFFFFFu // Bitset matching every waiter.
+#define SYNC_WAKE_ALL INT_MAX // Wake count for "everybody".
+#define SYNC_TIMEDOUT -1 // The absolute deadline passed before the wait ended.
+#define SYNC_WAITV_MAX 128 // Most words one sync_futex_waitv can watch (the kernel's FUTEX_WAITV_MAX).
+
+/*
+ * How long a waiter keeps the CPU before it sleeps:
+ * 'spins' polls with a pause hint, then 'yields' rounds of sched_yield().
+ * A negative 'spins' picks a count automatically (none on a single CPU).
+ */
+typedef struct {
+    int spins;
+    int yields;
+} sync_wait_policy;
+
+/*
+ * Counters collected while statistics are enabled.
+ */
+typedef struct {
+    long spin_hits; // Waits that ended while spinning or yielding.
+    long sleeps; // Futex waits entered.
+    long timeouts; // Waits that ran into their deadline.
+    long wake_calls; // Futex wakes issued.
+    long woken; // Threads reported woken by those calls.
+    long requeued; // Threads moved from one futex word to another.
+} sync_wait_stats;
+
+/*
+ * Learned spin budget of one blocking path, in the spirit of glibc's adaptive mutex:
+ * a moving average of how long recent waits on it lasted. Waiters spin for about
+ * twice that before sleeping, so short critical sections are waited out without a
+ * wake-up and long ones go to sleep almost at once. Still bounded by the policy's
+ * spin and yield budget.
+ */
+typedef struct {
+    atomic_long wait_ns; // Moving average (weight 1/8) of recent wait times.
+} sync_adaptive;
+
+#define SYNC_ADAPTIVE_MIN_NS 1000L // Spin budget floor, so the average can come back down.
+#define SYNC_ADAPTIVE_MAX_NS 20000L // Spin budget ceiling; waits longer on average sleep at the floor.
+
+/*
+ * Policy used when a primitive passes NULL.
+ */
+extern sync_wait_policy sync_default_policy;
+
+/*
+ * Sets the default spin and yield budget for every primitive.
+ */
+void sync_wait_set_policy(int spins, int yields);
+
+/*
+ * Enables (1) or disables (0) the statistics counters. Off by default,
+ * so the fast paths don't share a counter cache line.
+ */
+void sync_wait_enable_stats(int enable);
+
+/*
+ * Copies the statistics collected so far into 'out'.
+ */
+void sync_wait_get_stats(sync_wait_stats* out);
+
+/*
+ * One step of a polling loop that has no futex word to sleep on:
+ * pauses while '*round' is in the spin budget, then yields.
+ */
+void sync_backoff(int* round, const sync_wait_policy* policy);
+
+/*
+ * Number of sync_backoff steps 'policy' allows before a waiter should sleep.
+ */
+int sync_backoff_budget(const sync_wait_policy* policy);
+
+/*
+ * Spins and yields (per 'policy') until '*addr' equals 'target'.
+ * Returns 1 if it did, 0 if the budget ran out first.
+ */
+int sync_spin_until(atomic_int* addr, int target, const sync_wait_policy* policy);
+
+/*
+ * Blocks while '*addr' holds 'value': spins, then sleeps on the word, counting itself
+ * in 'sleepers' so that sync_wake can skip the syscall when nobody sleeps.
+ * 'deadline' is an absolute CLOCK_MONOTONIC time, or NULL to wait forever.
+ * Returns 0 once the value changed, SYNC_TIMEDOUT if the deadline passed.
+ */
+int sync_wait_while(atomic_int* addr, int value, atomic_int* sleepers, int flags,
+                    const struct timespec* deadline);
+
+/*
+ * Initializes a learned spin budget (no history: waiters start at the floor).
+ */
+void sync_adaptive_init(sync_adaptive* adaptive);
+
+/*
+ * Nanoseconds a waiter on this path currently spins before sleeping.
+ */
+long sync_adaptive_budget(sync_adaptive* adaptive);
+
+/*
+ * sync_wait_while with the spin phase sized by 'adaptive'; the wait's duration
+ * (including any sleep) is folded into the average.
+ */
+int sync_adaptive_wait_while(sync_adaptive* adaptive, atomic_int* addr, int value, atomic_int* sleepers,
+                             int flags, const struct timespec* deadline);
+
+/*
+ * Spin phase for primitives that sleep on their own: spins and yields until '*addr'
+ * equals 'target' or the learned budget runs out. '*start' receives the wait's start
+ * time. Returns 1 if the word reached 'target' (the wait is recorded), 0 if the caller
+ * must sleep and then call sync_adaptive_record.
+ */
+int sync_adaptive_spin_until(sync_adaptive* adaptive, atomic_int* addr, int target, long long* start);
+
+/*
+ * Folds a wait that began at 'start' (from sync_adaptive_spin_until) into the average.
+ */
+void sync_adaptive_record(sync_adaptive* adaptive, long long start);
+
+/*
+ * Raw futex operations for primitives with their own sleeper accounting.
+ * sync_futex_wait sleeps if '*addr' == 'expected' until a wake matching 'bitset'
+ * or the absolute 'deadline'; returns 0 or SYNC_TIMEDOUT.
+ * sync_futex_wake returns the number of threads woken.
+ * sync_futex_requeue wakes 'wake' waiters of 'from' (if it still holds 'expected')
+ * and moves up to 'requeue' others onto 'to'; returns the number woken plus moved.
+ */
+int sync_futex_wait(atomic_int* addr, int expected, unsigned bitset, int flags,
+                    const struct timespec* deadline);
+int sync_futex_wake(atomic_int* addr, int count, unsigned bitset, int flags);
+int sync_futex_requeue(atomic_int* from, int expected, int wake, int requeue, atomic_int* to, int flags);
+
+/*
+ * Wakes up to 'count' threads blocked in sync_wait_while on 'addr', if any announced
+ * themselves in 'sleepers'. Returns how many the kernel woke.
+ * Inline, so the common "nobody sleeps" case costs one load.
+ */
+static inline int sync_wake(atomic_int* addr, int count, atomic_int* sleepers, int flags) {
+    // Pairs with the waiter announcing itself before its final check (see above).
+    if (atomic_load_explicit(sleepers, memory_order_seq_cst) == 0) {
+        return 0;
+    }
+    return sync_futex_wake(addr, count, SYNC_BITSET_ALL, flags);
+}
+
+/*
+ * Sleeps until any of the 'n' words differs from its expected value (futex_waitv on
+ * kernels that have it, a bounded polling sleep otherwise). 'n' must be 1..SYNC_WAITV_MAX;
+ * anything else exits the program rather than report a wake the kernel never gave.
+ * Returns the index of a word that was woken or changed, or SYNC_TIMEDOUT.
+ */
+int sync_futex_waitv(atomic_int* const* addrs, const int* expected, int n, int flags,
+                     const struct timespec* deadline);
+
+/*
+ * Sets 'deadline' to 'ns' nanoseconds from now on CLOCK_MONOTONIC.
+ */
+void sync_deadline_after(struct timespec* deadline, long ns);
+
+#endif // SYNC_WAIT_H
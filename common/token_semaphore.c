@@ -0,0 +1,173 @@
+#define _GNU_SOURCE // For sched_getcpu().
+#include "token_semaphore.h"
+#include <sched.h> // For sched_getcpu().
+#include <unistd.h> // For sysconf().
+#include "sync_wait.h" // Spin policy and futex wait/wake.
+
+/*
+ * Memory ordering: permit transfers are seq_cst. A waiter's scan of the pool and the
+ * caches is the final check of the sleeper handshake, and a signal that caches its
+ * permit checks 'sleepers' right after (store->load on both sides). On x86 the CAS and
+ * fetch_add are locked instructions either way and the loads are plain movs.
+ */
+
+/**
+ * Returns the calling CPU's cache.
+ */
+static ts_cache* my_cache(token_semaphore* sem) {
+    int cpu = sched_getcpu();
+    return &sem->caches[(cpu < 0 ? 0 : cpu) & (sem->nshards - 1)];
+}
+
+/**
+ * Takes up to 'n' permits from a counter without letting it go negative.
+ * @param word The pool or a cache.
+ * @param n Most permits to take.
+ * @return Permits taken (0 if it was empty).
+ */
+static int take_up_to(atomic_int* word, int n) {
+    int have = atomic_load_explicit(word, memory_order_seq_cst);
+    while (have > 0) {
+        int k = have < n ? have : n;
+        if (atomic_compare_exchange_weak_explicit(word, &have, have - k, memory_order_seq_cst, memory_order_seq_cst)) {
+            return k;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Returns permits to the pool and wakes as many sleepers.
+ * @param sem Pointer to the semaphore.
+ * @param n Permits to return.
+ */
+static void return_to_pool(token_semaphore* sem, int n) {
+    atomic_fetch_add_explicit(&sem->pool, n, memory_order_seq_cst);
+    atomic_fetch_add_explicit(&sem->flushes, 1, memory_order_relaxed);
+    sync_wake(&sem->pool, n, &sem->sleepers, SYNC_PRIVATE);
+}
+
+/**
+ * Returns 1 while the semaphore must account precisely: the pool is low, or somebody
+ * sleeps (permits cached on one CPU could otherwise sit idle while another CPU waits).
+ */
+static int precise(token_semaphore* sem) {
+    return atomic_load_explicit(&sem->pool, memory_order_relaxed) < sem->low
+        || atomic_load_explicit(&sem->sleepers, memory_order_seq_cst) > 0;
+}
+
+/**
+ * Initializes the semaphore. One cache per online CPU (rounded up to a power of two,
+ * at most TS_MAX_SHARDS); the pool is low below one batch per cache.
+ * @param sem Pointer to the semaphore.
+ * @param permits Initial number of permits.
+ * @param batch Permits per refill or flush (<= 0 for TS_DEFAULT_BATCH).
+ */
+void token_semaphore_init(token_semaphore* sem, int permits, int batch) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int n = 1;
+    while (n < cpus && n < TS_MAX_SHARDS) {
+        n <<= 1;
+    }
+    sem->nshards = n;
+    sem->batch = batch > 0 ? batch : TS_DEFAULT_BATCH;
+    sem->low = n * sem->batch;
+    for (int i = 0; i < TS_MAX_SHARDS; i++) {
+        atomic_init(&sem->caches[i].permits, 0);
+    }
+    atomic_init(&sem->pool, permits);
+    atomic_init(&sem->sleepers, 0);
+    atomic_init(&sem->refills, 0);
+    atomic_init(&sem->flushes, 0);
+    atomic_init(&sem->steals, 0);
+}
+
+/**
+ * Takes a permit without blocking: from this CPU's cache, else from the pool (a whole
+ * batch when it is well stocked, keeping the rest cached), else from another CPU's cache.
+ * @param sem Pointer to the semaphore.
+ * @return 1 if a permit was taken, 0 if none was available.
+ */
+int token_semaphore_try_wait(token_semaphore* sem) {
+    ts_cache* mine = my_cache(sem);
+    if (take_up_to(&mine->permits, 1)) {
+        return 1;
+    }
+    int got = take_up_to(&sem->pool, precise(sem) ? 1 : sem->batch);
+    if (got > 0) {
+        if (got > 1) {
+            atomic_fetch_add_explicit(&mine->permits, got - 1, memory_order_seq_cst);
+            atomic_fetch_add_explicit(&sem->refills, 1, memory_order_relaxed);
+        }
+        return 1;
+    }
+    for (int i = 0; i < sem->nshards; i++) {
+        if (&sem->caches[i] != mine && take_up_to(&sem->caches[i].permits, 1)) {
+            atomic_fetch_add_explicit(&sem->steals, 1, memory_order_relaxed);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Takes a permit, spinning per the sync_wait policy and then sleeping on the pool.
+ * @param sem Pointer to the semaphore.
+ */
+void token_semaphore_wait(token_semaphore* sem) {
+    if (token_semaphore_try_wait(sem)) {
+        return;
+    }
+    int budget = sync_backoff_budget(NULL);
+    for (int round = 0; round < budget; ) {
+        sync_backoff(&round, NULL);
+        if (token_semaphore_try_wait(sem)) {
+            return;
+        }
+    }
+    // Announce before the final scan, so signals stop caching and feed the pool.
+    atomic_fetch_add_explicit(&sem->sleepers, 1, memory_order_seq_cst);
+    while (!token_semaphore_try_wait(sem)) {
+        sync_futex_wait(&sem->pool, 0, SYNC_BITSET_ALL, SYNC_PRIVATE, NULL);
+    }
+    atomic_fetch_sub_explicit(&sem->sleepers, 1, memory_order_relaxed);
+}
+
+/**
+ * Returns a permit: to this CPU's cache while permits are plentiful (flushing a batch
+ * once the cache holds two), straight to the pool while precise.
+ * @param sem Pointer to the semaphore.
+ */
+void token_semaphore_signal(token_semaphore* sem) {
+    if (precise(sem)) {
+        return_to_pool(sem, 1);
+        return;
+    }
+    ts_cache* mine = my_cache(sem);
+    int cached = atomic_fetch_add_explicit(&mine->permits, 1, memory_order_seq_cst) + 1;
+    if (atomic_load_explicit(&sem->sleepers, memory_order_seq_cst) > 0) {
+        // A waiter announced itself after our check: don't leave permits where it won't sleep on them.
+        int n = atomic_exchange_explicit(&mine->permits, 0, memory_order_seq_cst);
+        if (n > 0) {
+            return_to_pool(sem, n);
+        }
+    } else if (cached >= 2 * sem->batch) {
+        int n = take_up_to(&mine->permits, sem->batch);
+        if (n > 0) {
+            return_to_pool(sem, n);
+        }
+    }
+}
+
+/**
+ * Reports the semaphore's statistics.
+ * @param sem Pointer to the semaphore.
+ * @param refills Out: batches taken from the pool into a cache.
+ * @param flushes Out: returns to the pool.
+ * @param steals Out: permits taken from another CPU's cache.
+ */
+void token_semaphore_stats(token_semaphore* sem, long* refills, long* flushes, long* steals) {
+    *refills = atomic_load_explicit(&sem->refills, memory_order_relaxed);
+    *flushes = atomic_load_explicit(&sem->flushes, memory_order_relaxed);
+    *steals = atomic_load_explicit(&sem->steals, memory_order_relaxed);
+}
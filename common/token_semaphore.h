@@ -0,0 +1,63 @@
+#ifndef TOKEN_SEMAPHORE_H
+#define TOKEN_SEMAPHORE_H
+
+#include <stdatomic.h>
+
+#define TS_MAX_SHARDS 64 // Upper bound on per-CPU caches; the count in use follows the online CPUs.
+#define TS_DEFAULT_BATCH 8 // Permits moved between a cache and the pool at a time.
+
+/*
+ * One CPU's cache of permits, alone on its cache line (the alignment pads it to 64 bytes).
+ */
+typedef struct {
+    _Alignas(64) atomic_int permits;
+} ts_cache;
+
+/*
+ * Counting semaphore for many threads and plentiful permits (connection-pool style).
+ * Every permit is in exactly one place: the global pool, a per-CPU cache, or held by a
+ * thread, so the total is never exceeded. Waits and signals work on the caller's CPU
+ * cache and only move permits to and from the pool in batches. Once the pool runs low
+ * (below one batch per cache) the semaphore turns precise: signals return permits
+ * straight to the pool and waits take one at a time, stealing from other caches
+ * before they sleep on the pool.
+ */
+typedef struct {
+    ts_cache caches[TS_MAX_SHARDS];
+    atomic_int pool; // Permits not cached anywhere; also the futex word.
+    atomic_int sleepers; // Waiters asleep on 'pool'.
+    int nshards; // Caches in use, a power of two.
+    int batch; // Permits per refill or flush.
+    int low; // Pool level below which the semaphore is precise.
+    atomic_long refills; // Batches taken from the pool.
+    atomic_long flushes; // Batches (or single permits) returned to the pool.
+    atomic_long steals; // Permits taken from another CPU's cache.
+} token_semaphore;
+
+/*
+ * Initializes the semaphore with 'permits' permits, all in the pool.
+ * 'batch' <= 0 selects TS_DEFAULT_BATCH.
+ */
+void token_semaphore_init(token_semaphore* sem, int permits, int batch);
+
+/*
+ * Takes a permit, sleeping until one is available.
+ */
+void token_semaphore_wait(token_semaphore* sem);
+
+/*
+ * Takes a permit if one is available anywhere; returns 1 on success, 0 otherwise.
+ */
+int token_semaphore_try_wait(token_semaphore* sem);
+
+/*
+ * Returns a permit.
+ */
+void token_semaphore_signal(token_semaphore* sem);
+
+/*
+ * Reports batch refills, returns to the pool and permits stolen from other caches.
+ */
+void token_semaphore_stats(token_semaphore* sem, long* refills, long* flushes, long* steals);
+
+#endif // TOKEN_SEMAPHORE_H
@@ -0,0 +1,177 @@
+#include "tp_lock.h"
+#include <stddef.h> // For NULL.
+#include <time.h> // For clock_gettime().
+#include "sync_wait.h" // For sync_backoff().
+
+#define TP_WAITING 0 // Queued and spinning, lock not granted yet.
+#define TP_PARKED 1 // Queued and asleep on 'state'.
+#define TP_GRANTED 2 // The releaser handed the lock to this waiter.
+#define TP_SKIPPED 3 // The releaser judged this waiter preempted and dropped it from the queue.
+
+/**
+ * Returns CLOCK_MONOTONIC in nanoseconds.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Takes the guard. Its critical sections are a few pointer updates.
+ */
+static void guard_acquire(tp_lock* lock) {
+    int round = 0;
+    while (atomic_exchange_explicit(&lock->guard, 1, memory_order_acquire)) {
+        sync_backoff(&round, NULL);
+    }
+}
+
+/**
+ * Drops the guard.
+ */
+static void guard_release(tp_lock* lock) {
+    atomic_store_explicit(&lock->guard, 0, memory_order_release);
+}
+
+/**
+ * Initializes the lock.
+ * @param lock Pointer to the lock.
+ * @param patience_ns Heartbeat age after which a waiter is skipped (<= 0 for the default).
+ */
+void tp_lock_init(tp_lock* lock, long patience_ns) {
+    atomic_init(&lock->guard, 0);
+    lock->held = 0;
+    lock->head = NULL;
+    lock->tail = NULL;
+    lock->patience_ns = patience_ns > 0 ? patience_ns : TP_DEFAULT_PATIENCE_NS;
+    atomic_init(&lock->acquisitions, 0);
+    atomic_init(&lock->handoffs, 0);
+    atomic_init(&lock->skips, 0);
+    atomic_init(&lock->rejoins, 0);
+}
+
+/**
+ * Waits on a queued node until the releaser decides about it. Publishes a heartbeat on
+ * every poll; once the spin budget is used up the waiter parks, which tells the releaser
+ * it is not preempted, merely asleep.
+ * @param me The waiter's node.
+ * @return TP_GRANTED or TP_SKIPPED.
+ */
+static int tp_wait(tp_node* me) {
+    int budget = sync_backoff_budget(NULL);
+    int round = 0;
+    int state;
+    // Acquire on every read of the verdict: TP_GRANTED carries the previous holder's writes.
+    while ((state = atomic_load_explicit(&me->state, memory_order_acquire)) == TP_WAITING) {
+        atomic_store_explicit(&me->heartbeat, now_ns(), memory_order_relaxed); // Still running.
+        if (round >= budget) {
+            if (atomic_compare_exchange_strong_explicit(&me->state, &state, TP_PARKED,
+                                                        memory_order_acquire, memory_order_acquire)) {
+                while ((state = atomic_load_explicit(&me->state, memory_order_acquire)) == TP_PARKED) {
+                    sync_futex_wait(&me->state, TP_PARKED, SYNC_BITSET_ALL, SYNC_PRIVATE, NULL);
+                }
+            }
+            return state;
+        }
+        sync_backoff(&round, NULL);
+    }
+    return state;
+}
+
+/**
+ * Acquires the lock. A free lock is taken directly (it is only free when nobody queues);
+ * otherwise the thread queues until it is granted the lock or skipped - in which case
+ * it queues again at the tail.
+ * @param lock Pointer to the lock.
+ */
+void tp_lock_acquire(tp_lock* lock) {
+    tp_node me;
+    int joins = 0;
+    while (1) {
+        guard_acquire(lock);
+        if (!lock->held) {
+            lock->held = 1;
+            guard_release(lock);
+            break;
+        }
+        atomic_init(&me.state, TP_WAITING);
+        atomic_init(&me.heartbeat, now_ns());
+        me.next = NULL;
+        if (lock->tail == NULL) {
+            lock->head = lock->tail = &me;
+        } else {
+            lock->tail->next = &me;
+            lock->tail = &me;
+        }
+        guard_release(lock);
+        if (joins++ > 0) {
+            atomic_fetch_add_explicit(&lock->rejoins, 1, memory_order_relaxed);
+        }
+
+        if (tp_wait(&me) == TP_GRANTED) {
+            break;
+        }
+        // Skipped while descheduled: start over.
+    }
+    atomic_fetch_add_explicit(&lock->acquisitions, 1, memory_order_relaxed);
+}
+
+/**
+ * Hands a verdict to an unlinked waiter, waking it if it parked meanwhile.
+ * @param w The waiter.
+ * @param verdict TP_GRANTED or TP_SKIPPED.
+ */
+static void tp_decide(tp_node* w, int verdict) {
+    // Release publishes the critical section to a granted waiter. Both sides of the
+    // park/decide race are RMWs on 'state', so one always sees the other.
+    if (atomic_exchange_explicit(&w->state, verdict, memory_order_release) == TP_PARKED) {
+        // A stale wake of a frame that already returned is harmless - futex waiters recheck.
+        sync_futex_wake(&w->state, 1, SYNC_BITSET_ALL, SYNC_PRIVATE);
+    }
+}
+
+/**
+ * Releases the lock. Walks the queue from the oldest waiter: the first one that is parked
+ * or has a heartbeat younger than the patience gets the lock; spinning waiters with older
+ * heartbeats were preempted and are skipped. If nobody qualifies the lock is left free.
+ * @param lock Pointer to the lock.
+ */
+void tp_lock_release(tp_lock* lock) {
+    guard_acquire(lock);
+    long long now = now_ns();
+    tp_node* w;
+    while ((w = lock->head) != NULL) {
+        // Unlink first - once its state changes the node may vanish from the waiter's stack.
+        lock->head = w->next;
+        if (lock->head == NULL) {
+            lock->tail = NULL;
+        }
+        if (atomic_load_explicit(&w->state, memory_order_relaxed) == TP_PARKED
+            || now - atomic_load_explicit(&w->heartbeat, memory_order_relaxed) <= lock->patience_ns) {
+            guard_release(lock); // 'held' stays 1 - ownership passes directly.
+            tp_decide(w, TP_GRANTED);
+            atomic_fetch_add_explicit(&lock->handoffs, 1, memory_order_relaxed);
+            return;
+        }
+        tp_decide(w, TP_SKIPPED);
+        atomic_fetch_add_explicit(&lock->skips, 1, memory_order_relaxed);
+    }
+    lock->held = 0;
+    guard_release(lock);
+}
+
+/**
+ * Reports the lock's statistics.
+ * @param lock Pointer to the lock.
+ * @param acquisitions Out: successful acquires.
+ * @param handoffs Out: releases that handed the lock to a live waiter.
+ * @param skips Out: waiters skipped as preempted.
+ * @param rejoins Out: skipped waiters that queued again.
+ */
+void tp_lock_stats(tp_lock* lock, long* acquisitions, long* handoffs, long* skips, long* rejoins) {
+    *acquisitions = atomic_load_explicit(&lock->acquisitions, memory_order_relaxed);
+    *handoffs = atomic_load_explicit(&lock->handoffs, memory_order_relaxed);
+    *skips = atomic_load_explicit(&lock->skips, memory_order_relaxed);
+    *rejoins = atomic_load_explicit(&lock->rejoins, memory_order_relaxed);
+}
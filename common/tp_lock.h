@@ -0,0 +1,58 @@
+#ifndef TP_LOCK_H
+#define TP_LOCK_H
+
+#include <stdatomic.h>
+
+#define TP_DEFAULT_PATIENCE_NS 200000L // Heartbeat age after which a waiter counts as preempted.
+
+/*
+ * Queue node of one waiting thread; lives on the waiter's stack.
+ */
+typedef struct tp_node {
+    atomic_int state; // TP_WAITING, TP_PARKED, TP_GRANTED or TP_SKIPPED (see tp_lock.c); also the futex word.
+    atomic_llong heartbeat; // Last time (CLOCK_MONOTONIC ns) the waiter was seen running.
+    struct tp_node* next;
+} tp_node;
+
+/*
+ * Time-published FIFO lock for oversubscribed runs.
+ * Waiters queue in arrival order and keep publishing a heartbeat while they spin.
+ * On release the lock goes to the first waiter that is either spinning with a recent
+ * heartbeat or parked in the kernel (it wakes with the lock). Waiters whose heartbeat
+ * went stale without parking were preempted: they are skipped and rejoin at the tail
+ * once they run again. If nobody qualifies the lock is left free, so whichever thread
+ * runs next takes it instead of everyone waiting out a descheduled thread's time slice.
+ */
+typedef struct {
+    atomic_int guard; // Short TAS lock over 'held' and the queue.
+    int held; // 1 while some thread owns the lock.
+    tp_node* head; // Oldest waiter.
+    tp_node* tail; // Newest waiter.
+    long long patience_ns; // Heartbeat age that marks a waiter as preempted.
+    atomic_long acquisitions; // Successful acquires.
+    atomic_long handoffs; // Releases that granted the lock to a live waiter.
+    atomic_long skips; // Waiters passed over as preempted.
+    atomic_long rejoins; // Skipped waiters that queued again.
+} tp_lock;
+
+/*
+ * Initializes the lock; 'patience_ns' <= 0 selects TP_DEFAULT_PATIENCE_NS.
+ */
+void tp_lock_init(tp_lock* lock, long patience_ns);
+
+/*
+ * Acquires the lock, queueing behind earlier waiters.
+ */
+void tp_lock_acquire(tp_lock* lock);
+
+/*
+ * Releases the lock to the first live waiter, or leaves it free.
+ */
+void tp_lock_release(tp_lock* lock);
+
+/*
+ * Reports acquisitions, direct handoffs, skipped waiters and rejoins.
+ */
+void tp_lock_stats(tp_lock* lock, long* acquisitions, long* handoffs, long* skips, long* rejoins);
+
+#endif // TP_LOCK_H
@@ -1,4 +1,15 @@
 #include "tas_semaphore.h"
+#include "sync_wait.h" // Spin policy and futex wait/wake.
+
+/*
+ * Acquires the TAS spinlock, backing off per the sync_wait policy while it is taken.
+ */
+static void tas_lock(semaphore* sem) {
+    int round = 0;
+    while (atomic_exchange_explicit(&sem->lock, 1, memory_order_acquire)) {
+        sync_backoff(&round, NULL); // Pause, then yield, until the lock is released.
+    }
+}
 
 /*
  * Initialize the semaphore with an initial value and unlock the spinlock.
@@ -6,6 +17,25 @@
 void semaphore_init(semaphore* sem, int initial_value) {
     sem->value = initial_value; // Setting the initial counter value.
     sem->lock = 0; // Setting the TAS spinlock to unlocked.
+    sem->sleepers = 0; // Nobody asleep yet.
+    sync_adaptive_init(&sem->spin); // No wait history yet.
+    sem->flags = SYNC_PRIVATE;
+    sync_event_init(&sem->ready);
+}
+
+/*
+ * Initialize a process-shared semaphore: same words, futex calls keyed on the shared page.
+ */
+void semaphore_init_shared(semaphore* sem, int initial_value) {
+    semaphore_init(sem, initial_value);
+    sem->flags = SYNC_SHARED;
+}
+
+/*
+ * Release what the semaphore owns: the eventfd, if semaphore_event_fd created one.
+ */
+void semaphore_destroy(semaphore* sem) {
+    sync_event_destroy(&sem->ready);
 }
 
 /*
@@ -13,26 +43,24 @@ void semaphore_init(semaphore* sem, int initial_value) {
  */
 void semaphore_wait(semaphore* sem) {
     // Step 1: acquire the spinlock with TAS.
-    while (atomic_exchange(&sem->lock, 1)) {
-        // spin until lock is released (becomes 0)
-    }
+    tas_lock(sem);
     // Step 2: Checks if semaphore value is greater then 0.
-    while (sem->value <= 0) {
+    while (atomic_load_explicit(&sem->value, memory_order_relaxed) <= 0) { // The spinlock orders it.
         // Release the spinlock so others can signal.
-        atomic_store(&sem->lock, 0);
-        // Spins outside CS until the value is positive.
-        while (sem->value <= 0) {
-            // Busy wait.
+        atomic_store_explicit(&sem->lock, 0, memory_order_release);
+        // Waits outside CS until the value is positive: spins for the learned budget, then sleeps on 'value'.
+        // Only a hint - the value is rechecked under the spinlock.
+        int value;
+        while ((value = atomic_load_explicit(&sem->value, memory_order_relaxed)) <= 0) {
+            sync_adaptive_wait_while(&sem->spin, &sem->value, value, &sem->sleepers, sem->flags, NULL);
         }
         // Re-acquire the spinlock before checking again.
-        while (atomic_exchange(&sem->lock, 1)) {
-            // Spin until lock is acquired.
-        }
+        tas_lock(sem);
     }
     // Step 3: safe to decrement the semaphore value.
-    sem->value--;
-    // Step 4: release the spinlock.
-    atomic_store(&sem->lock, 0);
+    atomic_fetch_sub_explicit(&sem->value, 1, memory_order_relaxed);
+    // Step 4: release the spinlock (a plain release store, no xchg).
+    atomic_store_explicit(&sem->lock, 0, memory_order_release);
 }
 
 /*
@@ -40,11 +68,52 @@ void semaphore_wait(semaphore* sem) {
  */
 void semaphore_signal(semaphore* sem) {
     // Step 1: acquire the spinlock with TAS.
-    while (atomic_exchange(&sem->lock, 1)) {
-        // spin until lock is released (becomes 0)
-    }
-    // Step 2: increment the semaphore value.
-    sem->value++;
+    tas_lock(sem);
+    // Step 2: increment the semaphore value. seq_cst, as it precedes the sleepers check in sync_wake.
+    atomic_fetch_add_explicit(&sem->value, 1, memory_order_seq_cst);
     // Step 3: release the spinlock.
-    atomic_store(&sem->lock, 0);
+    atomic_store_explicit(&sem->lock, 0, memory_order_release);
+    // Step 4: wake one sleeping waiter, if any.
+    sync_wake(&sem->value, 1, &sem->sleepers, sem->flags);
+    // Step 5: let a registered event loop retry (one load if none is).
+    sync_event_post(&sem->ready);
+}
+
+/*
+ * Decrement the semaphore under the spinlock if it is positive, without waiting.
+ * seq_cst load: after semaphore_wait_or_register's arm, it is the load half of the handshake.
+ */
+int semaphore_try_wait(semaphore* sem) {
+    tas_lock(sem);
+    int taken = atomic_load_explicit(&sem->value, memory_order_seq_cst) > 0;
+    if (taken) {
+        atomic_fetch_sub_explicit(&sem->value, 1, memory_order_relaxed);
+    }
+    atomic_store_explicit(&sem->lock, 0, memory_order_release);
+    return taken;
+}
+
+/*
+ * Try, register, try again: a signal between the first try and the arm is caught by the second.
+ */
+int semaphore_wait_or_register(semaphore* sem) {
+    if (semaphore_try_wait(sem)) {
+        return 1;
+    }
+    sync_event_arm(&sem->ready);
+    return semaphore_try_wait(sem);
+}
+
+/*
+ * Return the readiness eventfd, created on first use.
+ */
+int semaphore_event_fd(semaphore* sem) {
+    return sync_event_fd(&sem->ready);
+}
+
+/*
+ * Report the learned spin budget of the waiters.
+ */
+void semaphore_stats(semaphore* sem, long* spin_ns) {
+    *spin_ns = sync_adaptive_budget(&sem->spin);
 }
@@ -2,6 +2,8 @@
 #define TAS_SEMAPHORE_H
 
 #include <stdatomic.h>
+#include "sync_wait.h" // For sync_adaptive.
+#include "sync_event.h" // Readiness for event-loop callers.
 
 /*
  * Define the semaphore type.
@@ -10,6 +12,10 @@
 typedef struct {
     atomic_int value; // Semaphore counter.
     atomic_int lock; // TAS spinlock : 0 for unlocked ,1 for locked (for mutual exclusion).
+    atomic_int sleepers; // Waiters asleep on 'value'.
+    sync_adaptive spin; // Learned spin budget of the waiters.
+    int flags; // SYNC_PRIVATE, or SYNC_SHARED when processes share the semaphore.
+    sync_event ready; // Posted by signals while an event loop is registered.
 } semaphore;
 
 /*
@@ -17,14 +23,47 @@ typedef struct {
  */
 void semaphore_init(semaphore* sem, int initial_value);
 
+/*
+ * Initializes a semaphore in memory shared between processes (shm_open/mmap, MAP_SHARED).
+ */
+void semaphore_init_shared(semaphore* sem, int initial_value);
+
+/*
+ * Closes the semaphore's eventfd, if one was created. No thread may use the semaphore
+ * or poll its fd any more.
+ */
+void semaphore_destroy(semaphore* sem);
+
 /*
  * Decrements the semaphore (wait operation).
  */
 void semaphore_wait(semaphore* sem);
 
+/*
+ * Decrements the semaphore only if it is positive; returns 1 on success, 0 otherwise.
+ */
+int semaphore_try_wait(semaphore* sem);
+
+/*
+ * For event loops that can't block: decrements the semaphore if it is positive (returns 1),
+ * otherwise registers interest (returns 0) and the semaphore_event_fd becomes readable
+ * at the next signal. Then read the fd and call this again.
+ */
+int semaphore_wait_or_register(semaphore* sem);
+
+/*
+ * Returns the eventfd of semaphore_wait_or_register (poll it for EPOLLIN), -1 on failure.
+ */
+int semaphore_event_fd(semaphore* sem);
+
 /*
  * Increments the semaphore (signal operation).
  */
 void semaphore_signal(semaphore* sem);
 
+/*
+ * Reports the waiters' current spin budget in nanoseconds.
+ */
+void semaphore_stats(semaphore* sem, long* spin_ns);
+
 #endif // TAS_SEMAPHORE_H
@@ -1,31 +1,69 @@
-#include <stdatomic.h>
-#include <sched.h> // For sched_yield().
+#include "ticket_lock.h"
+#include "sync_wait.h" // Spin policy and futex wait/wake.
 
-typedef struct
+// Waiters sleep on cur_ticket with a bit derived from their ticket, so a release
+// only wakes the thread whose turn just came (and whoever aliases it 32 tickets later).
+static unsigned ticket_bit(int ticket)
 {
-    atomic_int ticket;
-    atomic_int cur_ticket;
-} ticket_lock;
+    return 1u << (ticket & 31);
+}
 
 void ticketlock_init(ticket_lock* lock)
 {
     atomic_init(&lock->ticket, 0);
     atomic_init(&lock->cur_ticket, 0);
+    atomic_init(&lock->sleepers, 0);
+    lock->flags = SYNC_PRIVATE;
+}
+
+void ticketlock_init_shared(ticket_lock* lock)
+{
+    ticketlock_init(lock);
+    lock->flags = SYNC_SHARED; // Waits and wakes key the futex on the page, not the process.
 }
 
-void ticketlock_acquire(ticket_lock* lock)
+int ticketlock_wait_turn(ticket_lock* lock, int my_ticket)
 {
-    // get my ticket
-    int my_ticket = atomic_fetch_add(&lock->ticket, 1);
+    // short spin/yield phase - the holder is usually about to release
+    if (sync_spin_until(&lock->cur_ticket, my_ticket, NULL))
+    {
+        return 0;
+    }
 
-    // wait until it is my turn
-    while (atomic_load(&lock->cur_ticket) != my_ticket)
+    // park until the release that serves my ticket wakes me
+    int parks = 0;
+    int cur;
+    atomic_fetch_add_explicit(&lock->sleepers, 1, memory_order_seq_cst); // announce before the final check, so release sees us
+    while ((cur = atomic_load_explicit(&lock->cur_ticket, memory_order_seq_cst)) != my_ticket)
     {
-        sched_yield();
+        sync_futex_wait(&lock->cur_ticket, cur, ticket_bit(my_ticket), lock->flags, NULL);
+        parks++;
     }
+    atomic_fetch_sub_explicit(&lock->sleepers, 1, memory_order_relaxed); // a stale count only costs a spare wake
+    return parks;
 }
 
-void ticketlock_release(ticket_lock* lock)
+void ticketlock_wake(ticket_lock* lock, int next)
 {
-    atomic_fetch_add(&lock->cur_ticket, 1);
+    sync_futex_wake(&lock->cur_ticket, SYNC_WAKE_ALL, ticket_bit(next), lock->flags);
+}
+
+void ticketlock_requeue(ticket_lock* lock, atomic_int* waiter_word, int granted, int my_ticket)
+{
+    // already my turn: a plain wake is enough
+    // seq_cst: pairs with the release's sleepers load, like a waiter's final check
+    if (atomic_load_explicit(&lock->cur_ticket, memory_order_seq_cst) == my_ticket)
+    {
+        sync_futex_wake(waiter_word, 1, SYNC_BITSET_ALL, lock->flags);
+        return;
+    }
+
+    // move the sleeper onto cur_ticket without waking it (fails harmlessly if it never slept)
+    sync_futex_requeue(waiter_word, granted, 0, 1, &lock->cur_ticket, lock->flags);
+
+    // the serving release may have happened before the requeue landed
+    if (atomic_load_explicit(&lock->cur_ticket, memory_order_seq_cst) == my_ticket)
+    {
+        sync_futex_wake(&lock->cur_ticket, SYNC_WAKE_ALL, ticket_bit(my_ticket), lock->flags);
+    }
 }
@@ -5,16 +5,85 @@
 
 // -----------------------------------------------------
 // Ticket Lock Header (task2)
-// Used by task2 (ticket semaphore) and task3 (cond var)
+// Used by task2 (ticket semaphore), task3 (cond var) and everything built on them.
+// Waiters spin and yield (sync_wait policy), then park on a futex until their ticket is served.
+// The uncontended paths are inline below; waiting and waking stay out of line.
+// Ordering: serving cur_ticket is the release, observing it served the acquire;
+// 'ticket' only hands out numbers and is relaxed.
+// Both counters wrap after 2^32 tickets: arithmetic on ticket values goes through
+// unsigned, since signed overflow would be undefined.
+// The lock holds no pointers, so it may live in shared memory (ticketlock_init_shared).
 // -----------------------------------------------------
 
 typedef struct {
     atomic_int ticket;
     atomic_int cur_ticket;
+    atomic_int sleepers; // Waiters parked (or about to park) in the kernel.
+    int flags; // SYNC_PRIVATE, or SYNC_SHARED when processes share the lock.
 } ticket_lock;
 
 void ticketlock_init(ticket_lock* lock);
-void ticketlock_acquire(ticket_lock* lock);
-void ticketlock_release(ticket_lock* lock);
+
+// Initializes a lock in memory shared between processes (shm_open/mmap, MAP_SHARED).
+void ticketlock_init_shared(ticket_lock* lock);
+
+// Split acquire: take a ticket (possibly on behalf of another thread), then wait for it.
+// ticketlock_wait_turn returns how many times the caller slept in the kernel.
+int ticketlock_wait_turn(ticket_lock* lock, int my_ticket);
+
+// Slow half of release: wakes the waiter of ticket 'next' if somebody sleeps.
+void ticketlock_wake(ticket_lock* lock, int next);
+
+// Moves a thread sleeping on 'waiter_word' (which now holds 'granted') onto this lock's
+// wait queue, so it wakes only once 'my_ticket' is served (FUTEX_CMP_REQUEUE).
+void ticketlock_requeue(ticket_lock* lock, atomic_int* waiter_word, int granted, int my_ticket);
+
+static inline int ticketlock_take_ticket(ticket_lock* lock)
+{
+    return atomic_fetch_add_explicit(&lock->ticket, 1, memory_order_relaxed);
+}
+
+// Takes 'n' consecutive tickets and returns the first.
+static inline int ticketlock_take_tickets(ticket_lock* lock, int n)
+{
+    return atomic_fetch_add_explicit(&lock->ticket, n, memory_order_relaxed);
+}
+
+static inline void ticketlock_acquire(ticket_lock* lock)
+{
+    // get my ticket
+    int my_ticket = ticketlock_take_ticket(lock);
+
+    // wait until it is my turn - usually it already is
+    if (atomic_load_explicit(&lock->cur_ticket, memory_order_acquire) != my_ticket)
+    {
+        ticketlock_wait_turn(lock, my_ticket);
+    }
+}
+
+// Acquires the lock only if it is free and nobody is queued; returns 1 on success.
+static inline int ticketlock_try_acquire(ticket_lock* lock)
+{
+    // only take a ticket if it would be served right away
+    // the acquire load of cur_ticket already synchronized with the release that served it
+    int cur = atomic_load_explicit(&lock->cur_ticket, memory_order_acquire);
+    int expected = cur;
+    return atomic_load_explicit(&lock->ticket, memory_order_relaxed) == cur
+        && atomic_compare_exchange_strong_explicit(&lock->ticket, &expected, (int)((unsigned)cur + 1u),
+                                                   memory_order_relaxed, memory_order_relaxed);
+}
+
+static inline void ticketlock_release(ticket_lock* lock)
+{
+    // seq_cst rather than release: it is ordered before the sleepers load (sync_wait.h);
+    // on x86 both are the same lock xadd, so the unlock stays fence-free
+    int next = (int)((unsigned)atomic_fetch_add_explicit(&lock->cur_ticket, 1, memory_order_seq_cst) + 1u);
+
+    // only enter the kernel if somebody may be asleep
+    if (atomic_load_explicit(&lock->sleepers, memory_order_seq_cst) > 0)
+    {
+        ticketlock_wake(lock, next);
+    }
+}
 
 #endif
@@ -1,5 +1,13 @@
 #include "tl_semaphore.h"
-#include <sched.h>  // Required for sched_yield.
+#include "sync_wait.h" // Spin policy and futex wait/wake.
+
+/*
+ * Waiters sleep on cur_ticket with a bit derived from their ticket,
+ * so a signal only wakes the thread whose turn came.
+ */
+static unsigned ticket_bit(int ticket) {
+    return 1u << (ticket & 31);
+}
 
 /*
  * Initializes the semaphore pointed to by 'sem' with the specified initial value.
@@ -9,30 +17,89 @@ void semaphore_init(semaphore* sem, int initial_value) {
     atomic_init(&sem->value, initial_value); // Initialize the counter.
     atomic_init(&sem->ticket, 0); // First ticket to give is 0.
     atomic_init(&sem->cur_ticket, 0); // First ticket being served is 0.
+    atomic_init(&sem->sleepers, 0); // Nobody asleep yet.
+    sync_adaptive_init(&sem->spin); // No wait history yet.
+    sem->flags = SYNC_PRIVATE;
+    sync_event_init(&sem->ready);
+}
+
+/*
+ * Initializes a process-shared semaphore: the same words, with futex calls that key on
+ * the shared page instead of the process.
+ */
+void semaphore_init_shared(semaphore* sem, int initial_value) {
+    semaphore_init(sem, initial_value);
+    sem->flags = SYNC_SHARED;
+}
+
+/*
+ * Releases what the semaphore owns: the eventfd, if semaphore_event_fd created one.
+ */
+void semaphore_destroy(semaphore* sem) {
+    sync_event_destroy(&sem->ready);
+}
+
+/*
+ * Slow path of semaphore_wait: the ticket isn't served yet.
+ * Spins and yields for the learned budget, then sleeps until a signal serves the ticket.
+ */
+void semaphore_wait_turn(semaphore* sem, int my_ticket) {
+   long long start;
+   if (!sync_adaptive_spin_until(&sem->spin, &sem->cur_ticket, my_ticket, &start)) {
+    atomic_fetch_add_explicit(&sem->sleepers, 1, memory_order_seq_cst); // Announce before the final check, so signal sees us.
+    int cur;
+    while ((cur = atomic_load_explicit(&sem->cur_ticket, memory_order_seq_cst)) != my_ticket) {
+     sync_futex_wait(&sem->cur_ticket, cur, ticket_bit(my_ticket), sem->flags, NULL);
+    }
+    atomic_fetch_sub_explicit(&sem->sleepers, 1, memory_order_relaxed); // A stale count only costs a spare wake.
+    sync_adaptive_record(&sem->spin, start);
+   }
+}
+
+/*
+ * Takes a ticket only if it would be served right away.
+ * seq_cst load: after semaphore_wait_or_register's arm, it is the load half of the handshake.
+ */
+int semaphore_try_wait(semaphore* sem) {
+    int cur = atomic_load_explicit(&sem->cur_ticket, memory_order_seq_cst);
+    int expected = cur;
+    if (atomic_load_explicit(&sem->ticket, memory_order_relaxed) != cur
+        || !atomic_compare_exchange_strong_explicit(&sem->ticket, &expected, (int)((unsigned)cur + 1u),
+                                                    memory_order_relaxed, memory_order_relaxed)) {
+        return 0;
+    }
+    atomic_fetch_sub_explicit(&sem->value, 1, memory_order_relaxed);
+    return 1;
+}
+
+/*
+ * Try, register, try again: a signal between the first try and the arm is caught by the second.
+ */
+int semaphore_wait_or_register(semaphore* sem) {
+    if (semaphore_try_wait(sem)) {
+        return 1;
+    }
+    sync_event_arm(&sem->ready);
+    return semaphore_try_wait(sem);
+}
+
+/*
+ * Returns the readiness eventfd, created on first use.
+ */
+int semaphore_event_fd(semaphore* sem) {
+    return sync_event_fd(&sem->ready);
 }
 
 /*
- * Decrements the semaphore (wait operation) using the Ticket Lock mechanism.
- * The thread must wait until its ticket is the current one being served.
+ * Slow path of semaphore_signal: wakes the sleeper holding ticket 'next'.
  */
-void semaphore_wait(semaphore* sem) {
-   // Get my ticket.
-   int my_ticket = atomic_fetch_add(&sem->ticket, 1); // Incrementing atomically the ticket number and get my ticket number.
-   // Waiting for my turn.
-   while (atomic_load(&sem->cur_ticket) != my_ticket) {
-    sched_yield(); // Yield CPU - allowing others to execute.
-   } 
-   // Decrement semaphore value.
-   atomic_fetch_sub(&sem->value, 1);
+void semaphore_wake(semaphore* sem, int next) {
+    sync_futex_wake(&sem->cur_ticket, SYNC_WAKE_ALL, ticket_bit(next), sem->flags);
 }
 
 /*
- * Decrements the semaphore (wait operation) using the Ticket Lock mechanism.
- * The thread must wait until its ticket is the current one being served.
+ * Reports the learned spin budget of the waiters.
  */
-void semaphore_signal(semaphore* sem) {
-    // Releasing resource by incrementing the semaphore value.
-    atomic_fetch_add(&sem->value, 1);
-    // Incrementing current ticket for allowing the next thread to process.
-    atomic_fetch_add(&sem->cur_ticket, 1);
+void semaphore_stats(semaphore* sem, long* spin_ns) {
+    *spin_ns = sync_adaptive_budget(&sem->spin);
 }
@@ -2,6 +2,8 @@
 #define TL_SEMAPHORE_H
 
 #include <stdatomic.h>
+#include "sync_wait.h" // For sync_adaptive.
+#include "sync_event.h" // Readiness for event-loop callers.
 
 /*
  * Define the semaphore type for the Ticket Lock implementation.
@@ -11,6 +13,10 @@ typedef struct {
     atomic_int value; // Semaphore counter.
     atomic_int ticket; // Ticket to give.
     atomic_int cur_ticket; // Ticket being served.
+    atomic_int sleepers; // Waiters asleep on cur_ticket.
+    sync_adaptive spin; // Learned spin budget of the waiters.
+    int flags; // SYNC_PRIVATE, or SYNC_SHARED when processes share the semaphore.
+    sync_event ready; // Posted by signals while an event loop is registered.
 } semaphore;
 
 /*
@@ -19,13 +25,73 @@ typedef struct {
 void semaphore_init(semaphore* sem, int initial_value);
 
 /*
- * Decrements the semaphore (wait operation).
+ * Initializes a semaphore in memory shared between processes (shm_open/mmap, MAP_SHARED).
  */
-void semaphore_wait(semaphore* sem);
+void semaphore_init_shared(semaphore* sem, int initial_value);
 
 /*
- * Increments the semaphore (signal operation).
+ * Closes the semaphore's eventfd, if one was created. No thread may use the semaphore
+ * or poll its fd any more.
  */
-void semaphore_signal(semaphore* sem);
+void semaphore_destroy(semaphore* sem);
+
+/*
+ * Reports the waiters' current spin budget in nanoseconds.
+ */
+void semaphore_stats(semaphore* sem, long* spin_ns);
+
+/*
+ * Takes the semaphore only if that needs no waiting; returns 1 on success, 0 otherwise.
+ */
+int semaphore_try_wait(semaphore* sem);
+
+/*
+ * For event loops that can't block: takes the semaphore if it can right away (returns 1),
+ * otherwise registers interest (returns 0) and the semaphore_event_fd becomes readable
+ * at the next signal. Then read the fd and call this again.
+ */
+int semaphore_wait_or_register(semaphore* sem);
+
+/*
+ * Returns the eventfd of semaphore_wait_or_register (poll it for EPOLLIN), -1 on failure.
+ */
+int semaphore_event_fd(semaphore* sem);
+
+/*
+ * Out-of-line slow paths: waiting for 'my_ticket' to be served, and waking the sleeper of 'next'.
+ */
+void semaphore_wait_turn(semaphore* sem, int my_ticket);
+void semaphore_wake(semaphore* sem, int next);
+
+/*
+ * Decrements the semaphore (wait operation) using the Ticket Lock mechanism.
+ * The thread must wait until its ticket is the current one being served.
+ */
+static inline void semaphore_wait(semaphore* sem) {
+   // Get my ticket.
+   int my_ticket = atomic_fetch_add_explicit(&sem->ticket, 1, memory_order_relaxed); // Incrementing atomically the ticket number and get my ticket number (just a number - relaxed).
+   // Waiting for my turn - usually it already is. Acquire pairs with the signal that served it.
+   if (atomic_load_explicit(&sem->cur_ticket, memory_order_acquire) != my_ticket) {
+    semaphore_wait_turn(sem, my_ticket);
+   }
+   // Decrement semaphore value (a counter only, ordered by cur_ticket).
+   atomic_fetch_sub_explicit(&sem->value, 1, memory_order_relaxed);
+}
+
+/*
+ * Increments the semaphore (signal operation) and serves the next ticket.
+ */
+static inline void semaphore_signal(semaphore* sem) {
+    // Releasing resource by incrementing the semaphore value.
+    atomic_fetch_add_explicit(&sem->value, 1, memory_order_relaxed);
+    // Incrementing current ticket for allowing the next thread to process.
+    // seq_cst: it precedes the sleepers load (see sync_wait.h); still a single lock xadd on x86.
+    int next = (int)((unsigned)atomic_fetch_add_explicit(&sem->cur_ticket, 1, memory_order_seq_cst) + 1u); // Wraps (unsigned).
+    // Only enter the kernel if somebody may be asleep.
+    if (atomic_load_explicit(&sem->sleepers, memory_order_seq_cst) > 0) {
+        semaphore_wake(sem, next);
+    }
+    sync_event_post(&sem->ready); // One more load while no event loop is registered.
+}
 
 #endif // TL_SEMAPHORE_H
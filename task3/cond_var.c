@@ -1,7 +1,44 @@
 #include "cond_var.h"
-#include <sched.h> // For sched_yield().
+#include <stddef.h> // For NULL.
+#include "sync_wait.h" // For sync_futex_wait().
 #include "ticket_lock.h"
 
+/**
+ * Moves a dequeued waiter, whose ticket on its external lock is already set, onto that
+ * lock's wait queue (wait morphing). The waiter then wakes when its ticket is served,
+ * instead of waking now only to block on a lock the signaller still holds.
+ * A requeued sleeper keeps the match-all bitset it parked with, so any release of the
+ * lock that wakes somebody wakes it too: only hand over a waiter whose ticket comes
+ * next after the current holder's, or accept one early wake.
+ * @param cv Pointer to the condition variable (for statistics).
+ * @param w The waiter, already unlinked from the condition variable.
+ */
+static void hand_over(condition_variable* cv, cv_waiter* w) {
+    ticket_lock* ext_lock = w->ext_lock; // Read before granting - 'w' may vanish right after.
+    int ticket = w->ticket;
+    atomic_fetch_add_explicit(&cv->handoffs, 1, memory_order_relaxed);
+    // Count the waiter as an ext_lock sleeper before publishing, so a release
+    // serving its ticket never skips the wakeup. A parked waiter drops it itself.
+    // seq_cst: ticketlock_requeue's cur_ticket check is the load half of this handshake.
+    atomic_fetch_add_explicit(&ext_lock->sleepers, 1, memory_order_seq_cst);
+    // Release publishes w->ticket to the waiter's acquire load of its state.
+    if (atomic_exchange_explicit(&w->state, CV_GRANTED, memory_order_release) == CV_PARKED) {
+        ticketlock_requeue(ext_lock, &w->state, CV_GRANTED, ticket); // Only a parked waiter needs kernel help.
+    } else {
+        atomic_fetch_sub_explicit(&ext_lock->sleepers, 1, memory_order_relaxed); // Never slept - nothing to requeue.
+    }
+}
+
+/**
+ * Hands the external lock's next ticket to a dequeued waiter (condition_variable_signal).
+ * @param cv Pointer to the condition variable (for statistics).
+ * @param w The waiter, already unlinked from the condition variable.
+ */
+static void grant_waiter(condition_variable* cv, cv_waiter* w) {
+    w->ticket = ticketlock_take_ticket(w->ext_lock); // Reserve the waiter's place in line.
+    hand_over(cv, w);
+}
+
 /**
  * Initializes the condition variable.
  * Sets up the internal ticket lock and initializes the waiting counter.
@@ -10,46 +47,213 @@
 void condition_variable_init(condition_variable* cv) {
     ticketlock_init(&cv->lock); // Initialize the internal ticket.
     atomic_init(&cv->waiting, 0); // Initialize waiting counter to 0.
+    cv->head = NULL; // No waiters yet.
+    cv->tail = NULL;
+    atomic_init(&cv->handoffs, 0);
+    atomic_init(&cv->parks, 0);
+    sync_adaptive_init(&cv->spin);
+    atomic_init(&cv->seq, 0);
+    cv->flags = SYNC_PRIVATE;
+    sync_event_init(&cv->ready);
+}
+
+/**
+ * Initializes a process-shared condition variable (see cond_var.h).
+ * @param cv Pointer to the condition variable, inside a MAP_SHARED mapping.
+ */
+void condition_variable_init_shared(condition_variable* cv) {
+    condition_variable_init(cv);
+    ticketlock_init_shared(&cv->lock);
+    cv->flags = SYNC_SHARED;
+}
+
+/**
+ * Releases what the condition variable owns: the eventfd, if one was created.
+ * @param cv Pointer to the condition variable, with no waiters left.
+ */
+void condition_variable_destroy(condition_variable* cv) {
+    sync_event_destroy(&cv->ready);
+}
+
+/**
+ * Shared-mode wait: sleeps until 'seq' moves past the value read under the external lock.
+ * A signal that comes after that read changes 'seq', so it is never lost.
+ * @param cv Pointer to the condition variable.
+ * @param ext_lock Pointer to the external lock, held on entry and on return.
+ */
+static void shared_wait(condition_variable* cv, ticket_lock* ext_lock) {
+    // Read under ext_lock: whoever changes the predicate after we release it bumps 'seq' later.
+    int seq = atomic_load_explicit(&cv->seq, memory_order_relaxed);
+    ticketlock_release(ext_lock);
+    // Spin for the learned budget, then sleep; 'waiting' is the sleepers count of sync_wake.
+    sync_adaptive_wait_while(&cv->spin, &cv->seq, seq, &cv->waiting, SYNC_SHARED, NULL);
+    ticketlock_acquire(ext_lock);
+}
+
+/**
+ * Shared-mode signal and broadcast: bumps 'seq' and wakes up to 'count' sleepers.
+ * @param cv Pointer to the condition variable.
+ * @param count How many sleepers to wake.
+ */
+static void shared_wake(condition_variable* cv, int count) {
+    atomic_fetch_add_explicit(&cv->seq, 1, memory_order_seq_cst); // Precedes sync_wake's sleepers load.
+    sync_wake(&cv->seq, count, &cv->waiting, SYNC_SHARED);
 }
 
 /**
  * Causes the calling thread to wait on the condition variable.
  * The thread releases the external lock while waiting and reacquires it before returning.
+ * The reacquisition is done on the waiter's behalf by the signaller, which takes a ticket
+ * for it, so the waiter returns as soon as that ticket is served. A waiter released by a
+ * broadcast then hands the turn on to the waiter holding the next ticket.
  * @param cv Pointer to the condition variable.
  * @param ext_lock Pointer to the external lock that protects shared data.
  */
 void condition_variable_wait(condition_variable* cv, ticket_lock* ext_lock) {
+    if (cv->flags == SYNC_SHARED) {
+        shared_wait(cv, ext_lock);
+        return;
+    }
+    cv_waiter self;
+    atomic_init(&self.state, CV_WAITING);
+    self.ticket = -1;
+    self.ext_lock = ext_lock;
+    self.next = NULL;
+    self.successor = NULL;
+
     ticketlock_acquire(&cv->lock); // Locks the condition variable internal lock.
-    atomic_fetch_add(&cv->waiting, 1); // Increase waiting threads number.
+    if (cv->tail == NULL) { // Append to the FIFO of waiters.
+        cv->head = cv->tail = &self;
+    } else {
+        cv->tail->next = &self;
+        cv->tail = &self;
+    }
+    atomic_fetch_add_explicit(&cv->waiting, 1, memory_order_relaxed); // Increase waiting threads number (a statistic, the list is under cv->lock).
     ticketlock_release(&cv->lock);
     ticketlock_release(ext_lock); // Release external lock.
-    sched_yield(); // Simulate waiting.
-    ticketlock_acquire(ext_lock); // After being signaled, reacquire before proceeding.
+
+    // Spin for the learned budget, then sleep until granted.
+    // A requeued waiter is woken by the ext_lock release serving it.
+    long parks = 0;
+    long long start;
+    if (!sync_adaptive_spin_until(&cv->spin, &self.state, CV_GRANTED, &start)) {
+        int expected = CV_WAITING;
+        // Failure means we were granted meanwhile: acquire, like the loads, to see our ticket.
+        if (atomic_compare_exchange_strong_explicit(&self.state, &expected, CV_PARKED,
+                                                    memory_order_acquire, memory_order_acquire)) {
+            while (atomic_load_explicit(&self.state, memory_order_acquire) != CV_GRANTED) {
+                sync_futex_wait(&self.state, CV_PARKED, SYNC_BITSET_ALL, SYNC_PRIVATE, NULL);
+                parks++;
+            }
+            unsigned cur = (unsigned)atomic_load_explicit(&ext_lock->cur_ticket, memory_order_relaxed);
+            if ((int)(cur - (unsigned)self.ticket) < 0) { // Tickets wrap, hence the unsigned difference.
+                parks++; // Woken before our turn: this sleep will have to be repeated (or spun out).
+            }
+            atomic_fetch_sub_explicit(&ext_lock->sleepers, 1, memory_order_relaxed); // Taken for us by grant_waiter.
+        }
+        sync_adaptive_record(&cv->spin, start);
+    }
+    parks += ticketlock_wait_turn(ext_lock, self.ticket); // Usually already our turn.
+    atomic_fetch_add_explicit(&cv->parks, parks, memory_order_relaxed);
+    if (self.successor != NULL) {
+        hand_over(cv, self.successor); // Its ticket is served by our release, so it is the only one woken.
+    }
 }
 
 /**
  * Wakes up one thread waiting on the condition variable, if any.
- * Decrements the waiting counter and simulates waking one thread.
+ * Dequeues the oldest waiter and hands it a ticket on its external lock.
  * @param cv Pointer to the condition variable.
  */
 void condition_variable_signal(condition_variable* cv) {
+    sync_event_post(&cv->ready); // One load unless an event loop registered.
+    if (cv->flags == SYNC_SHARED) {
+        shared_wake(cv, 1);
+        return;
+    }
     ticketlock_acquire(&cv->lock);
+    cv_waiter* w = cv->head;
     // Checks for waiting threads.
-    if (atomic_load(&cv->waiting) > 0) {
-        // Decreasing for "waking" one thread.
-        atomic_fetch_sub(&cv->waiting, 1);
+    if (w != NULL) {
+        cv->head = w->next;
+        if (cv->head == NULL) {
+            cv->tail = NULL;
+        }
+        // Decreasing for waking one thread.
+        atomic_fetch_sub_explicit(&cv->waiting, 1, memory_order_relaxed);
     }
     // Release condition variable internal lock.
     ticketlock_release(&cv->lock);
+    if (w != NULL) {
+        grant_waiter(cv, w);
+    }
 }
 
 /**
  * Wakes up all threads waiting on the condition variable.
- * Resets the waiting counter to 0, simulating waking all threads.
+ * Detaches the whole waiter list and hands out consecutive tickets in FIFO order,
+ * so the woken threads acquire the external lock one after another without contending.
+ * Only the first waiter of each run on the same external lock is handed over here; each
+ * hands over its successor once it holds the lock, so at most one requeued waiter sits on
+ * the lock at a time and each wakes once, at its turn, rather than at every release.
  * @param cv Pointer to the condition variable.
  */
 void condition_variable_broadcast(condition_variable* cv) {
+    sync_event_post(&cv->ready);
+    if (cv->flags == SYNC_SHARED) {
+        shared_wake(cv, SYNC_WAKE_ALL);
+        return;
+    }
     ticketlock_acquire(&cv->lock);
-    atomic_store(&cv->waiting, 0); // Reset waiting counter to 0 means all threads woke up.
+    cv_waiter* w = cv->head;
+    cv->head = cv->tail = NULL;
+    atomic_store_explicit(&cv->waiting, 0, memory_order_relaxed); // Reset waiting counter to 0 means all threads woke up.
     ticketlock_release(&cv->lock);
+    while (w != NULL) {
+        cv_waiter* last = w; // End of the run of waiters on w's external lock.
+        int run = 1;
+        while (last->next != NULL && last->next->ext_lock == w->ext_lock) {
+            last = last->next;
+            run++;
+        }
+        cv_waiter* rest = last->next; // Read before granting - the run may vanish right after.
+        unsigned ticket = (unsigned)ticketlock_take_tickets(w->ext_lock, run); // Unsigned: the counter wraps.
+        for (cv_waiter* v = w; v != rest; v = v->next) { // Published by each predecessor's hand_over.
+            v->ticket = (int)ticket++;
+            v->successor = v == last ? NULL : v->next;
+        }
+        hand_over(cv, w);
+        w = rest;
+    }
+}
+
+/**
+ * Registers an event loop for the next signal or broadcast. Called under the external
+ * lock, so a signaller that changes the predicate later sees the registration.
+ * @param cv Pointer to the condition variable.
+ */
+void condition_variable_register(condition_variable* cv) {
+    sync_event_arm(&cv->ready);
+}
+
+/**
+ * Returns the readiness eventfd, created on first use.
+ * @param cv Pointer to the condition variable.
+ * @return The fd, or -1 on failure.
+ */
+int condition_variable_event_fd(condition_variable* cv) {
+    return sync_event_fd(&cv->ready);
+}
+
+/**
+ * Reports the handoff statistics of the condition variable.
+ * @param cv Pointer to the condition variable.
+ * @param handoffs Out: waiters transferred onto their external lock.
+ * @param parks Out: times those waiters slept in the kernel.
+ * @param spin_ns Out: nanoseconds a waiter currently spins before parking.
+ */
+void condition_variable_stats(condition_variable* cv, long* handoffs, long* parks, long* spin_ns) {
+    *handoffs = atomic_load_explicit(&cv->handoffs, memory_order_relaxed);
+    *parks = atomic_load_explicit(&cv->parks, memory_order_relaxed);
+    *spin_ns = sync_adaptive_budget(&cv->spin);
 }
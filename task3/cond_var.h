@@ -3,14 +3,43 @@
 
 #include <stdatomic.h>
 #include "ticket_lock.h"
+#include "sync_wait.h" // For sync_adaptive.
+#include "sync_event.h" // Readiness for event-loop callers.
+
+#define CV_WAITING 0 // Queued, still running.
+#define CV_PARKED 1 // Queued, may be asleep in the kernel.
+#define CV_GRANTED 2 // Dequeued by a signaller and holding a ticket on ext_lock.
+
+/*
+ * A waiting thread, linked into the condition variable while it sleeps.
+ * Lives on the waiter's stack for the duration of condition_variable_wait.
+ */
+typedef struct cv_waiter {
+    atomic_int state; // CV_WAITING, CV_PARKED or CV_GRANTED.
+    int ticket; // Ticket taken on ext_lock by the signaller, valid once granted.
+    ticket_lock* ext_lock; // The external lock the waiter will return holding.
+    struct cv_waiter* next; // Next waiter in FIFO order.
+    struct cv_waiter* successor; // Broadcast: holds the next ticket; handed its turn by this waiter once it has the lock.
+} cv_waiter;
 
 /*
  * Define the condition variable type.
  * Write your struct details in this file.
+ * A process-shared condition variable can't link waiters that live on other processes'
+ * stacks, so it leaves the list empty and waits on 'seq' instead: waiters sleep until a
+ * signal bumps it and then reacquire the external lock themselves (no wait morphing).
  */
 typedef struct {
     ticket_lock lock; // Ticket lock for protecting the condition variable.
-    atomic_int waiting; // Counter tracking the waiting threads.
+    atomic_int waiting; // Counter tracking the waiting threads (shared: those asleep on 'seq').
+    atomic_int seq; // Shared: bumped by every signal and broadcast.
+    int flags; // SYNC_PRIVATE, or SYNC_SHARED when processes share the condition variable.
+    sync_event ready; // Posted by signals and broadcasts while an event loop is registered.
+    cv_waiter* head; // Oldest waiter (signaled first).
+    cv_waiter* tail; // Newest waiter.
+    atomic_long handoffs; // Waiters transferred straight onto their external lock.
+    atomic_long parks; // Times a waiter slept in the kernel (roughly its context switches).
+    sync_adaptive spin; // Learned spin budget before a waiter parks.
 } condition_variable ;
 
 /*
@@ -18,12 +47,38 @@ typedef struct {
  */
 void condition_variable_init(condition_variable* cv);
 
+/*
+ * Initializes a condition variable in memory shared between processes; the external
+ * locks used with it must be process-shared too.
+ */
+void condition_variable_init_shared(condition_variable* cv);
+
+/*
+ * Closes the condition variable's eventfd, if one was created. No thread may wait on it,
+ * be registered on it or poll its fd any more.
+ */
+void condition_variable_destroy(condition_variable* cv);
+
 /*
  * Causes the calling thread to wait on the condition variable 'cv'.
  * The thread should release the external lock 'ext_lock' while waiting and reacquire it before returning.
  */
 void condition_variable_wait(condition_variable* cv, ticket_lock* ext_lock);
 
+/*
+ * For event loops that can't block in condition_variable_wait: call while holding the
+ * external lock, after finding the predicate false, then release the lock as usual.
+ * condition_variable_event_fd becomes readable at the next signal or broadcast; read it,
+ * take the lock (ticketlock_try_acquire) and recheck the predicate, registering again if
+ * it is still false. A signal also wakes a blocked thread, so loops may see spurious readiness.
+ */
+void condition_variable_register(condition_variable* cv);
+
+/*
+ * Returns the eventfd of condition_variable_register (poll it for EPOLLIN), -1 on failure.
+ */
+int condition_variable_event_fd(condition_variable* cv);
+
 /*
  * Wakes up one thread waiting on the condition variable 'cv'.
  */
@@ -34,4 +89,11 @@ void condition_variable_signal(condition_variable* cv);
  */
 void condition_variable_broadcast(condition_variable* cv);
 
+/*
+ * Reports how many waiters were handed off to their external lock and how many
+ * times they slept in the kernel on the way; parks / handoffs is the number of
+ * context switches per handoff, and the waiters' current spin budget in nanoseconds.
+ */
+void condition_variable_stats(condition_variable* cv, long* handoffs, long* parks, long* spin_ns);
+
 #endif // COND_VAR_H
@@ -1,16 +1,129 @@
 #include "rw_lock.h"
-#include <sched.h> // For sched_yield()
+#include "sync_wait.h" // Spin policy and futex wait/wake.
+
+/*
+ * Memory ordering: the checks and updates of the counters run under the internal ticket
+ * lock, whose acquire/release orders them, so the counters they touch are relaxed.
+ * The exceptions are updates made outside the lock: a reader's
+ * exit and a writer's arrival in waiting_writers (a seq_cst store->load pair, so either
+ * the writer's sum sees the exit or the exiting reader sees the writer and notifies),
+ * and 'changes' (seq_cst, the sleeper handshake of sync_wait.h), which also orders the
+ * readiness post after it (sync_event.h).
+ */
+
+/**
+ * Reader entry, under the internal lock: succeeds if no writer is active or waiting.
+ * @param lock The rwlock.
+ * @return 1 if entered, 0 to retry.
+ */
+static int rw_try_read_op(rwlock* lock) {
+    if (atomic_load_explicit(&lock->writers, memory_order_relaxed) == 0
+        && atomic_load_explicit(&lock->waiting_writers, memory_order_relaxed) == 0) { // Check that no writer is active or waiting.
+        sharded_counter_add(&lock->readers, 1); // Increment reader count.
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Writer entry, under the internal lock: succeeds if there are no readers and no writer.
+ * @param lock The rwlock.
+ * @return 1 if entered, 0 to retry.
+ */
+static int rw_try_write_op(rwlock* lock) {
+    // The sum may miss exits in flight but never an entry (entries hold the lock), so 0 is exact.
+    if (sharded_counter_sum(&lock->readers) == 0
+        && atomic_load_explicit(&lock->writers, memory_order_relaxed) == 0) {
+        atomic_store_explicit(&lock->writers, 1, memory_order_relaxed); // New writer.
+        atomic_fetch_sub_explicit(&lock->waiting_writers, 1, memory_order_relaxed); // No longer waiting.
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Single writer attempt, under the internal lock: like rw_try_write_op, for a writer
+ * that never announced itself in waiting_writers.
+ * @param lock The rwlock.
+ * @return 1 if entered, 0 if the lock is busy.
+ */
+static int rw_try_write_now_op(rwlock* lock) {
+    if (sharded_counter_sum(&lock->readers) == 0
+        && atomic_load_explicit(&lock->writers, memory_order_relaxed) == 0) {
+        atomic_store_explicit(&lock->writers, 1, memory_order_relaxed);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Writer exit, under the internal lock.
+ * @param lock The rwlock.
+ * @return 1.
+ */
+static int rw_release_write_op(rwlock* lock) {
+    atomic_store_explicit(&lock->writers, 0, memory_order_relaxed); // Clear writer flag.
+    return 1;
+}
 
 /** 
  * Initializes the read-write lock structure.
- * Sets the readers count, writer flag, and spinlock to initial values.
+ * Sets the readers count, writer flag, and internal ticket lock to initial values.
  * @param lock Pointer to the rwlock structure to initialize.
  */
 void rwlock_init(rwlock* lock) {
     ticketlock_init(&lock->lock); // Initialize internal ticket lock.
-    atomic_init(&lock->readers, 0); // No active readers.
+    sharded_counter_init(&lock->readers); // No active readers.
     atomic_init(&lock->writers, 0); // No active writer.
     atomic_init(&lock->waiting_writers, 0); // No waiting writers initially.
+    atomic_init(&lock->changes, 0);
+    atomic_init(&lock->sleepers, 0);
+    sync_adaptive_init(&lock->read_spin);
+    sync_adaptive_init(&lock->write_spin);
+    lock->flags = SYNC_PRIVATE;
+    sync_event_init(&lock->ready);
+}
+
+/**
+ * Initializes a process-shared read-write lock (see rw_lock.h).
+ * @param lock Pointer to the rwlock, inside a MAP_SHARED mapping.
+ */
+void rwlock_init_shared(rwlock* lock) {
+    rwlock_init(lock);
+    ticketlock_init_shared(&lock->lock);
+    lock->flags = SYNC_SHARED;
+}
+
+/**
+ * Releases what the lock owns: the eventfd, if one was created.
+ * @param lock Pointer to the rwlock, no longer held or waited for.
+ */
+void rwlock_destroy(rwlock* lock) {
+    sync_event_destroy(&lock->ready);
+}
+
+/**
+ * Runs a check-and-update of the counters under the internal ticket lock.
+ * @param lock Pointer to the rwlock structure.
+ * @param op The operation.
+ * @return The operation's result.
+ */
+static int rw_execute(rwlock* lock, int (*op)(rwlock*)) {
+    ticketlock_acquire(&lock->lock);
+    int result = op(lock);
+    ticketlock_release(&lock->lock);
+    return result;
+}
+
+/**
+ * Announces that the lock may have become free and wakes every blocked thread,
+ * each of which retries its entry.
+ * @param lock Pointer to the rwlock structure.
+ */
+void rwlock_notify(rwlock* lock) {
+    atomic_fetch_add_explicit(&lock->changes, 1, memory_order_seq_cst); // Precedes sync_wake's sleepers load.
+    sync_wake(&lock->changes, SYNC_WAKE_ALL, &lock->sleepers, lock->flags);
+    sync_event_post(&lock->ready);
 }
 
 /**
@@ -18,62 +131,110 @@ void rwlock_init(rwlock* lock) {
  * Allows multiple readers to enter concurrently as long as no writer holds the lock.
  * Prevents reader preference by blocking new readers if writers are waiting,
  * ensuring fairness and preventing writer starvation.
- * Uses double-checking to ensure consistency when incrementing the reader count.
+ * The check and the increment run under the internal lock, so they stay consistent.
  * @param lock Pointer to the rwlock structure.
  */
 void rwlock_acquire_read(rwlock* lock) {
     while (1) {
-        ticketlock_acquire(&lock->lock); 
-        if (atomic_load(&lock->writers) == 0 && atomic_load(&lock->waiting_writers) == 0) { // Check that no writer is active or waiting.
-            atomic_fetch_add(&lock->readers, 1); // Increment reader count.
-            ticketlock_release(&lock->lock); // First we acquire, now we release.
-            break; // Exiting infinite loop.
+        int seen = atomic_load_explicit(&lock->changes, memory_order_acquire); // Read before trying, so a release in between isn't missed.
+        if (rw_execute(lock, rw_try_read_op) == 1) {
+            break;
         }
-        ticketlock_release(&lock->lock); // If writer is active (means we didn't entered the first block).
-        sched_yield(); // Use sched_yield() to avoid busy-waiting and allow other threads to run.
+        // A writer is active or waiting - spin for the readers' learned budget, then sleep until the next release.
+        sync_adaptive_wait_while(&lock->read_spin, &lock->changes, seen, &lock->sleepers, lock->flags, NULL);
     }
 }
 
-/**
- * Releases the lock after reading.
- * Decrements the readers count atomically.
- * No need for additional synchronization here since the readers count is managed atomically,
- * and writers wait until all readers finish before acquiring the lock.
- * @param lock Pointer to the rwlock structure.
- */
-void rwlock_release_read(rwlock* lock) {
-    atomic_fetch_sub(&lock->readers, 1);
-}
-
 /**
  * Acquires the lock for writing.
  * Ensures exclusive access by waiting for all readers and other writers to finish.
  * Implements fairness by tracking waiting writers, which blocks new readers until writers finish.
- * Uses double-checking and a spinlock to ensure mutual exclusion.
+ * The check and the update run under the internal lock to ensure mutual exclusion.
  * @param lock Pointer to the rwlock structure.
  */
 void rwlock_acquire_write(rwlock* lock) {
-    atomic_fetch_add(&lock->waiting_writers, 1); // Wants to acquire write -> waiting.
+    atomic_fetch_add_explicit(&lock->waiting_writers, 1, memory_order_seq_cst); // Wants to acquire write -> waiting (seq_cst: see above).
     while (1) {
-        ticketlock_acquire(&lock->lock); 
-        if (atomic_load(&lock->readers) == 0 && atomic_load(&lock->writers) == 0) {
-            atomic_store(&lock->writers, 1); // New writer.
-            atomic_fetch_sub(&lock->waiting_writers, 1); // No longer waiting.
-            ticketlock_release(&lock->lock);
+        int seen = atomic_load_explicit(&lock->changes, memory_order_acquire);
+        if (rw_execute(lock, rw_try_write_op) == 1) {
             break;
         }
-    ticketlock_release(&lock->lock);
-    sched_yield();
+        sync_adaptive_wait_while(&lock->write_spin, &lock->changes, seen, &lock->sleepers, lock->flags, NULL);
     }
 }
 
 /**
  * Releases the lock after writing.
- * Clears the writer flag to allow readers or another writer to proceed.
+ * Clears the writer flag to allow readers or another writer to proceed, and wakes them.
  * @param lock Pointer to the rwlock structure.
  */
 void rwlock_release_write(rwlock* lock) {
-    ticketlock_acquire(&lock->lock); 
-    atomic_store(&lock->writers, 0); // Clear writer flag.
-    ticketlock_release(&lock->lock);
+    rw_execute(lock, rw_release_write_op);
+    rwlock_notify(lock);
+}
+
+/**
+ * Tries once to acquire the lock for reading.
+ * @param lock Pointer to the rwlock structure.
+ * @return 1 if acquired, 0 if a writer is active or waiting.
+ */
+int rwlock_try_acquire_read(rwlock* lock) {
+    return rw_execute(lock, rw_try_read_op) == 1;
+}
+
+/**
+ * Tries once to acquire the lock for writing.
+ * @param lock Pointer to the rwlock structure.
+ * @return 1 if acquired, 0 if readers or a writer hold it.
+ */
+int rwlock_try_acquire_write(rwlock* lock) {
+    return rw_execute(lock, rw_try_write_now_op) == 1;
+}
+
+/**
+ * Acquires for reading or registers for readiness. The retry after arming catches a
+ * release that came between the first try and the arm.
+ * @param lock Pointer to the rwlock structure.
+ * @return 1 if acquired, 0 if registered.
+ */
+int rwlock_acquire_read_or_register(rwlock* lock) {
+    if (rwlock_try_acquire_read(lock)) {
+        return 1;
+    }
+    sync_event_arm(&lock->ready);
+    return rwlock_try_acquire_read(lock);
+}
+
+/**
+ * Acquires for writing or registers for readiness (see rwlock_acquire_read_or_register).
+ * @param lock Pointer to the rwlock structure.
+ * @return 1 if acquired, 0 if registered.
+ */
+int rwlock_acquire_write_or_register(rwlock* lock) {
+    if (rwlock_try_acquire_write(lock)) {
+        return 1;
+    }
+    sync_event_arm(&lock->ready);
+    return rwlock_try_acquire_write(lock);
+}
+
+/**
+ * Returns the readiness eventfd, created on first use.
+ * @param lock Pointer to the rwlock structure.
+ * @return The fd, or -1 on failure.
+ */
+int rwlock_event_fd(rwlock* lock) {
+    return sync_event_fd(&lock->ready);
+}
+
+/**
+ * Reports the learned spin budgets. Readers and writers keep separate estimates:
+ * a reader waits out one writer, a writer may wait out a whole group of readers.
+ * @param lock Pointer to the rwlock structure.
+ * @param read_spin_ns Out: nanoseconds a blocked reader spins before sleeping.
+ * @param write_spin_ns Out: nanoseconds a blocked writer spins before sleeping.
+ */
+void rwlock_stats(rwlock* lock, long* read_spin_ns, long* write_spin_ns) {
+    *read_spin_ns = sync_adaptive_budget(&lock->read_spin);
+    *write_spin_ns = sync_adaptive_budget(&lock->write_spin);
 }
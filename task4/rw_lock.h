@@ -3,16 +3,28 @@
 
 #include <stdatomic.h>
 #include "ticket_lock.h"  // Include ticket_lock for the internal lock
+#include "sync_wait.h" // For sync_adaptive.
+#include "sharded_counter.h" // Per-CPU reader count.
+#include "sync_event.h" // Readiness for event-loop callers.
 
 /*
  * Define the read-write lock type.
  * Write your struct details in this file..
  */
 typedef struct {
-    ticket_lock lock; // For synchronizing access to the counters.
-    atomic_int readers; // Active readers (can be multiple).
+    ticket_lock lock; // Serializes the checks and updates of the counters.
+    sharded_counter readers; // Active readers (can be multiple), sharded so concurrent exits don't share a line.
     atomic_int writers; // 0 or 1 for showing if a writer holds the lock.
-    atomic_int waiting_writers; // Number of writers waiting - for considering fairness and preventing "writer starvation".
+    // Number of writers waiting - for considering fairness and preventing "writer starvation".
+    // A single word on purpose: every reader entry and exit reads it, which must stay one load,
+    // and only (rare) writers update it.
+    atomic_int waiting_writers;
+    atomic_int changes; // Bumped whenever the lock may have become free; blocked threads sleep on it.
+    atomic_int sleepers; // Threads asleep on 'changes'.
+    sync_adaptive read_spin; // Learned spin budget of blocked readers (they wait out writers).
+    sync_adaptive write_spin; // Learned spin budget of blocked writers (they wait out readers too).
+    int flags; // SYNC_PRIVATE, or SYNC_SHARED when processes share the lock.
+    sync_event ready; // Posted whenever the lock may have become free, while an event loop is registered.
 } rwlock;
 
 /*
@@ -20,15 +32,61 @@ typedef struct {
  */
 void rwlock_init(rwlock* lock);
 
+/*
+ * Initializes a read-write lock in memory shared between processes.
+ */
+void rwlock_init_shared(rwlock* lock);
+
+/*
+ * Closes the lock's eventfd, if one was created. No thread may hold, wait for or poll
+ * the lock any more.
+ */
+void rwlock_destroy(rwlock* lock);
+
 /*
  * Acquires the lock for reading.
  */
 void rwlock_acquire_read(rwlock* lock);
 
 /*
- * Releases the lock after reading.
+ * Single attempts: return 1 if the lock was taken, 0 otherwise. A try-writer doesn't
+ * count as a waiting writer, so it never holds readers back.
  */
-void rwlock_release_read(rwlock* lock);
+int rwlock_try_acquire_read(rwlock* lock);
+int rwlock_try_acquire_write(rwlock* lock);
+
+/*
+ * For event loops that can't block: take the lock if possible (return 1), otherwise
+ * register interest (return 0); rwlock_event_fd becomes readable the next time the
+ * lock may have become free. Then read the fd and call again.
+ */
+int rwlock_acquire_read_or_register(rwlock* lock);
+int rwlock_acquire_write_or_register(rwlock* lock);
+
+/*
+ * Returns the eventfd of the *_or_register calls (poll it for EPOLLIN), -1 on failure.
+ */
+int rwlock_event_fd(rwlock* lock);
+
+/*
+ * Announces that the lock may have become free and wakes the blocked threads (slow path).
+ */
+void rwlock_notify(rwlock* lock);
+
+/*
+ * Releases the lock after reading. A sharded exit can't tell whether it was the last one,
+ * so readers notify whenever a writer waits; without waiting writers nobody is blocked.
+ */
+static inline void rwlock_release_read(rwlock* lock) {
+    // seq_cst decrement (also a release of the section's reads) then seq_cst load: pairs with
+    // a writer announcing itself in waiting_writers before it sums the readers.
+    sharded_counter_add(&lock->readers, -1);
+    if (atomic_load_explicit(&lock->waiting_writers, memory_order_seq_cst) > 0) {
+        rwlock_notify(lock);
+    } else {
+        sync_event_post(&lock->ready); // A registered try-writer may get in now (one load if none is).
+    }
+}
 
 /*
  * Acquires the lock for writing. This operation should ensure exclusive access.
@@ -40,4 +98,9 @@ void rwlock_acquire_write(rwlock* lock);
  */
 void rwlock_release_write(rwlock* lock);
 
+/*
+ * Reports the current spin budgets of blocked readers and writers, in nanoseconds.
+ */
+void rwlock_stats(rwlock* lock, long* read_spin_ns, long* write_spin_ns);
+
 #endif // RW_LOCK_H
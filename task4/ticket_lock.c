@@ -1,31 +0,0 @@
-#include <stdatomic.h>
-#include <sched.h> // For sched_yield().
-
-typedef struct
-{
-    atomic_int ticket;
-    atomic_int cur_ticket;
-} ticket_lock;
-
-void ticketlock_init(ticket_lock* lock)
-{
-    atomic_init(&lock->ticket, 0);
-    atomic_init(&lock->cur_ticket, 0);
-}
-
-void ticketlock_acquire(ticket_lock* lock)
-{
-    // get my ticket
-    int my_ticket = atomic_fetch_add(&lock->ticket, 1);
-
-    // wait until it is my turn
-    while (atomic_load(&lock->cur_ticket) != my_ticket)
-    {
-        sched_yield();
-    }
-}
-
-void ticketlock_release(ticket_lock* lock)
-{
-    atomic_fetch_add(&lock->cur_ticket, 1);
-}
@@ -1,9 +1,19 @@
 #include "local_storage.h"
-#include "ticket_lock.h"
+#include "fc.h" // Flat combining.
 #include <stdio.h>  // For printf.
 #include <stdlib.h> // For exit.
 
-ticket_lock tls_lock; // Protect access to the global g_tls array.
+fc_lock tls_fc; // Serializes (and batches) every access to the global g_tls array.
+
+#define TLS_OK ((void*)0) // Operation done.
+#define TLS_MISSING ((void*)1) // The calling thread has no entry.
+#define TLS_FULL ((void*)2) // No free entry left.
+
+// Argument of a combined g_tls operation.
+typedef struct {
+    int64_t tid; // The calling thread's ID (the combiner may be another thread).
+    void* data; // set: the new data. get: out, the stored data.
+} tls_request;
 
 /*
  * Global TLS array for storing thread-specific data.
@@ -15,43 +25,131 @@ tls_data_t g_tls[MAX_THREADS];
 /**
  * Initializes the global TLS array.
  * Sets each entry's thread_id to -1 (unused) and data to NULL.
- * Also initializes the ticket lock for synchronization.
+ * Also initializes the flat-combining wrapper for synchronization.
  */
 void init_storage(void) {
-    ticketlock_init(&tls_lock); // Initialize the lock protecting g_tls.
+    fc_init(&tls_fc, g_tls); // Initialize the wrapper protecting g_tls.
     for (int i = 0; i < MAX_THREADS; i++) {
         g_tls[i].thread_id = -1; // Mark slot as unused.
         g_tls[i].data = NULL; // Clears the data pointer.
     }
 }
 
+/**
+ * Finds the entry of a thread. Must run under tls_fc.
+ * @param tls The g_tls array.
+ * @param tid The thread's ID.
+ * @return The entry, or NULL if the thread has none.
+ */
+static tls_data_t* tls_find(tls_data_t* tls, int64_t tid) {
+    for (int i = 0; i < MAX_THREADS; i++) {
+        if (tls[i].thread_id == tid) {
+            return &tls[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Combined allocation: claims a free entry unless the thread already has one.
+ * @param ctx The g_tls array.
+ * @param arg Pointer to the tls_request.
+ * @return TLS_OK or TLS_FULL.
+ */
+static void* tls_alloc_op(void* ctx, void* arg) {
+    tls_data_t* tls = ctx;
+    tls_request* req = arg;
+    // Check's if the thread already has an allocated slot in the array.
+    if (tls_find(tls, req->tid) != NULL) {
+        return TLS_OK;
+    }
+    // If we reached here we still need to find a slot.
+    tls_data_t* entry = tls_find(tls, -1);
+    if (entry == NULL) {
+        return TLS_FULL;
+    }
+    entry->thread_id = req->tid; // Assign the entry thread_id to the current ID.
+    return TLS_OK;
+}
+
+/**
+ * Combined lookup of the thread's data.
+ * @param ctx The g_tls array.
+ * @param arg Pointer to the tls_request; its data is set to the stored pointer.
+ * @return TLS_OK or TLS_MISSING.
+ */
+static void* tls_get_op(void* ctx, void* arg) {
+    tls_request* req = arg;
+    tls_data_t* entry = tls_find(ctx, req->tid);
+    if (entry == NULL) {
+        return TLS_MISSING;
+    }
+    req->data = entry->data; // Retrieve data.
+    return TLS_OK;
+}
+
+/**
+ * Combined update of the thread's data.
+ * @param ctx The g_tls array.
+ * @param arg Pointer to the tls_request holding the new data.
+ * @return TLS_OK or TLS_MISSING.
+ */
+static void* tls_set_op(void* ctx, void* arg) {
+    tls_request* req = arg;
+    tls_data_t* entry = tls_find(ctx, req->tid);
+    if (entry == NULL) {
+        return TLS_MISSING;
+    }
+    entry->data = req->data; // Set's the data.
+    return TLS_OK;
+}
+
+/**
+ * Combined lookup of the thread's entry index.
+ * @param ctx The g_tls array.
+ * @param arg Pointer to the tls_request; its data is set to the index.
+ * @return TLS_OK or TLS_MISSING.
+ */
+static void* tls_index_op(void* ctx, void* arg) {
+    tls_request* req = arg;
+    tls_data_t* entry = tls_find(ctx, req->tid);
+    if (entry == NULL) {
+        return TLS_MISSING;
+    }
+    req->data = (void*)(intptr_t)(entry - (tls_data_t*)ctx);
+    return TLS_OK;
+}
+
+/**
+ * Combined release of the thread's entry.
+ * @param ctx The g_tls array.
+ * @param arg Pointer to the tls_request.
+ * @return TLS_OK or TLS_MISSING.
+ */
+static void* tls_free_op(void* ctx, void* arg) {
+    tls_request* req = arg;
+    tls_data_t* entry = tls_find(ctx, req->tid);
+    if (entry == NULL) {
+        return TLS_MISSING;
+    }
+    entry->thread_id = -1;
+    entry->data = NULL;
+    return TLS_OK;
+}
+
 /**
  * Allocates a TLS (Thread-Local Storage) entry for the calling thread.
  * Ensures that each thread gets a unique slot in the global TLS array (g_tls).
- * Uses a ticket lock to synchronize access to the shared g_tls array.
+ * The search runs through tls_fc, so concurrent calls are batched by one combiner.
  * If the thread already has an allocated slot, the function returns immediately.
  */
 void tls_thread_alloc(void) {
-    int64_t tid = (int64_t)pthread_self(); // Get's the calling thread's ID.
-    ticketlock_acquire(&tls_lock); // Acquiring the global lock.
-    // Check's if the thread already has an allocated slot in the array.
-    for (int i = 0; i < MAX_THREADS; i++) {
-        if (g_tls[i].thread_id == tid) {
-            ticketlock_release(&tls_lock); // if found -> release lock.
-            return;
-        }
-    } 
-    // If we reached here we still need to find a slot.
-    for (int i = 0; i < MAX_THREADS; i++) {
-        if (g_tls[i].thread_id == -1) { // Means we got place.
-            g_tls[i].thread_id = tid; // Assign the entry thread_id to the current ID.
-            ticketlock_release(&tls_lock); // if we assign successfully -> release.
-            return;
-        }
+    tls_request req = { (int64_t)pthread_self(), NULL }; // Get's the calling thread's ID.
+    if (fc_execute(&tls_fc, tls_alloc_op, &req) == TLS_FULL) {
+        // If we reached here there is no free space.
+        printf("thread [%ld] failed to initialize, not enough space\n", req.tid);
+        exit(1);
     }
-    // If we reached here there is no free space.
-    printf("thread [%ld] failed to initialize, not enough space\n", tid);
-    exit(1);
 }
 
 /**
@@ -59,23 +157,16 @@ void tls_thread_alloc(void) {
  * Searches the global TLS array (g_tls) for the entry corresponding to the calling thread.
  * If found, returns the associated data pointer.
  * If the thread has not been initialized in the TLS, prints an error message and exits with code 2.
- * Uses the ticket lock to ensure synchronized access to g_tls.
+ * Uses tls_fc to ensure synchronized access to g_tls.
  */
 void* get_tls_data(void) {
-    int64_t tid = (int64_t)pthread_self(); // Get's the calling thread's ID.
-    ticketlock_acquire(&tls_lock); // Acquiring the global lock.
-    // Search for the calling thread entry.
-    for (int i = 0; i < MAX_THREADS; i++) {
-        if (g_tls[i].thread_id == tid) {
-            void* data = g_tls[i].data; // Retrieve data.
-            ticketlock_release(&tls_lock);
-            return data; 
-        }
+    tls_request req = { (int64_t)pthread_self(), NULL };
+    if (fc_execute(&tls_fc, tls_get_op, &req) == TLS_MISSING) {
+        // If we reached here no corresponding entry has been found.
+        printf("thread [%ld] hasn’t been initialized in the TLS\n", req.tid);
+        exit(2);
     }
-    // If we reached here no corresponding entry has been found.
-    printf("thread [%ld] hasn’t been initialized in the TLS\n", tid);
-    ticketlock_release(&tls_lock);
-    exit(2);
+    return req.data;
 }
 
 /**
@@ -83,24 +174,30 @@ void* get_tls_data(void) {
  * Searches the global TLS array (g_tls) for the entry corresponding to the calling thread.
  * If found, updates the data pointer.
  * If the thread has not been initialized in the TLS, prints an error message and exits with code 2.
- * Uses the ticket lock to ensure synchronized access to g_tls.
+ * Uses tls_fc to ensure synchronized access to g_tls.
  * @param data Pointer to the data to set for the calling thread's TLS entry.
  */
 void set_tls_data(void* data) {
-    int64_t tid = (int64_t)pthread_self(); // Get's the calling thread's ID.
-    ticketlock_acquire(&tls_lock); // Acquiring the global lock.
-    // Search for the calling thread entry.
-    for (int i = 0; i < MAX_THREADS; i++) {
-        if (g_tls[i].thread_id == tid) {
-            g_tls[i].data = data; // Set's the data.
-            ticketlock_release(&tls_lock);
-            return; 
-        }
+    tls_request req = { (int64_t)pthread_self(), data };
+    if (fc_execute(&tls_fc, tls_set_op, &req) == TLS_MISSING) {
+        // If we reached here no corresponding entry has been found.
+        printf("thread [%ld] hasn’t been initialized in the TLS\n", req.tid);
+        exit(2);
     }
-    // If we reached here no corresponding entry has been found.
-    printf("thread [%ld] hasn’t been initialized in the TLS\n", tid);
-    ticketlock_release(&tls_lock);
-    exit(2);
+}
+
+/**
+ * Returns the index of the calling thread's entry in g_tls.
+ * If the thread has not been initialized in the TLS, prints an error message and exits with code 2.
+ * @return The index, in [0, MAX_THREADS).
+ */
+int tls_thread_index(void) {
+    tls_request req = { (int64_t)pthread_self(), NULL };
+    if (fc_execute(&tls_fc, tls_index_op, &req) == TLS_MISSING) {
+        printf("thread [%ld] hasn’t been initialized in the TLS\n", req.tid);
+        exit(2);
+    }
+    return (int)(intptr_t)req.data;
 }
 
 /**
@@ -108,22 +205,15 @@ void set_tls_data(void* data) {
  * Searches the global TLS array (g_tls) for the entry corresponding to the calling thread.
  * If found, resets the thread ID to -1 and the data pointer to NULL.
  * If the thread has not been initialized in the TLS, prints an error message and exits with code 2.
- * Uses the ticket lock to ensure synchronized access to g_tls.
+ * Uses tls_fc to ensure synchronized access to g_tls, then gives back the thread's combining record.
  */
 void tls_thread_free(void) {
-    int64_t tid = (int64_t)pthread_self(); // Get's the calling thread's ID.
-    ticketlock_acquire(&tls_lock); // Acquiring the global lock.
-    // Search for the calling thread entry.
-    for (int i = 0; i < MAX_THREADS; i++) {
-        if (g_tls[i].thread_id == tid) {
-            g_tls[i].thread_id = -1;
-            g_tls[i].data = NULL;
-            ticketlock_release(&tls_lock);
-            return; 
-        }
+    tls_request req = { (int64_t)pthread_self(), NULL };
+    void* status = fc_execute(&tls_fc, tls_free_op, &req);
+    fc_thread_exit(&tls_fc); // The thread is leaving - let another one reuse its record.
+    if (status == TLS_MISSING) {
+        // If we reached here no corresponding entry has been found.
+        printf("thread [%ld] hasn’t been initialized in the TLS\n", req.tid);
+        exit(2);
     }
-    // If we reached here no corresponding entry has been found.
-    printf("thread [%ld] hasn’t been initialized in the TLS\n", tid);
-    ticketlock_release(&tls_lock);
-    exit(2);
 }
@@ -40,6 +40,12 @@ void* get_tls_data(void);
  */
 void set_tls_data(void* data);
 
+/*
+ * Returns the index of the calling thread's entry in g_tls (stable until tls_thread_free),
+ * so per-thread state elsewhere can live in arrays of MAX_THREADS slots.
+ */
+int tls_thread_index(void);
+
 /*
  * Frees the TLS entry for the calling thread.
  */
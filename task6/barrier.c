@@ -0,0 +1,130 @@
+#include "barrier.h"
+#include <stdlib.h>
+#include <string.h> // For memset().
+#include "sync_wait.h" // Spin policy and futex wait/wake.
+
+/**
+ * Shared part of both initializers.
+ */
+static void barrier_init_common(barrier* b, int parties) {
+    b->parties = parties;
+    atomic_init(&b->remaining, parties);
+    atomic_init(&b->generation, 0);
+    atomic_init(&b->waiters, 0);
+    b->fan_in = 0;
+    b->nnodes = 0;
+    b->nodes = NULL;
+}
+
+/**
+ * Initializes a central barrier.
+ * @param b Pointer to the barrier.
+ * @param parties Number of threads per episode.
+ */
+void barrier_init(barrier* b, int parties) {
+    barrier_init_common(b, parties);
+}
+
+/**
+ * Initializes a combining-tree barrier.
+ * Level 0 holds ceil(parties / fan_in) leaves; each level above has ceil(n / fan_in)
+ * nodes, up to a single root. Nodes are stored level by level.
+ * @param b Pointer to the barrier.
+ * @param parties Number of threads per episode.
+ * @param fan_in Arrivals combined per node (at least 2).
+ */
+void barrier_init_tree(barrier* b, int parties, int fan_in) {
+    barrier_init_common(b, parties);
+    if (fan_in < 2) {
+        fan_in = 2;
+    }
+    b->fan_in = fan_in;
+    // Count the nodes of all levels.
+    int total = 0;
+    for (int n = parties; ; n = (n + fan_in - 1) / fan_in) {
+        int level = (n + fan_in - 1) / fan_in;
+        total += level;
+        if (level == 1) {
+            break;
+        }
+    }
+    b->nodes = aligned_alloc(64, total * sizeof(barrier_node)); // calloc would only align to 16 bytes.
+    memset(b->nodes, 0, total * sizeof(barrier_node));
+    b->nnodes = total;
+    // Wire each level to the next.
+    int first = 0; // First node of the current level.
+    int children = parties; // Arrivals feeding the current level.
+    while (1) {
+        int level = (children + fan_in - 1) / fan_in;
+        for (int i = 0; i < level; i++) {
+            barrier_node* node = &b->nodes[first + i];
+            int expected = children - i * fan_in;
+            node->expected = expected < fan_in ? expected : fan_in;
+            atomic_init(&node->remaining, node->expected);
+            node->parent = level == 1 ? -1 : first + level + i / fan_in;
+        }
+        if (level == 1) {
+            break;
+        }
+        first += level;
+        children = level;
+    }
+}
+
+/**
+ * Frees the tree nodes.
+ * @param b Pointer to the barrier.
+ */
+void barrier_destroy(barrier* b) {
+    free(b->nodes);
+    b->nodes = NULL;
+}
+
+/**
+ * Releases the current episode: advances the generation and wakes sleepers.
+ */
+static void barrier_release(barrier* b) {
+    // seq_cst: releases the episode and precedes sync_wake's sleepers load.
+    atomic_fetch_add_explicit(&b->generation, 1, memory_order_seq_cst);
+    sync_wake(&b->generation, SYNC_WAKE_ALL, &b->waiters, SYNC_PRIVATE);
+}
+
+/**
+ * Arrives at the barrier and waits for the episode to complete.
+ * The generation is read before arriving, so a thread can never miss the release
+ * of its own episode. Counters are reset by the last arrival before the release,
+ * which makes the barrier immediately reusable.
+ * @param b Pointer to the barrier.
+ * @param id The calling thread's index (tree variant).
+ * @return 1 for the last thread to arrive, 0 for the others.
+ */
+int barrier_wait(barrier* b, int id) {
+    // Relaxed: sequenced before our (release) arrival, so it can't see our own episode's release.
+    int gen = atomic_load_explicit(&b->generation, memory_order_relaxed);
+    // Arrivals are acq_rel: each publishes the arriving thread's writes, and the last one
+    // acquires them all before releasing the episode.
+    if (b->nodes == NULL) {
+        if (atomic_fetch_sub_explicit(&b->remaining, 1, memory_order_acq_rel) == 1) {
+            atomic_store_explicit(&b->remaining, b->parties, memory_order_relaxed); // Published by the release.
+            barrier_release(b);
+            return 1;
+        }
+    } else {
+        int n = id / b->fan_in; // My leaf.
+        while (1) {
+            barrier_node* node = &b->nodes[n];
+            if (atomic_fetch_sub_explicit(&node->remaining, 1, memory_order_acq_rel) != 1) {
+                break; // Not last here - someone else carries the arrival up.
+            }
+            atomic_store_explicit(&node->remaining, node->expected, memory_order_relaxed);
+            if (node->parent < 0) {
+                barrier_release(b); // Last arrival at the root.
+                return 1;
+            }
+            n = node->parent;
+        }
+    }
+    // Spin briefly, then sleep until the generation moves on.
+    sync_wait_while(&b->generation, gen, &b->waiters, SYNC_PRIVATE, NULL);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef BARRIER_H
+#define BARRIER_H
+
+#include <stdatomic.h>
+
+/*
+ * Node of the combining tree: the last of its children to arrive moves up.
+ * One node per cache line (the alignment pads it to 64 bytes).
+ */
+typedef struct {
+    _Alignas(64) atomic_int remaining; // Arrivals still expected in this episode.
+    int expected; // Children (threads or nodes) feeding this node.
+    int parent; // Index of the parent node, -1 for the root.
+} barrier_node;
+
+/*
+ * Reusable sense-reversing barrier.
+ * The central variant has every thread decrement one counter; the combining-tree
+ * variant spreads arrivals over small nodes so that, with many threads, no single
+ * cache line takes every arrival. Waiters sleep on the generation ("sense") word,
+ * which the last arrival advances to release the episode.
+ */
+typedef struct {
+    int parties; // Threads taking part in each episode.
+    atomic_int remaining; // Central variant: arrivals still expected.
+    atomic_int generation; // Episode number; flips on release.
+    atomic_int waiters; // Threads that may be asleep on 'generation'.
+    int fan_in; // Tree variant: children per node (0 for the central variant).
+    int nnodes; // Tree variant: number of nodes (leaves first, root last).
+    barrier_node* nodes; // Tree variant: the nodes.
+} barrier;
+
+/*
+ * Initializes a central barrier for 'parties' threads.
+ */
+void barrier_init(barrier* b, int parties);
+
+/*
+ * Initializes a combining-tree barrier for 'parties' threads, 'fan_in' arrivals per node.
+ */
+void barrier_init_tree(barrier* b, int parties, int fan_in);
+
+/*
+ * Frees the tree nodes (no-op for the central variant).
+ */
+void barrier_destroy(barrier* b);
+
+/*
+ * Waits until all parties have arrived. 'id' (0..parties-1) picks the thread's leaf
+ * in the tree variant and is ignored by the central one.
+ * Returns 1 in exactly one thread per episode (the last to arrive), 0 in the others.
+ */
+int barrier_wait(barrier* b, int id);
+
+#endif // BARRIER_H
@@ -0,0 +1,127 @@
+#include "classify.h"
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CLASSIFY_X86 1
+#endif
+
+/*
+ * x is divisible by 6 = 2 * 3 exactly when rotr(x * inv3, 1) <= (2^64 - 1) / 6,
+ * where inv3 is the inverse of 3 modulo 2^64 (Granlund-Montgomery). It needs only a
+ * low 64-bit multiply, a rotate and an unsigned compare. x86 has no 64-bit vector
+ * multiply before AVX-512, so the vector versions build it from three 32x32->64 ones.
+ */
+#define DIV6_INV3 0xAAAAAAAAAAAAAAABull
+#define DIV6_LIMIT 0x2AAAAAAAAAAAAAAAull
+#define SIGN_BIT 0x8000000000000000ull // Flips unsigned order into signed order for the compare.
+
+typedef int (*classify_fn)(const int64_t* values, int n, int64_t* divisible);
+
+/**
+ * Portable implementation, also used for the tail of each vector block.
+ */
+static int classify_scalar(const int64_t* values, int n, int64_t* divisible) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t x = (uint64_t)values[i] * DIV6_INV3;
+        x = (x >> 1) | (x << 63);
+        if (x <= DIV6_LIMIT) {
+            divisible[count++] = values[i];
+        }
+    }
+    return count;
+}
+
+#ifdef CLASSIFY_X86
+/**
+ * Appends the values selected by 'mask' (one bit per lane) to 'divisible'.
+ */
+static int emit_lanes(const int64_t* values, unsigned mask, int64_t* divisible) {
+    int count = 0;
+    while (mask != 0) {
+        divisible[count++] = values[__builtin_ctz(mask)];
+        mask &= mask - 1;
+    }
+    return count;
+}
+
+/**
+ * SSE4.2 implementation: 2 values per step (pcmpgtq is SSE4.2).
+ */
+__attribute__((target("sse4.2")))
+static int classify_sse42(const int64_t* values, int n, int64_t* divisible) {
+    const __m128i inv_lo = _mm_set1_epi64x((int64_t)(DIV6_INV3 & 0xFFFFFFFFu));
+    const __m128i inv_hi = _mm_set1_epi64x((int64_t)(DIV6_INV3 >> 32));
+    const __m128i limit = _mm_set1_epi64x((int64_t)(DIV6_LIMIT ^ SIGN_BIT));
+    const __m128i sign = _mm_set1_epi64x((int64_t)SIGN_BIT);
+    int count = 0;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(values + i));
+        __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(v, 32), inv_lo), _mm_mul_epu32(v, inv_hi));
+        __m128i x = _mm_add_epi64(_mm_mul_epu32(v, inv_lo), _mm_slli_epi64(cross, 32));
+        x = _mm_or_si128(_mm_srli_epi64(x, 1), _mm_slli_epi64(x, 63));
+        __m128i over = _mm_cmpgt_epi64(_mm_xor_si128(x, sign), limit); // Unsigned x > limit.
+        unsigned mask = ~(unsigned)_mm_movemask_pd(_mm_castsi128_pd(over)) & 0x3;
+        count += emit_lanes(values + i, mask, divisible + count);
+    }
+    return count + classify_scalar(values + i, n - i, divisible + count);
+}
+
+/**
+ * AVX2 implementation: 4 values per step.
+ */
+__attribute__((target("avx2")))
+static int classify_avx2(const int64_t* values, int n, int64_t* divisible) {
+    const __m256i inv_lo = _mm256_set1_epi64x((int64_t)(DIV6_INV3 & 0xFFFFFFFFu));
+    const __m256i inv_hi = _mm256_set1_epi64x((int64_t)(DIV6_INV3 >> 32));
+    const __m256i limit = _mm256_set1_epi64x((int64_t)(DIV6_LIMIT ^ SIGN_BIT));
+    const __m256i sign = _mm256_set1_epi64x((int64_t)SIGN_BIT);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+        __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(v, 32), inv_lo),
+                                         _mm256_mul_epu32(v, inv_hi));
+        __m256i x = _mm256_add_epi64(_mm256_mul_epu32(v, inv_lo), _mm256_slli_epi64(cross, 32));
+        x = _mm256_or_si256(_mm256_srli_epi64(x, 1), _mm256_slli_epi64(x, 63));
+        __m256i over = _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign), limit); // Unsigned x > limit.
+        unsigned mask = ~(unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(over)) & 0xF;
+        count += emit_lanes(values + i, mask, divisible + count);
+    }
+    return count + classify_scalar(values + i, n - i, divisible + count);
+}
+#endif
+
+static classify_fn classify_impl = classify_scalar; // Selected by classify_init.
+
+/**
+ * Selects the implementation from CPUID.
+ * @return The name of the selected implementation.
+ */
+const char* classify_init(void) {
+#ifdef CLASSIFY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        classify_impl = classify_avx2;
+        return "avx2";
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        classify_impl = classify_sse42;
+        return "sse4.2";
+    }
+#endif
+    classify_impl = classify_scalar;
+    return "scalar";
+}
+
+/**
+ * Classifies a block of values with the selected implementation.
+ * @param values The values to check.
+ * @param n Number of values.
+ * @param divisible Out: the values divisible by 6.
+ * @return The number of divisible values.
+ */
+int classify_div6(const int64_t* values, int n, int64_t* divisible) {
+    return classify_impl(values, n, divisible);
+}
@@ -0,0 +1,25 @@
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+#include <stdint.h>
+
+/*
+ * Block classification of consumer values (divisible by 6 or not).
+ * The implementation is picked once at runtime from the CPU features:
+ * AVX2, SSE4.2 or a portable scalar loop.
+ */
+
+/*
+ * Selects the fastest implementation the CPU supports and returns its name.
+ * Must be called before classify_div6; calling it again is harmless.
+ */
+const char* classify_init(void);
+
+/*
+ * Checks values[0..n) for divisibility by 6 (values must be non-negative).
+ * The divisible values are written, in order, to 'divisible' (room for n values).
+ * Returns how many were divisible.
+ */
+int classify_div6(const int64_t* values, int n, int64_t* divisible);
+
+#endif // CLASSIFY_H
@@ -3,21 +3,102 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <stdatomic.h>
+#include <stdbool.h> // For true before C23 compilers.
+#include <string.h>
+#include <inttypes.h> // For PRId64.
+#include <time.h>
+#include <limits.h> // For PIPE_BUF.
+#include <unistd.h> // For fork() and write().
+#include <sys/wait.h> // For waitpid().
+#include <sys/resource.h> // For getrusage().
 #include "ticket_lock.h" // My ticket lock.
 #include "cond_var.h" // My custom condition variable.
+#include "ws_deque.h" // Per-consumer work-stealing deques.
+#include "node_pool.h" // Pooled queue nodes.
+#include "classify.h" // Vectorized divisibility check.
+#include "pipeline.h" // Generic staged pipeline.
+#include "latch.h" // Completion latches for the main thread.
+#include "fc.h" // Flat combining.
+#include "sync_wait.h" // Shared spin/sleep policy and wait statistics.
+#include "tp_lock.h" // Preemption-tolerant lock.
+#include "reactive_lock.h" // TAS/queue lock that adapts to contention.
+#include "sharded_counter.h" // Per-CPU counters.
+#include "eventcount.h" // Sleeping on lock-free work sources.
+#include "shm_ring.h" // Shared-memory ring between processes.
+#include "ms_queue.h" // Lock-free queue with epoch-based reclamation.
+#include "local_storage.h" // For init_storage(); reclamation slots are TLS entries.
+#include "placement.h" // Pinning threads by CPU topology.
+#include "seg_bitmap.h" // Lazily mapped bitmaps over the number range.
+#include "histogram.h" // Latency and queue depth distributions.
 
-#define MAX_NUMBER 1000000
+#define DEFAULT_RANGE 1000000 // Numbers generated (0..DEFAULT_RANGE-1) unless --range says otherwise.
+#define GEN_WINDOW 8 // Bitmap segments producers draw from at once.
 
-char generated_flags[MAX_NUMBER] = {0};    // Array to track generated numbers (0 = not generated, 1 = generated)
-atomic_int generated_count = 0;            // Counter for how many unique numbers were generated
-ticket_lock generated_flags_lock;          // Lock to protect access to generated_flags array
-// atomic_int consumed_count = 0;  // testing.
+#define GEN_NONE 0 // next_unique_number: every number was already generated.
+#define GEN_NEW 1 // next_unique_number: generated a number.
+#define GEN_LAST 2 // next_unique_number: generated the last number.
 
-// Queue node structure. will use us for communication between producers to consumers.
-typedef struct node {
-    int value;
-    struct node* next;
-} node_t;
+#define DIST_QUEUE 0 // All consumers share queue_head (default).
+#define DIST_STEAL 1 // Each consumer owns a deque; idle consumers steal.
+#define WS_DEQUE_CAPACITY 65536 // Values each consumer deque can hold.
+#define NODE_POOL_CAPACITY 65536 // Default number of pooled queue nodes.
+
+#define CONSUME_LINE 0 // One checked line per number (default).
+#define CONSUME_AGGREGATE 1 // Blocks classified with SIMD, counts reported at exit.
+#define CONSUME_BLOCK 256 // Values a consumer takes per queue visit in CONSUME_AGGREGATE.
+
+#define QUEUE_LOCKED 0 // queue_head/queue_tail guarded by queue_lock (default).
+#define QUEUE_FC 1 // Queue operations run through a flat-combining wrapper.
+#define QUEUE_LOCKFREE 2 // Michael-Scott queue; dequeued nodes are freed through epoch-based reclamation.
+
+#define AUTOSCALE_INTERVAL_MS 5 // Period of the consumer-scaling controller.
+#define AUTOSCALE_UP_DEPTH 256 // Smoothed queue depth per running consumer that calls for one more.
+#define AUTOSCALE_DOWN_DEPTH 16 // Smoothed queue depth below which idle consumers may be parked.
+#define AUTOSCALE_UP_SAMPLES 2 // Consecutive samples calling for more consumers before one is unparked.
+#define AUTOSCALE_DOWN_SAMPLES 8 // Consecutive samples calling for fewer before one is parked.
+#define AUTOSCALE_COOLDOWN 4 // Samples after a change during which the controller holds still.
+#define AUTOSCALE_MIN_GAIN 0.05 // Consumption rate growth a scale-up must bring to be kept.
+#define AUTOSCALE_HOLD 200 // Samples a failed scale-up caps the consumer count.
+
+#define TELEMETRY_VALUE_BITS 34 // --telemetry: queued payloads keep the number in their low bits...
+#define TELEMETRY_VALUE_MASK ((1LL << TELEMETRY_VALUE_BITS) - 1)
+#define TELEMETRY_TIME_BITS 29 // ...and its production time, in ticks, in the 29 above them.
+#define TELEMETRY_TIME_MASK ((1ULL << TELEMETRY_TIME_BITS) - 1)
+#define TELEMETRY_TICK_SHIFT 6 // A tick is 64 ns, so latencies up to 2^35 ns (34 s) are measured exactly.
+#define TELEMETRY_INTERVAL_MS 10 // Period of the queue depth sampler.
+#define TELEMETRY_PERIODS 10 // Rows of the depth-over-time summary.
+
+#define LOCK_TICKET 0 // Short critical sections use the FIFO ticket_lock (default).
+#define LOCK_TP 1 // Short critical sections use tp_lock, which skips preempted waiters.
+#define LOCK_REACTIVE 2 // Short critical sections use reactive_lock (TAS, queue under contention).
+
+/*
+ * Lock of the short critical sections (generated flags, printing, emit file), selected with --lock.
+ * queue_lock stays a ticket_lock - the condition variable requeues waiters onto one.
+ */
+typedef struct {
+    ticket_lock ticket;
+    tp_lock tp;
+    reactive_lock reactive;
+} cp_lock;
+
+#define ENGINE_THREADS 0 // Hand-wired producer and consumer threads (default).
+#define ENGINE_PIPELINE 1 // Two-stage instance of the pipeline library.
+#define PIPELINE_SLOTS 1024 // Items in flight in ENGINE_PIPELINE.
+#define PIPELINE_CHANNEL 256 // Capacity of the produce -> check channel.
+#define ENGINE_PROCESSES 2 // A producer process and a consumer process joined by a shared-memory ring.
+#define SHM_RING_SLOTS 4096 // Values in flight in ENGINE_PROCESSES.
+#define SHM_POP_BATCH 32 // Values a consumer takes per ring visit in ENGINE_PROCESSES.
+
+seg_bitmap generated_flags;                // One bit per number, set once it was generated
+cp_lock generated_flags_lock;              // Lock to protect generated_flags and the window below
+uint64_t open_segments[GEN_WINDOW];        // Segments producers draw from; the others are untouched or full
+uint64_t open_filled[GEN_WINDOW];          // Numbers generated so far in each open segment
+int open_count = 0;                        // Open segments (0 once every number was generated)
+uint64_t next_segment = 0;                 // First segment not opened yet
+_Atomic uint64_t consumed_count = 0;       // Numbers taken by consumers so far.
+latch all_generated;                       // Released when the last unique number is generated.
+latch queue_drained;                       // Released when consumers have taken every number.
 
 // For iteration, join and clean up.
 pthread_t* producers_threads;
@@ -28,28 +109,172 @@ long* consumer_ids;
 // Queue and sync.
 node_t* queue_head = NULL;
 node_t* queue_tail = NULL;
+node_pool queue_nodes; // Slab the queue nodes come from.
 
 ticket_lock queue_lock; // Protects access to the queue so multiple producers/consumers don’t corrupt it.
 condition_variable queue_cond; // Custom condition variable from task 3.
-ticket_lock print_lock; // Protects print_msg.
+cp_lock print_lock; // Protects print_msg.
 
-int producers_done = 0; // Signals consumers when all producers have finished generating numbers, so consumers can 'shut down'.
-atomic_int producers_finished = 0;  // Counts finished producers.
+atomic_int producers_done = 0; // Signals consumers when all producers have finished generating numbers, so consumers can 'shut down'.
+sharded_counter producers_finished; // Counts finished producers.
 int total_producers = 0;             // Total number of producers.
+int total_consumers = 0;             // Total number of consumers.
+
+// Run options (optional flags after the positional arguments).
+uint64_t number_range = DEFAULT_RANGE; // Producers generate every number of [0, number_range) once.
+const char* track_path = NULL; // Back generated_flags with this file instead of anonymous memory.
+int run_seed = 0; // Producers seed their generators from it and their IDs.
+int dist_mode = DIST_QUEUE; // How produced numbers reach consumers.
+int dist_hash = 0; // DIST_STEAL: place by hash of the value instead of round-robin.
+int print_stats = 0; // Print a run summary at exit.
+long pool_capacity = NODE_POOL_CAPACITY; // Queue nodes in the pool (0 = plain malloc).
+int pool_hugepages = 0; // Back the node pool with huge pages.
+int consume_mode = CONSUME_LINE; // What consumers do with each number.
+int engine = ENGINE_THREADS; // How the run is wired together.
+int queue_mode = QUEUE_LOCKED; // How the shared queue is synchronized.
+int reclaim_mode = EBR_EPOCH; // QUEUE_LOCKFREE: how dequeued nodes are reclaimed.
+int lock_kind = LOCK_TICKET; // Lock used for the short critical sections.
+const char* emit_bitmap_path = NULL; // CONSUME_AGGREGATE: write the divisible values as a bitmap here.
+const char* emit_binary_path = NULL; // CONSUME_AGGREGATE: write the divisible values as raw 64-bit ints here.
+int place_strategy = PLACE_NONE; // How threads are pinned to CPUs.
+const char* place_list = NULL; // PLACE_LIST: the CPUs.
+
+// Aggregate consumption (CONSUME_AGGREGATE).
+const char* classifier_name; // Implementation chosen by classify_init.
+long* checked_counts; // Per consumer: numbers checked.
+long* divisible_counts; // Per consumer: numbers divisible by 6.
+double* consumer_cpu; // Per consumer: CPU seconds spent.
+seg_bitmap emit_bitmap; // One bit per number, set when divisible; mapped from emit_bitmap_path.
+FILE* emit_file; // Raw divisible values, appended a block at a time.
+cp_lock emit_lock; // Protects emit_file.
+
+// Work-stealing distribution (DIST_STEAL).
+ws_deque* consumer_deques; // One deque per consumer.
+long* local_pops; // Per consumer: values taken from its own deque.
+long* steals; // Per consumer: values taken from another consumer's deque.
+
+// Idle consumers sleep here while no work is queued (DIST_STEAL, QUEUE_FC, QUEUE_LOCKFREE).
+eventcount work_ec;
+
+// Cross-process run (ENGINE_PROCESSES).
+shm_ring* ring; // Mapped before fork, shared by both processes.
+char out_buf[PIPE_BUF]; // This process's pending output lines.
+size_t out_len = 0; // Bytes used in out_buf.
+
+// Flat-combining queue (QUEUE_FC).
+fc_lock queue_fc; // Runs enqueue/dequeue operations in combining passes.
+atomic_int queue_size = 0; // Queued numbers, readable without combining (also QUEUE_LOCKFREE).
+
+// Lock-free queue (QUEUE_LOCKFREE).
+ms_queue lf_queue;
+
+// Queue memory, for the run summary.
+atomic_long queue_depth = 0; // Numbers in the locked or combined queue; written under its mutual exclusion.
+atomic_long peak_depth = 0; // Highest queue depth seen.
+
+// Elastic consumers (--autoscale): all autoscale_max consumers exist, those with an ID
+// at or above consumer_limit park until the controller raises it.
+int autoscale_min = 0; // 0 = every consumer runs (fixed configuration).
+int autoscale_max = 0;
+atomic_int consumer_limit = INT_MAX; // Consumers with a lower ID run; the futex word parked ones sleep on.
+atomic_int parked_sleepers = 0; // sync_wake's sleepers count for consumer_limit.
+atomic_long idle_waits = 0; // Times a consumer found no work and waited - the controller's utilization signal.
+pthread_t controller_thread;
+long scale_ups = 0, scale_downs = 0; // Statistics, written by the controller only.
+long control_samples = 0, running_sum = 0; // Statistics: samples taken and running consumers summed over them.
+
+// Telemetry (--telemetry): producers stamp every number with its production time in the
+// payload's top bits, consumers turn the stamps into latencies in their own histograms,
+// and a sampler thread records the queue depth.
+typedef struct {
+    long long wait_ns; // Consumers: time in consumer_take. Producers: time handing numbers off.
+    long long life_ns; // Thread start to exit.
+} thread_times;
+int telemetry = 0;
+long long telemetry_start_ns; // Time base of the stamps.
+histogram* latency_hists; // Per consumer: produce -> take latency in ns.
+thread_times* producer_times;
+thread_times* consumer_times;
+histogram depth_hist; // Sampled queue depths (sampler thread only).
+long* depth_samples; // Every sample in order, for the depth over time.
+long depth_count = 0, depth_capacity = 0;
+atomic_int sampler_stop = 0;
+pthread_t sampler_thread;
+
+// Thread placement (--place). Producer i and consumer i take neighbouring slots, so
+// PLACE_COMPACT puts each pair on sibling hyperthreads or under one L3.
+placement place;
+placement_counters place_counters; // --stats: migrations and cache misses of the run.
+
+// Argument of a combined dequeue.
+typedef struct {
+    int64_t* values; // Out: dequeued numbers.
+    int max; // Room in 'values'.
+    node_cache* cache; // The requesting consumer's cache (idle while it waits for the combiner).
+} fc_take_arg;
 
 /**
- * Enqueues a value into the shared queue.
- * Locks the queue for safe access and signals consumers that work is available.
- * @param value The number to enqueue.
+ * Initializes a short-section lock (all variants, only 'lock_kind' is used).
+ * @param lock The lock.
  */
-void enqueue(int value) {
-    // Allocate a new node.
-    node_t* new_node = malloc(sizeof(node_t));
-    new_node->value = value;
-    new_node->next = NULL;
+static void cp_lock_init(cp_lock* lock) {
+    ticketlock_init(&lock->ticket);
+    tp_lock_init(&lock->tp, 0);
+    reactive_lock_init(&lock->reactive);
+}
 
-    ticketlock_acquire(&queue_lock); // Lock the queue.
+/**
+ * Acquires a short-section lock with the selected protocol.
+ * @param lock The lock.
+ */
+static void cp_lock_acquire(cp_lock* lock) {
+    if (lock_kind == LOCK_TP) {
+        tp_lock_acquire(&lock->tp);
+    } else if (lock_kind == LOCK_REACTIVE) {
+        reactive_lock_acquire(&lock->reactive);
+    } else {
+        ticketlock_acquire(&lock->ticket);
+    }
+}
+
+/**
+ * Releases a short-section lock.
+ * @param lock The lock.
+ */
+static void cp_lock_release(cp_lock* lock) {
+    if (lock_kind == LOCK_TP) {
+        tp_lock_release(&lock->tp);
+    } else if (lock_kind == LOCK_REACTIVE) {
+        reactive_lock_release(&lock->reactive);
+    } else {
+        ticketlock_release(&lock->ticket);
+    }
+}
 
+/**
+ * Wakes one consumer sleeping in wait_for_work, if there is one. The work was published
+ * with a seq_cst store or RMW, as the eventcount requires; with nobody idle this is one load.
+ */
+static void wake_idle_consumer(void) {
+    eventcount_notify_one(&work_ec);
+}
+
+/**
+ * Records a queue depth for the peak statistic. Concurrent callers may lose a
+ * slightly higher value; it is only reported.
+ * @param depth The depth just reached.
+ */
+static void note_depth(long depth) {
+    if (depth > atomic_load_explicit(&peak_depth, memory_order_relaxed)) {
+        atomic_store_explicit(&peak_depth, depth, memory_order_relaxed);
+    }
+}
+
+/**
+ * Links a node at the tail of the queue. Caller provides mutual exclusion.
+ * @param new_node The node to append.
+ */
+static void link_node(node_t* new_node) {
     if (queue_tail == NULL) { 
         // Queue is empty.
         queue_head = queue_tail = new_node;
@@ -58,24 +283,70 @@ void enqueue(int value) {
         queue_tail->next = new_node;
         queue_tail = new_node;
     }
+    // Load and store rather than an RMW: the caller's mutual exclusion serializes the updates.
+    long depth = atomic_load_explicit(&queue_depth, memory_order_relaxed) + 1;
+    atomic_store_explicit(&queue_depth, depth, memory_order_relaxed);
+    note_depth(depth);
+}
+
+/**
+ * Combined enqueue (QUEUE_FC), run by the current combiner.
+ * @param ctx Unused - the queue is global.
+ * @param arg The node to append.
+ * @return NULL.
+ */
+static void* fc_enqueue_op(void* ctx, void* arg) {
+    (void)ctx;
+    link_node(arg);
+    atomic_fetch_add_explicit(&queue_size, 1, memory_order_seq_cst); // Precedes the idle_consumers check.
+    return NULL;
+}
+
+/**
+ * Enqueues a value into the shared queue.
+ * Locks the queue for safe access and signals consumers that work is available.
+ * @param value The number to enqueue.
+ * @param cache The calling thread's node cache.
+ * @param reclaim The calling thread's reclamation handle (QUEUE_LOCKFREE).
+ */
+void enqueue(int64_t value, node_cache* cache, ebr_thread* reclaim) {
+    if (queue_mode == QUEUE_LOCKFREE) {
+        ms_queue_push(&lf_queue, reclaim, value);
+        note_depth(atomic_fetch_add_explicit(&queue_size, 1, memory_order_seq_cst) + 1); // Precedes the work_ec check.
+        wake_idle_consumer();
+        return;
+    }
+    // Allocate a new node.
+    node_t* new_node = node_alloc(cache);
+    new_node->value = value;
+    new_node->next = NULL;
+
+    if (queue_mode == QUEUE_FC) {
+        fc_execute(&queue_fc, fc_enqueue_op, new_node);
+        wake_idle_consumer();
+        return;
+    }
 
-    condition_variable_broadcast(&queue_cond);  // Wake up *all* consumers.
+    ticketlock_acquire(&queue_lock); // Lock the queue.
+    link_node(new_node);
+    condition_variable_signal(&queue_cond);  // One item needs one consumer; it is handed queue_lock directly.
     ticketlock_release(&queue_lock); // Unlock the queue.
 }
 
 /**
  * Dequeues (removes) a number from the front of the queue.
- * Ensures thread-safe access using a mutex lock.
+ * Must be called with queue_lock held (or by the combiner in QUEUE_FC).
+ * @param cache The calling thread's node cache.
  * @return The dequeued number, or -1 if the queue is empty.
  */
-int dequeue() {
+int64_t dequeue(node_cache* cache) {
     // Check if the queue is empty.
     if (queue_head == NULL) {
         return -1; // Indicate queue is empty.
     }
 
     // Retrieve value from the head node.
-    int value = queue_head->value;
+    int64_t value = queue_head->value;
     node_t* old_head = queue_head; // Save the current head node.
     queue_head = queue_head->next; // Move head to the next node.
 
@@ -83,55 +354,619 @@ int dequeue() {
     if (queue_head == NULL) {
         queue_tail = NULL;
     }
+    atomic_store_explicit(&queue_depth, atomic_load_explicit(&queue_depth, memory_order_relaxed) - 1,
+                          memory_order_relaxed);
 
-    free(old_head); // Free the old head node memory.
+    node_free(cache, old_head); // Return the old head node to the pool.
     return value; // Return the dequeued value.
 }
 
+/**
+ * Combined dequeue (QUEUE_FC): takes up to arg->max numbers.
+ * @param ctx Unused - the queue is global.
+ * @param arg Pointer to an fc_take_arg.
+ * @return The number of values taken, cast to a pointer.
+ */
+static void* fc_dequeue_op(void* ctx, void* arg) {
+    (void)ctx;
+    fc_take_arg* take = arg;
+    int n = 0;
+    while (n < take->max && queue_head != NULL) {
+        take->values[n++] = dequeue(take->cache);
+    }
+    atomic_fetch_sub_explicit(&queue_size, n, memory_order_relaxed); // Nobody waits for it to drop.
+    return (void*)(intptr_t)n;
+}
+
+/**
+ * Checks whether any consumer deque still holds values.
+ * @return 1 if all deques are empty, 0 otherwise.
+ */
+static int ws_all_empty(void) {
+    for (int i = 0; i < total_consumers; i++) {
+        if (!ws_deque_empty(&consumer_deques[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Pushes a value into a consumer deque (DIST_STEAL).
+ * The target is chosen round-robin per producer, or by hashing the value.
+ * If that deque is full the next ones are tried, backing off while all are full.
+ * @param value The number to distribute.
+ * @param next_target In/out: the producer's round-robin cursor.
+ */
+static void ws_distribute(int64_t value, int* next_target) {
+    int target;
+    if (dist_hash) {
+        uint64_t key = (uint64_t)(telemetry ? value & TELEMETRY_VALUE_MASK : value); // Without the stamp.
+        target = (int)(((key * 0x9E3779B97F4A7C15ull) >> 32) % (uint64_t)total_consumers); // Fibonacci hashing.
+    } else {
+        target = *next_target;
+        *next_target = (target + 1) % total_consumers;
+    }
+    int round = 0;
+    while (1) {
+        for (int i = 0; i < total_consumers; i++) {
+            if (ws_deque_push(&consumer_deques[(target + i) % total_consumers], value)) {
+                wake_idle_consumer();
+                return;
+            }
+        }
+        sync_backoff(&round, NULL); // Every deque is full - let consumers catch up.
+    }
+}
+
+/**
+ * Takes a value for consumer 'id' (DIST_STEAL): its own deque first, then the other
+ * deques starting from its neighbour.
+ * @param id The consumer's ID.
+ * @param value Out: the taken value.
+ * @return 1 if a value was taken, 0 if every deque was empty.
+ */
+static int ws_take(long id, int64_t* value) {
+    if (ws_deque_take(&consumer_deques[id], value)) {
+        local_pops[id]++;
+        return 1;
+    }
+    for (int i = 1; i < total_consumers; i++) {
+        if (ws_deque_take(&consumer_deques[(id + i) % total_consumers], value)) {
+            steals[id]++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Seeds a producer's random number generator from the run seed and its ID.
+ * @param seed The run seed.
+ * @param id The producer's ID.
+ * @return The generator state.
+ */
+static uint64_t rng_seed(int seed, long id) {
+    return (((uint64_t)(uint32_t)seed << 32) ^ (uint64_t)id) * 0x9E3779B97F4A7C15ull;
+}
+
+/**
+ * Returns the next 64 random bits of a producer's generator (splitmix64).
+ * Each producer owns its state, so drawing takes no lock, unlike rand().
+ * @param state In/out: the generator state.
+ */
+static uint64_t rng_next(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Maps 64 random bits onto [0, n) with a multiply instead of a division (Lemire).
+ */
+static uint64_t rng_below(uint64_t r, uint64_t n) {
+    return (uint64_t)(((unsigned __int128)r * n) >> 64);
+}
+
+/**
+ * Replaces open segment 'k' with the next unopened one, or drops it once none is left.
+ * Caller holds generated_flags_lock.
+ * @param k Index into open_segments.
+ */
+static void advance_window(int k) {
+    if (next_segment < generated_flags.segments) {
+        open_segments[k] = next_segment++;
+        open_filled[k] = 0;
+    } else {
+        open_count--;
+        open_segments[k] = open_segments[open_count];
+        open_filled[k] = open_filled[open_count];
+    }
+}
+
+/**
+ * Sets up duplicate tracking over [0, number_range): the bitmap (file-backed with
+ * --track-file) and the first window of segments.
+ */
+static void generator_init(void) {
+    cp_lock_init(&generated_flags_lock);
+    if (seg_bitmap_init(&generated_flags, number_range, track_path) != 0) {
+        printf("cannot create %s\n", track_path);
+        exit(1);
+    }
+    open_count = 0;
+    next_segment = 0;
+    while (open_count < GEN_WINDOW && next_segment < generated_flags.segments) {
+        advance_window(open_count++);
+    }
+}
+
+/**
+ * Generates a number that was not generated yet, and marks it.
+ * Producers draw a random open segment and a random position in it; if that number was
+ * taken, the next free one after it (wrapping within the segment) is used instead of
+ * drawing again, so the cost per number stays flat as the range fills up. A segment whose
+ * numbers were all generated is unmapped and the next one opens, so the bitmap's memory
+ * is bounded by GEN_WINDOW segments whatever the range; ranges up to GEN_WINDOW segments
+ * are drawn from uniformly.
+ * The window is only updated and checked under generated_flags_lock, so the last number is exact.
+ * @param rng In/out: the calling producer's generator.
+ * @param number Out: the newly generated number.
+ * @return GEN_NEW, GEN_LAST if this was the last number, or GEN_NONE if all were already generated.
+ */
+static int next_unique_number(uint64_t* rng, int64_t* number) {
+    uint64_t pick = rng_next(rng); // Drawn before taking the lock.
+    uint64_t offset = rng_next(rng);
+    cp_lock_acquire(&generated_flags_lock);
+    if (open_count == 0) {
+        cp_lock_release(&generated_flags_lock);
+        return GEN_NONE;
+    }
+    int k = (int)rng_below(pick, (uint64_t)open_count);
+    uint64_t begin = open_segments[k] * SEG_BITMAP_SEGMENT_BITS;
+    uint64_t end = number_range - begin < SEG_BITMAP_SEGMENT_BITS ? number_range : begin + SEG_BITMAP_SEGMENT_BITS;
+    // An open segment always has a clear bit.
+    uint64_t candidate = seg_bitmap_next_clear(&generated_flags, begin + rng_below(offset, end - begin), begin, end);
+    seg_bitmap_set(&generated_flags, candidate);
+    if (++open_filled[k] == end - begin) {
+        seg_bitmap_release(&generated_flags, open_segments[k]);
+        advance_window(k);
+    }
+    int last = open_count == 0;
+    cp_lock_release(&generated_flags_lock);
+    if (last) {
+        latch_count_down(&all_generated); // Wake the main thread.
+    }
+    *number = (int64_t)candidate;
+    return last ? GEN_LAST : GEN_NEW;
+}
+
+/**
+ * Returns CLOCK_MONOTONIC in nanoseconds (a vDSO call, no syscall).
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Returns the production stamp to OR into a queued number (--telemetry).
+ * @param ns The production time from now_ns().
+ */
+static int64_t telemetry_stamp(long long ns) {
+    uint64_t ticks = (uint64_t)(ns - telemetry_start_ns) >> TELEMETRY_TICK_SHIFT;
+    return (int64_t)((ticks & TELEMETRY_TIME_MASK) << TELEMETRY_VALUE_BITS);
+}
+
 /**
  * Producer thread function.
  * Generates numbers, enqueues them, and prints messages.
+ * With --telemetry, stamps each number and times its handoff.
  * @param arg The producer's thread ID (passed as a long cast to void*).
  */
 void* producer_thread(void* arg) {
     long id = *(long*)arg;
-    while (true) {
-        int number = rand() % MAX_NUMBER;  // Generate random number.
-        // Check if number is already generated.
-        ticketlock_acquire(&generated_flags_lock);
-        if (generated_flags[number] == 1) {
-            // Check global exit condition.
-            if (atomic_load(&generated_count) >= MAX_NUMBER) {
-                ticketlock_release(&generated_flags_lock);
-                break;  // Exit producer.
-            }
-            ticketlock_release(&generated_flags_lock);
-            continue; // Already generated, pick another.
-        }
-        // Mark number as generated.
-        generated_flags[number] = 1;
-        int count = atomic_fetch_add(&generated_count, 1) + 1;
-        ticketlock_release(&generated_flags_lock);
-        enqueue(number); // Adding to queue.
-        char msg[100];
-        snprintf(msg, sizeof(msg), "Producer %ld generated number: %d", id, number); // Ensures atomic message formatting.
-        print_msg(msg);
+    int next_target = (int)(id % (total_consumers > 0 ? total_consumers : 1)); // Round-robin cursor for DIST_STEAL.
+    node_cache cache; // This producer's queue node cache.
+    node_cache_init(&cache, &queue_nodes);
+    ebr_thread reclaim; // This producer's announcement in lf_queue's reclamation domain.
+    if (queue_mode == QUEUE_LOCKFREE) {
+        ebr_thread_register(&lf_queue.reclaim, &reclaim, NULL);
+    }
+    uint64_t rng = rng_seed(run_seed, id); // This producer's random number generator.
+    long long born = telemetry ? now_ns() : 0;
+    int64_t number;
+    int status;
+    while ((status = next_unique_number(&rng, &number)) != GEN_NONE) {
+        int64_t queued = number;
+        long long produced = 0;
+        if (telemetry) {
+            produced = now_ns();
+            queued |= telemetry_stamp(produced);
+        }
+        if (dist_mode == DIST_STEAL) {
+            ws_distribute(queued, &next_target); // Straight into a consumer deque.
+        } else {
+            enqueue(queued, &cache, &reclaim); // Adding to queue.
+        }
+        if (telemetry) {
+            producer_times[id].wait_ns += now_ns() - produced;
+        }
+        if (consume_mode == CONSUME_LINE) { // Aggregate runs print counts only, not a line per number.
+            char msg[100];
+            snprintf(msg, sizeof(msg), "Producer %ld generated number: %" PRId64, id, number); // Ensures atomic message formatting.
+            print_msg(msg);
+        }
         // Stop condition: when we've generated all numbers.
-        if (count >= MAX_NUMBER) {
+        if (status == GEN_LAST) {
         break; // Exit this producer, but do NOT touch producers_done.
         }
     }
     // After exiting the loop, increment producers_finished.
-    if (atomic_fetch_add(&producers_finished, 1) + 1 == total_producers) {
+    // Two producers finishing together may both see the total; setting producers_done twice is harmless.
+    sharded_counter_add(&producers_finished, 1);
+    if (sharded_counter_reached(&producers_finished, total_producers)) {
         // Last producer sets producers_done and wakes up consumers.
         ticketlock_acquire(&queue_lock);
-        producers_done = 1;
+        atomic_store_explicit(&producers_done, 1, memory_order_seq_cst); // Precedes the work_ec check.
         condition_variable_broadcast(&queue_cond);  // Wake up all consumers.
         ticketlock_release(&queue_lock);
+        eventcount_notify_all(&work_ec);
+    }
+    node_cache_flush(&cache);
+    fc_thread_exit(&queue_fc); // Free our combining record, if we used one.
+    if (queue_mode == QUEUE_LOCKFREE) {
+        ebr_thread_unregister(&reclaim);
+        tls_thread_free();
+    }
+    if (telemetry) {
+        producer_times[id].life_ns = now_ns() - born;
     }
     return NULL;
 }
 
+/**
+ * Accounts for numbers taken by a consumer. Whoever takes the last number
+ * releases queue_drained - every number was produced and none is left queued.
+ * @param n How many numbers were just taken.
+ * @return n.
+ */
+static int note_consumed(int n) {
+    if (atomic_fetch_add_explicit(&consumed_count, (uint64_t)n, memory_order_relaxed) + n == number_range) { // The latch orders the rest.
+        latch_count_down(&queue_drained);
+    }
+    return n;
+}
+
+/**
+ * Checks for work without locking (DIST_STEAL, QUEUE_FC and QUEUE_LOCKFREE).
+ * @return Non-zero if some deque or the combined queue holds numbers.
+ */
+static int work_available(void) {
+    if (dist_mode == DIST_STEAL) {
+        return !ws_all_empty();
+    }
+    return atomic_load_explicit(&queue_size, memory_order_seq_cst) > 0;
+}
+
+/**
+ * Sleeps on work_ec until there is work or everyone is done (DIST_STEAL, QUEUE_FC, QUEUE_LOCKFREE,
+ * where producers don't hold queue_lock while adding work, so no lock is taken here either).
+ * @return 1 if producers are done and nothing is left, 0 to try taking again.
+ */
+static int wait_for_work(void) {
+    int key = eventcount_prepare_wait(&work_ec);
+    if (work_available()) {
+        eventcount_cancel_wait(&work_ec);
+        return 0;
+    }
+    if (atomic_load_explicit(&producers_done, memory_order_seq_cst)) {
+        eventcount_cancel_wait(&work_ec);
+        return !work_available();
+    }
+    atomic_fetch_add_explicit(&idle_waits, 1, memory_order_relaxed);
+    eventcount_commit_wait(&work_ec, key);
+    return 0;
+}
+
+/**
+ * Parks a consumer the autoscaling controller doesn't want running, until it does.
+ * Called between takes, so a parked consumer holds no numbers.
+ * @param id The consumer's ID.
+ */
+static void park_if_surplus(long id) {
+    int limit;
+    while (id >= (limit = atomic_load_explicit(&consumer_limit, memory_order_relaxed))) {
+        sync_wait_while(&consumer_limit, limit, &parked_sleepers, SYNC_PRIVATE, NULL);
+    }
+}
+
+/**
+ * Sets how many consumers may run and wakes the parked ones.
+ * @param expected The limit the caller last saw.
+ * @param limit The new limit.
+ * @return 1 if set, 0 if the limit had changed (stop_consumers lifted it).
+ */
+static int set_consumer_limit(int expected, int limit) {
+    // seq_cst: precedes sync_wake's sleepers load.
+    if (!atomic_compare_exchange_strong_explicit(&consumer_limit, &expected, limit, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return 0;
+    }
+    sync_wake(&consumer_limit, SYNC_WAKE_ALL, &parked_sleepers, SYNC_PRIVATE);
+    return 1;
+}
+
+/**
+ * Returns the current queue depth (for DIST_STEAL, the numbers in all deques).
+ */
+static long current_depth(void) {
+    if (dist_mode == DIST_STEAL) {
+        long depth = 0;
+        for (int i = 0; i < total_consumers; i++) {
+            depth += atomic_load_explicit(&consumer_deques[i].bottom, memory_order_relaxed)
+                - atomic_load_explicit(&consumer_deques[i].top, memory_order_relaxed);
+        }
+        return depth;
+    }
+    if (queue_mode == QUEUE_LOCKFREE) {
+        return atomic_load_explicit(&queue_size, memory_order_relaxed);
+    }
+    return atomic_load_explicit(&queue_depth, memory_order_relaxed);
+}
+
+/**
+ * Autoscaling controller (--autoscale). Every AUTOSCALE_INTERVAL_MS it samples the queue
+ * depth and the consumption rate, both smoothed over recent samples, and how often
+ * consumers waited for work:
+ * - a backlog above AUTOSCALE_UP_DEPTH per running consumer for AUTOSCALE_UP_SAMPLES
+ *   samples unparks one consumer. If after the cooldown the rate hasn't grown by
+ *   AUTOSCALE_MIN_GAIN, the consumer only added contention (or there are no idle CPUs):
+ *   it is parked again and the count is capped below it for AUTOSCALE_HOLD samples;
+ * - a short queue while consumers waited more than once each per sample, for
+ *   AUTOSCALE_DOWN_SAMPLES samples, parks one.
+ * Scaling down takes longer than scaling up and every change is followed by a cooldown,
+ * so the count doesn't oscillate around a threshold.
+ * @param arg Unused.
+ * @return NULL.
+ */
+static void* autoscale_controller(void* arg) {
+    (void)arg;
+    struct timespec period = { 0, AUTOSCALE_INTERVAL_MS * 1000000L };
+    double depth_avg = 0;
+    double rate_avg = 0; // Numbers consumed per sample.
+    double probe_rate = 0; // rate_avg before the last scale-up, while it is being judged.
+    long last_waits = 0;
+    long last_consumed = 0;
+    int up = 0, down = 0, cooldown = 0;
+    int cap = autoscale_max, hold = 0; // Ceiling after a scale-up that didn't pay off, and for how long.
+    int limit = atomic_load_explicit(&consumer_limit, memory_order_relaxed);
+    while (!atomic_load_explicit(&producers_done, memory_order_relaxed)) {
+        nanosleep(&period, NULL);
+        depth_avg += (current_depth() - depth_avg) / 4; // Moving averages, weight 1/4.
+        long consumed = atomic_load_explicit(&consumed_count, memory_order_relaxed);
+        rate_avg += (consumed - last_consumed - rate_avg) / 4;
+        last_consumed = consumed;
+        long waits = atomic_load_explicit(&idle_waits, memory_order_relaxed);
+        long waited = waits - last_waits;
+        last_waits = waits;
+        control_samples++;
+        running_sum += limit;
+        up = depth_avg > (double)AUTOSCALE_UP_DEPTH * limit ? up + 1 : 0;
+        down = depth_avg < AUTOSCALE_DOWN_DEPTH && waited > limit ? down + 1 : 0;
+        if (hold > 0 && --hold == 0) {
+            cap = autoscale_max; // Conditions may have changed - allow probing again.
+        }
+        if (cooldown > 0) {
+            cooldown--;
+            continue;
+        }
+        int target = limit;
+        if (probe_rate > 0) {
+            if (rate_avg < probe_rate * (1 + AUTOSCALE_MIN_GAIN)) {
+                target = limit - 1; // No gain from the last consumer.
+                cap = target;
+                hold = AUTOSCALE_HOLD;
+                scale_downs++;
+            }
+            probe_rate = 0;
+        } else if (up >= AUTOSCALE_UP_SAMPLES && limit < cap) {
+            target = limit + 1;
+            probe_rate = rate_avg;
+            scale_ups++;
+        } else if (down >= AUTOSCALE_DOWN_SAMPLES && limit > autoscale_min) {
+            target = limit - 1;
+            scale_downs++;
+        }
+        if (target != limit) {
+            if (!set_consumer_limit(limit, target)) {
+                break; // Stopping.
+            }
+            limit = target;
+            up = down = 0;
+            cooldown = AUTOSCALE_COOLDOWN;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Telemetry sampler (--telemetry): records the queue depth every TELEMETRY_INTERVAL_MS
+ * until stop_consumers.
+ * @param arg Unused.
+ * @return NULL.
+ */
+static void* telemetry_sampler(void* arg) {
+    (void)arg;
+    struct timespec period = { 0, TELEMETRY_INTERVAL_MS * 1000000L };
+    while (!atomic_load_explicit(&sampler_stop, memory_order_relaxed)) {
+        nanosleep(&period, NULL);
+        long depth = current_depth();
+        histogram_record(&depth_hist, depth > 0 ? (uint64_t)depth : 0); // Snapshots of racing counters.
+        if (depth_count == depth_capacity) {
+            depth_capacity = depth_capacity > 0 ? depth_capacity * 2 : 1024;
+            long* grown = realloc(depth_samples, sizeof(long) * depth_capacity);
+            if (grown == NULL) {
+                printf("out of memory for %ld depth samples\n", depth_capacity);
+                exit(1);
+            }
+            depth_samples = grown;
+        }
+        depth_samples[depth_count++] = depth;
+    }
+    return NULL;
+}
+
+/**
+ * Takes up to 'max' numbers for a consumer, sleeping while there are none.
+ * Everything available (up to 'max') is taken in one visit of the queue or deques.
+ * @param id The consumer's ID.
+ * @param cache The consumer's node cache.
+ * @param reclaim The consumer's reclamation handle (QUEUE_LOCKFREE).
+ * @param values Out: the numbers to check.
+ * @param max Room in 'values'.
+ * @return How many numbers were taken, 0 once producers are done and nothing is left.
+ */
+static int consumer_take(long id, node_cache* cache, ebr_thread* reclaim, int64_t* values, int max) {
+    int n = 0;
+    park_if_surplus(id);
+    if (dist_mode == DIST_STEAL) {
+        int64_t taken;
+        while (!ws_take(id, &taken)) {
+            // Nothing anywhere - sleep until a producer pushes or everyone is done.
+            if (wait_for_work()) {
+                return 0;
+            }
+        }
+        values[n++] = taken;
+        while (n < max && ws_take(id, &taken)) {
+            values[n++] = taken;
+        }
+        return note_consumed(n);
+    }
+    if (queue_mode == QUEUE_LOCKFREE) {
+        int64_t taken;
+        while (!ms_queue_pop(&lf_queue, reclaim, &taken)) {
+            ebr_flush(reclaim); // Don't sit on retired nodes while idle.
+            if (wait_for_work()) {
+                return 0;
+            }
+        }
+        values[n++] = taken;
+        while (n < max && ms_queue_pop(&lf_queue, reclaim, &taken)) {
+            values[n++] = taken;
+        }
+        atomic_fetch_sub_explicit(&queue_size, n, memory_order_relaxed);
+        return note_consumed(n);
+    }
+    if (queue_mode == QUEUE_FC) {
+        fc_take_arg take = { values, max, cache };
+        while ((n = (int)(intptr_t)fc_execute(&queue_fc, fc_dequeue_op, &take)) == 0) {
+            if (wait_for_work()) {
+                return 0;
+            }
+        }
+        return note_consumed(n);
+    }
+    ticketlock_acquire(&queue_lock); // ensuring that only one thread (either a producer or a consumer) can access the queue.
+    // Wait while queue is empty
+    while (queue_head == NULL) {
+        if (atomic_load_explicit(&producers_done, memory_order_relaxed)) { // Written under queue_lock.
+            ticketlock_release(&queue_lock);
+            return 0;
+        }
+        atomic_fetch_add_explicit(&idle_waits, 1, memory_order_relaxed);
+        condition_variable_wait(&queue_cond, &queue_lock);
+    }
+    while (n < max && queue_head != NULL) {
+        values[n++] = dequeue(cache);
+    }
+    ticketlock_release(&queue_lock); // Release after dequeue.
+    return note_consumed(n);
+}
+
+/**
+ * consumer_take plus the --telemetry bookkeeping: the time spent in it counts as
+ * waiting, and each number's production stamp becomes a latency sample and is cleared.
+ * Two clock reads per call, however many numbers it takes.
+ * @param id The consumer's ID.
+ * @param cache The consumer's node cache.
+ * @param reclaim The consumer's reclamation handle (QUEUE_LOCKFREE).
+ * @param values Out: the numbers to check.
+ * @param max Room in 'values'.
+ * @return How many numbers were taken, 0 once producers are done and nothing is left.
+ */
+static int consumer_take_timed(long id, node_cache* cache, ebr_thread* reclaim, int64_t* values, int max) {
+    if (!telemetry) {
+        return consumer_take(id, cache, reclaim, values, max);
+    }
+    long long start = now_ns();
+    int n = consumer_take(id, cache, reclaim, values, max);
+    long long now = now_ns();
+    consumer_times[id].wait_ns += now - start;
+    uint64_t ticks = (uint64_t)(now - telemetry_start_ns) >> TELEMETRY_TICK_SHIFT;
+    for (int i = 0; i < n; i++) {
+        uint64_t stamp = (uint64_t)values[i] >> TELEMETRY_VALUE_BITS;
+        histogram_record(&latency_hists[id], ((ticks - stamp) & TELEMETRY_TIME_MASK) << TELEMETRY_TICK_SHIFT);
+        values[i] &= TELEMETRY_VALUE_MASK;
+    }
+    return n;
+}
+
+/**
+ * Aggregate consumer loop (CONSUME_AGGREGATE).
+ * Takes blocks of numbers, classifies them with the vectorized checker and only counts
+ * the results; divisible values optionally go to the bitmap or binary output.
+ * Records the thread's CPU time for the per-core throughput report.
+ * @param id The consumer's ID.
+ * @param cache The consumer's node cache.
+ * @param reclaim The consumer's reclamation handle.
+ */
+static void consume_aggregate(long id, node_cache* cache, ebr_thread* reclaim) {
+    int64_t values[CONSUME_BLOCK];
+    int64_t divisible[CONSUME_BLOCK];
+    struct timespec cpu;
+    int n;
+    while ((n = consumer_take_timed(id, cache, reclaim, values, CONSUME_BLOCK)) > 0) {
+        int found = classify_div6(values, n, divisible);
+        checked_counts[id] += n;
+        divisible_counts[id] += found;
+        if (emit_bitmap_path != NULL) {
+            for (int i = 0; i < found; i++) {
+                seg_bitmap_set(&emit_bitmap, (uint64_t)divisible[i]);
+            }
+        }
+        if (emit_file != NULL && found > 0) {
+            cp_lock_acquire(&emit_lock);
+            fwrite(divisible, sizeof(int64_t), found, emit_file);
+            cp_lock_release(&emit_lock);
+        }
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    consumer_cpu[id] = cpu.tv_sec + cpu.tv_nsec / 1e9;
+}
+
+/**
+ * Releases a consumer's per-thread state and, with --telemetry, records its lifetime.
+ * @param id The consumer's ID.
+ * @param cache The consumer's node cache.
+ * @param reclaim The consumer's reclamation handle.
+ * @param born When the consumer started (telemetry only).
+ */
+static void consumer_exit(long id, node_cache* cache, ebr_thread* reclaim, long long born) {
+    node_cache_flush(cache);
+    fc_thread_exit(&queue_fc);
+    if (queue_mode == QUEUE_LOCKFREE) {
+        ebr_thread_unregister(reclaim); // Hands what other threads still hold to the domain.
+        tls_thread_free();
+    }
+    if (telemetry) {
+        consumer_times[id].life_ns = now_ns() - born;
+    }
+}
+
 /**
  * Consumer thread function.
  * Continuously dequeues numbers from the shared queue.
@@ -144,33 +979,48 @@ void* producer_thread(void* arg) {
 void* consumer_thread(void* arg) {
     //print_msg("debug consumers enter");
     long id = *(long*)arg;
-    while (true) {
-        ticketlock_acquire(&queue_lock); // ensuring that only one thread (either a producer or a consumer) can access the queue.
-        // Wait while queue is empty
-        while (queue_head == NULL) {
-            if (producers_done) {
-                ticketlock_release(&queue_lock);
-                return NULL;
-            }
-            condition_variable_wait(&queue_cond, &queue_lock);
-        }
-        int value = dequeue(); 
-        ticketlock_release(&queue_lock); // Release after dequeue.
+    long long born = telemetry ? now_ns() : 0;
+    node_cache cache; // This consumer's queue node cache.
+    node_cache_init(&cache, &queue_nodes);
+    ebr_thread reclaim; // This consumer's announcement in lf_queue's reclamation domain.
+    if (queue_mode == QUEUE_LOCKFREE) {
+        ebr_thread_register(&lf_queue.reclaim, &reclaim, NULL);
+    }
+    if (consume_mode == CONSUME_AGGREGATE) {
+        consume_aggregate(id, &cache, &reclaim);
+        consumer_exit(id, &cache, &reclaim, born);
+        return NULL;
+    }
+    int64_t value;
+    while (consumer_take_timed(id, &cache, &reclaim, &value, 1)) {
         // Checking the needed consumer condition.
         int is_divisible = (value % 6 == 0);
         char msg[100];
-        snprintf(msg, sizeof(msg), "Consumer %ld checked %d. Is it divisible by 6? %s", id, value, is_divisible ? "True" : "False");
+        snprintf(msg, sizeof(msg), "Consumer %ld checked %" PRId64 ". Is it divisible by 6? %s", id, value, is_divisible ? "True" : "False");
         print_msg(msg);
         // atomic_fetch_add(&consumed_count, 1);  // Increment after consuming - testing.
     }
-        return NULL;
+    consumer_exit(id, &cache, &reclaim, born);
+    return NULL;
+}
+
+/**
+ * Returns a thread's placement slot: producer i and consumer i get slots 2i and 2i+1,
+ * threads without a partner follow.
+ * @param id The producer or consumer ID.
+ * @param is_consumer 1 for a consumer.
+ * @return The slot.
+ */
+static int placement_slot(long id, int is_consumer) {
+    long pairs = total_producers < total_consumers ? total_producers : total_consumers;
+    return (int)(id < pairs ? 2 * id + is_consumer : pairs + id);
 }
 
 /**
  * Starts the consumer and producer threads.
  * - Prints the configuration (number of consumers, producers, seed).
  * - Seeds the random number generator with the given seed.
- * - Creates the specified number of consumer and producer threads.
+ * - Creates the specified number of consumer and producer threads, pinned by --place.
  * @param consumers Number of consumer threads to create.
  * @param producers Number of producer threads to create.
  * @param seed Seed value for random number generation.
@@ -180,29 +1030,88 @@ void start_consumers_producers(int consumers, int producers, int seed) {
     printf("Number of Consumers: %d\n", consumers);
     printf("Number of Producers: %d\n", producers);
     printf("Seed: %d\n", seed);
-    // Seeds the random number generator.
-    srand(seed);
+    run_seed = seed; // Seeds the producers' random number generators.
     total_producers = producers;  // Save total producers globally.
+    total_consumers = consumers;  // Save total consumers globally.
 
     // Initialzie custom locks and condition variable.
     ticketlock_init(&queue_lock);
-    ticketlock_init(&print_lock);
-    ticketlock_init(&generated_flags_lock);  // Initialize the generated flags lock.
+    cp_lock_init(&print_lock);
+    generator_init(); // The generated flags and their lock.
+    sharded_counter_init(&producers_finished);
     condition_variable_init(&queue_cond);
+    eventcount_init(&work_ec);
+    fc_init(&queue_fc, NULL); // The queue is global, the operations don't need a context.
+    latch_init(&all_generated, 1);
+    latch_init(&queue_drained, 1);
+    if (node_pool_init(&queue_nodes, pool_capacity, pool_hugepages) != 0) {
+        printf("node pool mapping failed, falling back to malloc\n");
+    }
+    if (queue_mode == QUEUE_LOCKFREE) {
+        init_storage(); // Every thread takes a TLS entry, which is its reclamation slot.
+        ms_queue_init(&lf_queue, reclaim_mode);
+    }
+
+    if (dist_mode == DIST_STEAL) {
+        consumer_deques = malloc(sizeof(ws_deque) * consumers);
+        local_pops = calloc(consumers, sizeof(long));
+        steals = calloc(consumers, sizeof(long));
+        for (int i = 0; i < consumers; i++) {
+            ws_deque_init(&consumer_deques[i], WS_DEQUE_CAPACITY);
+        }
+    }
+
+    if (consume_mode == CONSUME_AGGREGATE) {
+        classifier_name = classify_init();
+        checked_counts = calloc(consumers, sizeof(long));
+        divisible_counts = calloc(consumers, sizeof(long));
+        consumer_cpu = calloc(consumers, sizeof(double));
+        cp_lock_init(&emit_lock);
+        if (emit_bitmap_path != NULL && seg_bitmap_init(&emit_bitmap, number_range, emit_bitmap_path) != 0) {
+            printf("cannot open %s\n", emit_bitmap_path);
+            exit(1);
+        }
+        if (emit_binary_path != NULL && (emit_file = fopen(emit_binary_path, "wb")) == NULL) {
+            printf("cannot open %s\n", emit_binary_path);
+            exit(1);
+        }
+    }
+
+    if (telemetry) {
+        telemetry_start_ns = now_ns();
+        latency_hists = malloc(sizeof(histogram) * consumers);
+        for (int i = 0; i < consumers; i++) {
+            histogram_init(&latency_hists[i]);
+        }
+        producer_times = calloc(producers, sizeof(thread_times));
+        consumer_times = calloc(consumers, sizeof(thread_times));
+        histogram_init(&depth_hist);
+    }
 
     producers_threads = malloc(sizeof(pthread_t) * producers);
     consumers_threads = malloc(sizeof(pthread_t) * consumers);
     producer_ids = malloc(sizeof(long) * producers);   // Allocate IDs
     consumer_ids = malloc(sizeof(long) * consumers);   // Allocate IDs
+    pthread_attr_t attr; // Carries each thread's CPU, so it starts where it stays.
+    pthread_attr_init(&attr);
 
     for (long i = 0; i < producers; i++) {
         producer_ids[i] = i;   // Set ID.
-        pthread_create(&producers_threads[i], NULL, producer_thread, &producer_ids[i]);
+        placement_set_attr(&place, &attr, placement_slot(i, 0));
+        pthread_create(&producers_threads[i], &attr, producer_thread, &producer_ids[i]);
     }
 
     for (long i = 0; i < consumers; i++) {
         consumer_ids[i] = i;   // Set ID.
-        pthread_create(&consumers_threads[i], NULL, consumer_thread, &consumer_ids[i]);
+        placement_set_attr(&place, &attr, placement_slot(i, 1));
+        pthread_create(&consumers_threads[i], &attr, consumer_thread, &consumer_ids[i]);
+    }
+    pthread_attr_destroy(&attr);
+    if (autoscale_max > 0) {
+        pthread_create(&controller_thread, NULL, autoscale_controller, NULL);
+    }
+    if (telemetry) {
+        pthread_create(&sampler_thread, NULL, telemetry_sampler, NULL);
     }
 }
 
@@ -210,12 +1119,58 @@ void start_consumers_producers(int consumers, int producers, int seed) {
  * Signals all consumers to stop after producers are done.
  * Sets the global flag 'producers_done' to true.
  * Broadcasts on the condition variable to wake up all waiting consumers.
+ * With --autoscale, also unparks every consumer and joins the controller.
+ * With --telemetry, stops the depth sampler (the queue is drained by now).
  */
 void stop_consumers() {
     ticketlock_acquire(&queue_lock);
-    producers_done = 1; // Setting the flag -> producers are done.
+    atomic_store_explicit(&producers_done, 1, memory_order_seq_cst); // Setting the flag -> producers are done.
     condition_variable_broadcast(&queue_cond); // wake up all the consumers waiting on the condition variable.
     ticketlock_release(&queue_lock);
+    eventcount_notify_all(&work_ec); // And the ones idle on the eventcount.
+    if (autoscale_max > 0) {
+        // Every consumer runs to the end; a controller still sampling sees the change and quits.
+        atomic_store_explicit(&consumer_limit, INT_MAX, memory_order_seq_cst);
+        sync_wake(&consumer_limit, SYNC_WAKE_ALL, &parked_sleepers, SYNC_PRIVATE);
+        pthread_join(controller_thread, NULL);
+    }
+    if (telemetry) {
+        atomic_store_explicit(&sampler_stop, 1, memory_order_relaxed);
+        pthread_join(sampler_thread, NULL);
+    }
+}
+
+/**
+ * Writes out this process's buffered lines (ENGINE_PROCESSES).
+ * Caller holds print_lock, or is the last thread of the process.
+ */
+static void flush_output(void) {
+    size_t done = 0;
+    while (done < out_len) {
+        ssize_t written = write(STDOUT_FILENO, out_buf + done, out_len - done);
+        if (written <= 0) {
+            break;
+        }
+        done += (size_t)written;
+    }
+    out_len = 0;
+}
+
+/**
+ * Appends a line to this process's output buffer (ENGINE_PROCESSES), writing the buffer
+ * out first if the line doesn't fit. Every write is whole lines and at most PIPE_BUF bytes,
+ * so the two processes sharing stdout never split each other's lines (stdio's own buffer
+ * would flush at arbitrary byte boundaries). Caller holds print_lock.
+ * @param msg The line, without the newline.
+ */
+static void buffer_line(const char* msg) {
+    size_t len = strlen(msg);
+    if (out_len + len + 1 > sizeof(out_buf)) {
+        flush_output();
+    }
+    memcpy(out_buf + out_len, msg, len);
+    out_len += len;
+    out_buf[out_len++] = '\n';
 }
 
 /**
@@ -225,38 +1180,514 @@ void stop_consumers() {
  * @param msg The formatted message string to print.
  */
 void print_msg(const char* msg) {
-    ticketlock_acquire(&print_lock);  // Acquire for synchronized printing.
-    printf("%s\n", msg);                // Print the full message in one go.
-    ticketlock_release(&print_lock); // Release after printing.
+    cp_lock_acquire(&print_lock);  // Acquire for synchronized printing.
+    if (engine == ENGINE_PROCESSES) {
+        buffer_line(msg); // Lines of the other process must not cut into ours.
+    } else {
+        printf("%s\n", msg);                // Print the full message in one go.
+    }
+    cp_lock_release(&print_lock); // Release after printing.
 }
 
 /**
- * Waits until all numbers between 0 and MAX_NUMBER have been produced.
- * Continuously checks the atomic counter 'produced_numbers'.
+ * Waits until every number of [0, number_range) has been produced.
+ * Blocks on the all_generated latch.
  * This ensures the main thread waits for all producer threads to finish.
  */
 void wait_until_producers_produced_all_numbers() {
-    // A busy wait loop that continuously checks if all numbers have been produced.
-    while (atomic_load(&generated_count) < MAX_NUMBER) {
-        sched_yield();
-    }
+    // Sleeps until the producer that generates the last number counts the latch down.
+    latch_wait(&all_generated);
 }
 
 /**
  * Waits until the consumer queue becomes empty.
- * Continuously checks the queue head and yields the CPU to other threads.
- * Exits immediately if the queue is already empty.
+ * Sleeps on the queue_drained latch, which the consumer taking the last number counts down,
+ * instead of polling queue_head under queue_lock.
+ * Exits immediately if the queue was already drained.
  */
 void wait_consumers_queue_empty() {
-    while (true) {
-        ticketlock_acquire(&queue_lock);
-        if (queue_head == NULL) {  
-            ticketlock_release(&queue_lock);
-            break;  // Queue is empty and producers are done.
+    latch_wait(&queue_drained);
+}
+
+// Payload of an ENGINE_PIPELINE slot.
+typedef struct {
+    int64_t value;
+} number_slot;
+
+uint64_t* pipeline_rngs; // ENGINE_PIPELINE: each produce worker's random number generator.
+
+/**
+ * Pipeline source stage: fills the slot with the next unique number.
+ * @param slot The empty number_slot to fill.
+ * @param ctx Unused.
+ * @param worker The producer's ID within the stage.
+ * @return PIPELINE_FORWARD, or PIPELINE_END once every number was generated.
+ */
+static int produce_stage(void* slot, void* ctx, int worker) {
+    (void)ctx;
+    number_slot* item = slot;
+    if (next_unique_number(&pipeline_rngs[worker], &item->value) == GEN_NONE) {
+        return PIPELINE_END;
+    }
+    char msg[100];
+    snprintf(msg, sizeof(msg), "Producer %d generated number: %" PRId64, worker, item->value);
+    print_msg(msg);
+    return PIPELINE_FORWARD;
+}
+
+/**
+ * Pipeline check stage: the divisibility check of a consumer.
+ * @param slot The number_slot to check.
+ * @param ctx Unused.
+ * @param worker The consumer's ID within the stage.
+ * @return PIPELINE_DROP - the slot goes back to the pool.
+ */
+static int check_stage(void* slot, void* ctx, int worker) {
+    (void)ctx;
+    int64_t value = ((number_slot*)slot)->value;
+    char msg[100];
+    snprintf(msg, sizeof(msg), "Consumer %d checked %" PRId64 ". Is it divisible by 6? %s", worker, value, value % 6 == 0 ? "True" : "False");
+    print_msg(msg);
+    return PIPELINE_DROP;
+}
+
+/**
+ * Runs the divisible-by-6 job as a two-stage pipeline (ENGINE_PIPELINE):
+ * 'producers' workers in the produce stage, 'consumers' workers in the check stage.
+ * The pipeline's own shutdown replaces the wait/stop sequence of the threads engine.
+ * @param consumers Number of check workers.
+ * @param producers Number of produce workers.
+ * @param seed Seed value for random number generation.
+ */
+static void run_pipeline(int consumers, int producers, int seed) {
+    printf("Number of Consumers: %d\n", consumers);
+    printf("Number of Producers: %d\n", producers);
+    printf("Seed: %d\n", seed);
+    cp_lock_init(&print_lock);
+    generator_init();
+    pipeline_rngs = malloc(sizeof(uint64_t) * producers);
+    for (int i = 0; i < producers; i++) {
+        pipeline_rngs[i] = rng_seed(seed, i);
+    }
+
+    pipeline p;
+    pipeline_init(&p, PIPELINE_SLOTS, sizeof(number_slot));
+    pipeline_add_stage(&p, "produce", produce_stage, NULL, producers, 0);
+    pipeline_add_stage(&p, "check", check_stage, NULL, consumers, PIPELINE_CHANNEL);
+    pipeline_run(&p);
+    if (print_stats) {
+        pipeline_print_stats(&p);
+    }
+    pipeline_destroy(&p);
+    seg_bitmap_destroy(&generated_flags);
+    free(pipeline_rngs);
+}
+
+/**
+ * Producer thread of ENGINE_PROCESSES: generates numbers into the shared ring.
+ * @param arg The producer's thread ID (passed as a long cast to void*).
+ * @return NULL.
+ */
+static void* ring_producer_thread(void* arg) {
+    long id = *(long*)arg;
+    uint64_t rng = rng_seed(run_seed, id);
+    int64_t number;
+    int status;
+    while ((status = next_unique_number(&rng, &number)) != GEN_NONE) {
+        shm_ring_push(ring, number);
+        char msg[100];
+        snprintf(msg, sizeof(msg), "Producer %ld generated number: %" PRId64, id, number);
+        print_msg(msg);
+        if (status == GEN_LAST) {
+            break;
         }
-        ticketlock_release(&queue_lock);
-        sched_yield();
     }
+    return NULL;
+}
+
+/**
+ * Consumer thread of ENGINE_PROCESSES: checks numbers taken from the shared ring until it
+ * is closed and drained.
+ * @param arg The consumer's thread ID (passed as a long cast to void*).
+ * @return NULL.
+ */
+static void* ring_consumer_thread(void* arg) {
+    long id = *(long*)arg;
+    int64_t values[SHM_POP_BATCH];
+    int n;
+    while ((n = shm_ring_pop(ring, values, SHM_POP_BATCH)) > 0) {
+        for (int i = 0; i < n; i++) {
+            char msg[100];
+            snprintf(msg, sizeof(msg), "Consumer %ld checked %" PRId64 ". Is it divisible by 6? %s", id, values[i], values[i] % 6 == 0 ? "True" : "False");
+            print_msg(msg);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Forks a child that runs 'count' threads of 'fn' and exits once they are done.
+ * The producer side closes the ring on its way out, which ends the consumer side.
+ * @param fn The thread function (gets a pointer to its long ID).
+ * @param count Number of threads.
+ * @param close_ring Close the ring after the threads finish.
+ * @return The child's pid.
+ */
+static pid_t fork_side(void* (*fn)(void*), int count, int close_ring) {
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+    pthread_t* threads = malloc(sizeof(pthread_t) * count);
+    long* ids = malloc(sizeof(long) * count);
+    for (long i = 0; i < count; i++) {
+        ids[i] = i;
+        pthread_create(&threads[i], NULL, fn, &ids[i]);
+    }
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    if (close_ring) {
+        shm_ring_close(ring);
+    }
+    flush_output();
+    _exit(0); // Nothing of the parent's stdio state to flush.
+}
+
+/**
+ * Runs the job as two processes (ENGINE_PROCESSES): one with the producer threads, one
+ * with the consumer threads. Numbers cross in a shared-memory ring guarded by the
+ * process-shared ticket lock and condition variables, so no syscall or copy sits on the
+ * data path unless a side has to wait.
+ * @param consumers Number of consumer threads.
+ * @param producers Number of producer threads.
+ * @param seed Seed value for random number generation.
+ */
+static void run_processes(int consumers, int producers, int seed) {
+    printf("Number of Consumers: %d\n", consumers);
+    printf("Number of Producers: %d\n", producers);
+    printf("Seed: %d\n", seed);
+    run_seed = seed;
+    cp_lock_init(&print_lock);
+    generator_init(); // Before fork; only the producer process touches the bitmap.
+    latch_init(&all_generated, 1);
+    ring = shm_ring_create(SHM_RING_SLOTS);
+    if (ring == NULL) {
+        printf("cannot create the shared memory ring\n");
+        exit(1);
+    }
+    fflush(stdout); // Otherwise both children inherit the buffered lines and print them again.
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t consumer_pid = fork_side(ring_consumer_thread, consumers, 0);
+    pid_t producer_pid = fork_side(ring_producer_thread, producers, 1);
+    if (consumer_pid < 0 || producer_pid < 0) {
+        printf("fork failed\n");
+        exit(1);
+    }
+    int producer_status, consumer_status;
+    waitpid(producer_pid, &producer_status, 0);
+    waitpid(consumer_pid, &consumer_status, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (!WIFEXITED(producer_status) || !WIFEXITED(consumer_status)) {
+        printf("a child process failed\n");
+        exit(1);
+    }
+    if (print_stats) {
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        long full_waits, empty_waits;
+        shm_ring_stats(ring, &full_waits, &empty_waits);
+        printf("Elapsed: %.3f s (%.0f numbers/s)\n", elapsed, number_range / elapsed);
+        printf("Ring: %ld pushes waited for room, %ld pops waited for numbers\n", full_waits, empty_waits);
+    }
+    shm_ring_destroy(ring);
+    seg_bitmap_destroy(&generated_flags);
+}
+
+/**
+ * Prints the CONSUME_AGGREGATE results: per-consumer counts and throughput per
+ * CPU-second (numbers/s per core), then closes the bitmap and binary outputs.
+ */
+static void finish_aggregate(void) {
+    long total_checked = 0, total_divisible = 0;
+    double total_cpu = 0;
+    printf("Classifier: %s\n", classifier_name);
+    for (int i = 0; i < total_consumers; i++) {
+        printf("Consumer %d: checked %ld, divisible by 6 %ld, %.0f numbers/s per core\n",
+               i, checked_counts[i], divisible_counts[i], consumer_cpu[i] > 0 ? checked_counts[i] / consumer_cpu[i] : 0.0);
+        total_checked += checked_counts[i];
+        total_divisible += divisible_counts[i];
+        total_cpu += consumer_cpu[i];
+    }
+    printf("Total: checked %ld, divisible by 6 %ld, %.0f numbers/s per core\n",
+           total_checked, total_divisible, total_cpu > 0 ? total_checked / total_cpu : 0.0);
+    if (emit_bitmap_path != NULL) {
+        seg_bitmap_destroy(&emit_bitmap); // The file already holds the bitmap.
+    }
+    if (emit_file != NULL) {
+        fclose(emit_file);
+    }
+    free(checked_counts);
+    free(divisible_counts);
+    free(consumer_cpu);
+}
+
+/**
+ * Prints the run summary requested with --stats: elapsed time, throughput, CPU time, peak RSS,
+ * peak queue depth, the memory of the generated flags, the autoscaling decisions, thread placement with CPU migrations and cache misses,
+ * condition variable handoffs and spin budget and, for DIST_STEAL, the local/steal balance
+ * or, for QUEUE_FC, how many operations each combining pass ran, or, for QUEUE_LOCKFREE,
+ * how long dequeued nodes waited to be freed and the most memory waiting at once, plus
+ * how often idle consumers slept on work_ec and how many producer notifies found one.
+ * @param elapsed Wall-clock seconds from start to join.
+ */
+static void print_run_stats(double elapsed) {
+    long handoffs, parks, spin_ns;
+    condition_variable_stats(&queue_cond, &handoffs, &parks, &spin_ns);
+    printf("Elapsed: %.3f s (%.0f numbers/s)\n", elapsed, number_range / elapsed);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    long peak = atomic_load_explicit(&peak_depth, memory_order_relaxed);
+    printf("CPU: %.3f s (%.3f s per million numbers), peak RSS: %ld KiB, peak queue depth: %ld nodes (%ld KiB)\n", cpu,
+           cpu * 1e6 / number_range, usage.ru_maxrss, peak, peak * (long)(queue_mode == QUEUE_LOCKFREE ? sizeof(ms_node) : sizeof(node_t)) / 1024);
+    if (autoscale_max > 0) {
+        printf("Autoscale %d..%d: %ld up, %ld down, %.2f consumers running on average\n", autoscale_min,
+               autoscale_max, scale_ups, scale_downs, control_samples ? (double)running_sum / control_samples : 0.0);
+    }
+    placement_print(&place, total_producers + total_consumers);
+    size_t mapped_bytes, peak_bytes;
+    long released;
+    seg_bitmap_stats(&generated_flags, &mapped_bytes, &peak_bytes, &released);
+    printf("Generated flags: %" PRIu64 " numbers, peak %zu KiB mapped, %ld of %" PRIu64 " segments released\n",
+           number_range, peak_bytes / 1024, released, generated_flags.segments);
+    placement_counters_print(&place_counters, (long)number_range);
+    printf("Queue handoffs: %ld, parks per handoff: %.2f, spin budget: %ld ns\n", handoffs,
+           handoffs ? (double)parks / handoffs : 0.0, spin_ns);
+    if (dist_mode == DIST_STEAL) {
+        long total_local = 0, total_steals = 0;
+        for (int i = 0; i < total_consumers; i++) {
+            printf("Consumer %d: local pops %ld, steals %ld\n", i, local_pops[i], steals[i]);
+            total_local += local_pops[i];
+            total_steals += steals[i];
+        }
+        printf("Total: local pops %ld, steals %ld\n", total_local, total_steals);
+    } else if (queue_mode == QUEUE_FC) {
+        long passes, combined;
+        fc_stats(&queue_fc, &passes, &combined);
+        printf("Combining passes: %ld, operations per pass: %.2f\n", passes, passes ? (double)combined / passes : 0.0);
+    } else if (queue_mode == QUEUE_LOCKFREE) {
+        long retired, freed;
+        size_t peak_bytes;
+        long long mean_ns, max_ns;
+        ebr_stats(&lf_queue.reclaim, &retired, &freed, &peak_bytes, &mean_ns, &max_ns);
+        printf("Reclamation (%s): %ld nodes retired, %ld freed, peak deferred %zu bytes, "
+               "retire-to-free mean %lld ns, max %lld ns\n", reclaim_mode == EBR_INTERVAL ? "interval" : "epoch",
+               retired, freed, peak_bytes, mean_ns, max_ns);
+    }
+    if (dist_mode == DIST_STEAL || queue_mode != QUEUE_LOCKED) {
+        long sleeps, notifies;
+        eventcount_stats(&work_ec, &sleeps, &notifies);
+        printf("Idle consumers: %ld sleeps, %ld notifies found a waiter\n", sleeps, notifies);
+    }
+    sync_wait_stats waits;
+    sync_wait_get_stats(&waits);
+    printf("Waits: %ld ended spinning, %ld slept, %ld timed out; wakes: %ld calls, %ld threads woken, %ld requeued\n",
+           waits.spin_hits, waits.sleeps, waits.timeouts, waits.wake_calls, waits.woken, waits.requeued);
+    if (lock_kind == LOCK_TP) {
+        long acquisitions, handoffs, skips, rejoins;
+        tp_lock_stats(&print_lock.tp, &acquisitions, &handoffs, &skips, &rejoins);
+        printf("print_lock: %ld acquisitions, %ld handoffs, %ld preempted waiters skipped, %ld rejoins\n",
+               acquisitions, handoffs, skips, rejoins);
+    } else if (lock_kind == LOCK_REACTIVE) {
+        long tas_acquires, queue_acquires, switches;
+        reactive_lock_stats(&generated_flags_lock.reactive, &tas_acquires, &queue_acquires, &switches);
+        printf("generated_flags_lock: %ld TAS acquisitions, %ld queued acquisitions, %ld mode switches\n",
+               tas_acquires, queue_acquires, switches);
+    }
+    node_pool_print_stats(&queue_nodes);
+}
+
+/**
+ * Formats a duration with a unit that keeps it readable.
+ * @param buf Out: the text.
+ * @param size Room in 'buf'.
+ * @param ns The duration in nanoseconds.
+ * @return buf.
+ */
+static char* format_ns(char* buf, size_t size, uint64_t ns) {
+    if (ns < 1000) {
+        snprintf(buf, size, "%" PRIu64 " ns", ns);
+    } else if (ns < 1000000) {
+        snprintf(buf, size, "%.1f us", ns / 1e3);
+    } else if (ns < 1000000000) {
+        snprintf(buf, size, "%.1f ms", ns / 1e6);
+    } else {
+        snprintf(buf, size, "%.1f s", ns / 1e9);
+    }
+    return buf;
+}
+
+/**
+ * Prints the report requested with --telemetry: produce -> take latency percentiles
+ * overall and per consumer, each thread's busy and waiting share of its lifetime, and
+ * the sampled queue depth, as percentiles and over TELEMETRY_PERIODS slices of the run.
+ * Frees the telemetry state.
+ */
+static void print_telemetry(void) {
+    char p50[32], p99[32], p999[32], max[32], mean[32];
+    histogram all;
+    histogram_init(&all);
+    for (int i = 0; i < total_consumers; i++) {
+        histogram_merge(&all, &latency_hists[i]);
+    }
+    printf("Latency (produce -> take, %" PRIu64 " numbers): p50 %s, p99 %s, p99.9 %s, max %s, mean %s\n", all.total,
+           format_ns(p50, sizeof(p50), histogram_quantile(&all, 0.5)), format_ns(p99, sizeof(p99), histogram_quantile(&all, 0.99)),
+           format_ns(p999, sizeof(p999), histogram_quantile(&all, 0.999)), format_ns(max, sizeof(max), all.max),
+           format_ns(mean, sizeof(mean), all.total ? all.sum / all.total : 0));
+    for (int i = 0; i < total_consumers; i++) {
+        histogram* h = &latency_hists[i];
+        long long life = consumer_times[i].life_ns, wait = consumer_times[i].wait_ns;
+        printf("Consumer %d: %" PRIu64 " numbers, p50 %s, p99 %s, max %s; busy %.1f%%, waiting %.1f%%\n", i, h->total,
+               format_ns(p50, sizeof(p50), histogram_quantile(h, 0.5)), format_ns(p99, sizeof(p99), histogram_quantile(h, 0.99)),
+               format_ns(max, sizeof(max), h->max), life > 0 ? 100.0 * (life - wait) / life : 0.0,
+               life > 0 ? 100.0 * wait / life : 0.0);
+    }
+    for (int i = 0; i < total_producers; i++) {
+        long long life = producer_times[i].life_ns, wait = producer_times[i].wait_ns;
+        printf("Producer %d: busy %.1f%%, handing off %.1f%%\n", i, life > 0 ? 100.0 * (life - wait) / life : 0.0,
+               life > 0 ? 100.0 * wait / life : 0.0);
+    }
+    printf("Queue depth (%ld samples, every %d ms): p50 %" PRIu64 ", p99 %" PRIu64 ", max %" PRIu64 "\n", depth_count,
+           TELEMETRY_INTERVAL_MS, histogram_quantile(&depth_hist, 0.5), histogram_quantile(&depth_hist, 0.99), depth_hist.max);
+    long per_period = (depth_count + TELEMETRY_PERIODS - 1) / TELEMETRY_PERIODS;
+    for (long first = 0; per_period > 0 && first < depth_count; first += per_period) {
+        long last = first + per_period < depth_count ? first + per_period : depth_count;
+        long sum = 0, peak = 0;
+        for (long s = first; s < last; s++) {
+            sum += depth_samples[s];
+            peak = depth_samples[s] > peak ? depth_samples[s] : peak;
+        }
+        printf("  %6ld - %6ld ms: mean %.1f, max %ld\n", first * TELEMETRY_INTERVAL_MS, last * TELEMETRY_INTERVAL_MS,
+               (double)sum / (last - first), peak);
+    }
+    free(latency_hists);
+    free(producer_times);
+    free(consumer_times);
+    free(depth_samples);
+}
+
+/**
+ * Parses the optional flags that follow the positional arguments.
+ * --range=N                      Generate the numbers 0..N-1 (default 1000000; up to 2^62, "1e10" accepted).
+ * --track-file=PATH              Keep the generated flags in a sparse file at PATH instead of anonymous memory
+ *                                (range/8 bytes, which the file system must allow).
+ * --dist=queue|steal|steal-hash  Distribution of numbers to consumers.
+ * --stats                        Print a run summary at exit.
+ * --pool=N                       Pre-size the queue node pool to N nodes (0 = malloc per node).
+ * --hugepages                    Back the node pool with huge pages.
+ * --consume=line|aggregate       Print every check, or classify blocks and report counts.
+ * --emit=bitmap:PATH|binary:PATH Aggregate mode: also write the divisible values to PATH (one bit per
+ *                                number, mapped straight into the file, or raw 64-bit ints).
+ * --engine=threads|pipeline|processes
+ *                                Hand-wired threads, the two-stage pipeline library, or a producer
+ *                                and a consumer process joined by a shared-memory ring (line output).
+ * --queue=locked|fc|lockfree     Shared queue under queue_lock, through flat combining, or lock-free.
+ * --reclaim=epoch|interval       Lock-free queue: free dequeued nodes by epochs, or by intervals, which
+ *                                bounds the memory a stalled thread can hold back.
+ * --autoscale=MIN:MAX            Start MAX consumers and let a controller keep MIN..MAX of them running,
+ *                                following queue depth and consumer idleness ('consumers' is the initial count).
+ * --place=compact|scatter|list:CPUS
+ *                                Pin threads: producer/consumer pairs on sibling hyperthreads or a shared L3,
+ *                                spread over packages, L3s and cores, or on the listed CPUs ("0-3,8") in turn.
+ * --spin=SPINS:YIELDS            Polls and yields every blocking primitive makes before sleeping.
+ * --lock=ticket|tp|reactive      Lock of the short critical sections: FIFO ticket lock, time-published lock,
+ *                                or reactive TAS/queue lock.
+ * --telemetry                    Time every number from production to take and sample the queue depth;
+ *                                print latency percentiles, thread busy/wait shares and depth over time at exit.
+ * @return 0 on success, -1 on an unknown flag.
+ */
+static int parse_options(int argc, char* argv[]) {
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--dist=queue") == 0) {
+            dist_mode = DIST_QUEUE;
+        } else if (strcmp(argv[i], "--dist=steal") == 0) {
+            dist_mode = DIST_STEAL;
+        } else if (strcmp(argv[i], "--dist=steal-hash") == 0) {
+            dist_mode = DIST_STEAL;
+            dist_hash = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            print_stats = 1;
+            sync_wait_enable_stats(1);
+        } else if (strncmp(argv[i], "--range=", 8) == 0) {
+            char* end;
+            double range = strtod(argv[i] + 8, &end);
+            if (*end != '\0' || range < 1 || range > 0x1p62 || range != (double)(uint64_t)range) {
+                return -1;
+            }
+            number_range = (uint64_t)range;
+        } else if (strcmp(argv[i], "--telemetry") == 0) {
+            telemetry = 1;
+        } else if (strncmp(argv[i], "--track-file=", 13) == 0) {
+            track_path = argv[i] + 13;
+        } else if (strncmp(argv[i], "--pool=", 7) == 0) {
+            pool_capacity = atol(argv[i] + 7);
+        } else if (strcmp(argv[i], "--hugepages") == 0) {
+            pool_hugepages = 1;
+        } else if (strcmp(argv[i], "--consume=line") == 0) {
+            consume_mode = CONSUME_LINE;
+        } else if (strcmp(argv[i], "--consume=aggregate") == 0) {
+            consume_mode = CONSUME_AGGREGATE;
+        } else if (strncmp(argv[i], "--emit=bitmap:", 14) == 0) {
+            emit_bitmap_path = argv[i] + 14;
+        } else if (strncmp(argv[i], "--emit=binary:", 14) == 0) {
+            emit_binary_path = argv[i] + 14;
+        } else if (strcmp(argv[i], "--engine=threads") == 0) {
+            engine = ENGINE_THREADS;
+        } else if (strcmp(argv[i], "--engine=pipeline") == 0) {
+            engine = ENGINE_PIPELINE;
+        } else if (strcmp(argv[i], "--engine=processes") == 0) {
+            engine = ENGINE_PROCESSES;
+        } else if (strcmp(argv[i], "--queue=locked") == 0) {
+            queue_mode = QUEUE_LOCKED;
+        } else if (strcmp(argv[i], "--queue=fc") == 0) {
+            queue_mode = QUEUE_FC;
+        } else if (strcmp(argv[i], "--queue=lockfree") == 0) {
+            queue_mode = QUEUE_LOCKFREE;
+        } else if (strcmp(argv[i], "--reclaim=epoch") == 0) {
+            reclaim_mode = EBR_EPOCH;
+        } else if (strcmp(argv[i], "--reclaim=interval") == 0) {
+            reclaim_mode = EBR_INTERVAL;
+        } else if (strcmp(argv[i], "--lock=ticket") == 0) {
+            lock_kind = LOCK_TICKET;
+        } else if (strcmp(argv[i], "--lock=tp") == 0) {
+            lock_kind = LOCK_TP;
+        } else if (strcmp(argv[i], "--lock=reactive") == 0) {
+            lock_kind = LOCK_REACTIVE;
+        } else if (strncmp(argv[i], "--autoscale=", 12) == 0) {
+            if (sscanf(argv[i] + 12, "%d:%d", &autoscale_min, &autoscale_max) != 2
+                || autoscale_min < 1 || autoscale_max < autoscale_min) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--place=compact") == 0) {
+            place_strategy = PLACE_COMPACT;
+        } else if (strcmp(argv[i], "--place=scatter") == 0) {
+            place_strategy = PLACE_SCATTER;
+        } else if (strncmp(argv[i], "--place=list:", 13) == 0) {
+            place_strategy = PLACE_LIST;
+            place_list = argv[i] + 13;
+        } else if (strncmp(argv[i], "--spin=", 7) == 0) {
+            int spins, yields;
+            if (sscanf(argv[i] + 7, "%d:%d", &spins, &yields) != 2) {
+                return -1;
+            }
+            sync_wait_set_policy(spins, yields);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
 }
 
 /**
@@ -268,8 +1699,12 @@ void wait_consumers_queue_empty() {
  */
 int main(int argc, char* argv[]) {
     // Validates argument count.
-    if (argc != 4) {
-        printf("usage: cp_pattern [consumers] [producers] [seed]\n");
+    if (argc < 4 || parse_options(argc, argv) != 0) {
+        printf("usage: cp_pattern [consumers] [producers] [seed] [options]\n");
+        printf("options: --range=N --track-file=PATH --dist=queue|steal|steal-hash --stats --pool=N --hugepages\n");
+        printf("         --consume=line|aggregate --emit=bitmap:PATH|binary:PATH --engine=threads|pipeline|processes\n");
+        printf("         --queue=locked|fc|lockfree --reclaim=epoch|interval --spin=SPINS:YIELDS --lock=ticket|tp|reactive\n");
+        printf("         --autoscale=MIN:MAX --place=compact|scatter|list:CPUS --telemetry\n");
         exit(1);
     }
     // Parsing the arguments.
@@ -277,6 +1712,66 @@ int main(int argc, char* argv[]) {
     int producers = atoi(argv[2]);
     int seed = atoi(argv[3]);
 
+    if (autoscale_max > 0) {
+        if (engine != ENGINE_THREADS || dist_mode != DIST_QUEUE) {
+            printf("--autoscale needs --engine=threads and --dist=queue\n");
+            exit(1);
+        }
+        int initial = consumers < autoscale_min ? autoscale_min : consumers > autoscale_max ? autoscale_max : consumers;
+        atomic_store_explicit(&consumer_limit, initial, memory_order_relaxed);
+        consumers = autoscale_max; // All exist; the controller decides how many run.
+    }
+    if (consumers < 1 || producers < 1) {
+        printf("need at least one consumer and one producer\n"); // Nobody would take or make the numbers.
+        exit(1);
+    }
+    if (place_strategy != PLACE_NONE && engine != ENGINE_THREADS) {
+        printf("--place needs --engine=threads\n");
+        exit(1);
+    }
+    if (telemetry && (engine != ENGINE_THREADS || number_range > 1ULL << TELEMETRY_VALUE_BITS)) {
+        printf("--telemetry needs --engine=threads and a --range of at most 2^%d\n", TELEMETRY_VALUE_BITS);
+        exit(1);
+    }
+    // The pipeline's stages and the processes' ring have their own queues and print a line per number.
+    if (engine != ENGINE_THREADS && (dist_mode != DIST_QUEUE || queue_mode != QUEUE_LOCKED)) {
+        printf("--dist and --queue need --engine=threads\n");
+        exit(1);
+    }
+    if (engine != ENGINE_THREADS && (consume_mode != CONSUME_LINE || emit_bitmap_path != NULL || emit_binary_path != NULL)) {
+        printf("--consume=aggregate and --emit need --engine=threads\n");
+        exit(1);
+    }
+    if (engine == ENGINE_PROCESSES && lock_kind != LOCK_TICKET) {
+        printf("--lock needs --engine=threads or --engine=pipeline\n"); // The ring takes its process-shared ticket lock.
+        exit(1);
+    }
+    if (placement_init(&place, place_strategy, place_list) != 0) {
+        printf("--place=list: bad CPU list or CPU not allowed: %s\n", place_list);
+        exit(1);
+    }
+    if (engine == ENGINE_PIPELINE) {
+        run_pipeline(consumers, producers, seed);
+        exit(0);
+    }
+    if (engine == ENGINE_PROCESSES) {
+        run_processes(consumers, producers, seed);
+        exit(0);
+    }
+    if (queue_mode == QUEUE_LOCKFREE && consumers + producers > MAX_THREADS) {
+        printf("--queue=lockfree supports at most %d threads\n", MAX_THREADS); // One TLS entry each.
+        exit(1);
+    }
+    if (queue_mode == QUEUE_FC && consumers + producers > FC_MAX_RECORDS) {
+        printf("--queue=fc supports at most %d threads\n", FC_MAX_RECORDS); // One combining record each.
+        exit(1);
+    }
+    if (print_stats) {
+        placement_counters_start(&place_counters); // Inherited by every thread created below.
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
     // Starting method.
     start_consumers_producers(consumers, producers, seed);
     
@@ -299,14 +1794,39 @@ int main(int argc, char* argv[]) {
         pthread_join(consumers_threads[i], NULL);
     }
     
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (consume_mode == CONSUME_AGGREGATE) {
+        finish_aggregate();
+    }
+    if (print_stats) {
+        print_run_stats((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    }
+    if (telemetry) {
+        print_telemetry();
+    }
+
     // Handle memory allocation.
+    if (dist_mode == DIST_STEAL) {
+        for (int i = 0; i < consumers; i++) {
+            ws_deque_destroy(&consumer_deques[i]);
+        }
+        free(consumer_deques);
+        free(local_pops);
+        free(steals);
+    }
+    if (queue_mode == QUEUE_LOCKFREE) {
+        ms_queue_destroy(&lf_queue);
+    }
+    node_pool_destroy(&queue_nodes);
     free(producers_threads);
     free(consumers_threads);
     free(producer_ids);
     free(consumer_ids);
+    placement_destroy(&place);
+    seg_bitmap_destroy(&generated_flags);
+    condition_variable_destroy(&queue_cond);
 
     // Testing.
-    //printf("Total produced: %d\n", atomic_load(&generated_count));
     //printf("Total consumed: %d\n", atomic_load(&consumed_count));
 
 
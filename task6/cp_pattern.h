@@ -17,7 +17,7 @@ void stop_consumers();
 void print_msg(const char* msg);
 
 /*
- * Waits until all numbers between 0 and 1,000,000 have been produced.
+ * Waits until every number of the range (--range, 1,000,000 by default) has been produced.
  */
 void wait_until_producers_produced_all_numbers();
 
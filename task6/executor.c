@@ -0,0 +1,240 @@
+#include "executor.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include "local_storage.h" // Per-worker pointer (task5).
+
+/**
+ * Runs a task and releases its future.
+ * @param f The task.
+ */
+static void run_task(executor_future* f) {
+    f->result = f->fn(f->arg);
+    latch_count_down(&f->done); // Publishes 'result' to executor_future_wait.
+}
+
+/**
+ * Takes a task for worker 'w': its own deque first, then the others starting from its neighbour.
+ * @param w The worker.
+ * @return The task, or NULL if every deque was empty.
+ */
+static executor_future* find_task(executor_worker* w) {
+    executor* ex = w->ex;
+    int64_t task;
+    if (ws_deque_take(&w->queue, &task)) {
+        return (executor_future*)(intptr_t)task;
+    }
+    for (int i = 1; i < ex->nworkers; i++) {
+        if (ws_deque_take(&ex->workers[(w->id + i) % ex->nworkers].queue, &task)) {
+            atomic_fetch_add_explicit(&w->stolen, 1, memory_order_relaxed);
+            return (executor_future*)(intptr_t)task;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Runs one queued task on worker 'w', if there is one.
+ * @param w The worker.
+ * @return 1 if a task ran, 0 if every deque was empty.
+ */
+static int run_one(executor_worker* w) {
+    executor_future* f = find_task(w);
+    if (f == NULL) {
+        return 0;
+    }
+    atomic_fetch_add_explicit(&w->executed, 1, memory_order_relaxed); // Before the future completes, so its waiter's stats include it.
+    run_task(f);
+    return 1;
+}
+
+/**
+ * Checks every deque with seq_cst loads (the recheck after eventcount_prepare_wait).
+ * @param ex The executor.
+ * @return 1 if all deques are empty.
+ */
+static int all_empty(executor* ex) {
+    for (int i = 0; i < ex->nworkers; i++) {
+        if (!ws_deque_empty(&ex->workers[i].queue)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Worker thread: runs tasks until shutdown, parking on 'idle' while there are none.
+ * @param arg The executor_worker.
+ * @return NULL.
+ */
+static void* worker_main(void* arg) {
+    executor_worker* w = arg;
+    executor* ex = w->ex;
+    tls_thread_alloc();
+    set_tls_data(w);
+    while (1) {
+        if (run_one(w)) {
+            continue;
+        }
+        int key = eventcount_prepare_wait(&ex->idle);
+        if (!all_empty(ex)) {
+            eventcount_cancel_wait(&ex->idle);
+            continue;
+        }
+        if (atomic_load_explicit(&ex->stopping, memory_order_seq_cst)) {
+            eventcount_cancel_wait(&ex->idle);
+            break; // Nothing left anywhere and nothing more will come.
+        }
+        eventcount_commit_wait(&ex->idle, key);
+    }
+    tls_thread_free();
+    return NULL;
+}
+
+/**
+ * Creates the workers and their deques.
+ * @param ex The executor.
+ * @param workers Number of worker threads.
+ */
+void executor_init(executor* ex, int workers) {
+    ex->nworkers = workers;
+    ex->workers = malloc(sizeof(executor_worker) * workers);
+    atomic_init(&ex->next, 0);
+    eventcount_init(&ex->idle);
+    atomic_init(&ex->stopping, 0);
+    atomic_init(&ex->inline_runs, 0);
+    for (int i = 0; i < workers; i++) { // Every deque exists before any worker starts stealing.
+        executor_worker* w = &ex->workers[i];
+        w->ex = ex;
+        w->id = i;
+        ws_deque_init(&w->queue, EXECUTOR_QUEUE_CAPACITY);
+        atomic_init(&w->executed, 0);
+        atomic_init(&w->stolen, 0);
+    }
+    for (int i = 0; i < workers; i++) {
+        pthread_create(&ex->workers[i].thread, NULL, worker_main, &ex->workers[i]);
+    }
+}
+
+/**
+ * Lets the workers drain the deques, then joins them.
+ * @param ex The executor.
+ */
+void executor_shutdown(executor* ex) {
+    atomic_store_explicit(&ex->stopping, 1, memory_order_seq_cst); // Precedes the idle check.
+    eventcount_notify_all(&ex->idle);
+    for (int i = 0; i < ex->nworkers; i++) {
+        pthread_join(ex->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < ex->nworkers; i++) {
+        ws_deque_destroy(&ex->workers[i].queue);
+    }
+    free(ex->workers);
+    ex->workers = NULL;
+}
+
+/**
+ * Fills in the future and makes it a pending task.
+ */
+static void prepare_future(executor_future* f, executor_fn fn, void* arg) {
+    f->fn = fn;
+    f->arg = arg;
+    f->result = NULL;
+    latch_init(&f->done, 1);
+}
+
+/**
+ * Pushes a prepared task, trying the deques from 'start' on; runs it inline if all are full.
+ * The push publishes with a seq_cst store, which the eventcount notify requires.
+ * @param ex The executor.
+ * @param f The task.
+ * @param start First worker to try.
+ */
+static void push_task(executor* ex, executor_future* f, unsigned start) {
+    for (int i = 0; i < ex->nworkers; i++) {
+        if (ws_deque_push(&ex->workers[(start + i) % ex->nworkers].queue, (int64_t)(intptr_t)f)) {
+            eventcount_notify_one(&ex->idle);
+            return;
+        }
+    }
+    atomic_fetch_add_explicit(&ex->inline_runs, 1, memory_order_relaxed);
+    run_task(f); // Backpressure: the submitter does the work itself.
+}
+
+/**
+ * Submits a task to the next worker in round-robin order.
+ * @param ex The executor.
+ * @param f The future to fill in; owned by the caller until the task has run.
+ * @param fn The task function.
+ * @param arg Its argument.
+ */
+void executor_submit(executor* ex, executor_future* f, executor_fn fn, void* arg) {
+    prepare_future(f, fn, arg);
+    push_task(ex, f, atomic_fetch_add_explicit(&ex->next, 1, memory_order_relaxed));
+}
+
+/**
+ * Submits a task to the calling worker's own deque. Only valid inside a task of 'ex'.
+ * @param ex The executor.
+ * @param f The future to fill in.
+ * @param fn The task function.
+ * @param arg Its argument.
+ */
+void executor_submit_local(executor* ex, executor_future* f, executor_fn fn, void* arg) {
+    executor_worker* w = get_tls_data();
+    prepare_future(f, fn, arg);
+    push_task(ex, f, (unsigned)w->id);
+}
+
+/**
+ * Waits for a task to finish.
+ * @param f The future.
+ * @return The task's result.
+ */
+void* executor_future_wait(executor_future* f) {
+    latch_wait(&f->done);
+    return f->result;
+}
+
+/**
+ * Waits for a task from inside another task, running queued tasks meanwhile. Once every
+ * deque is empty 'f' has been taken, so the latch wait ends when its taker finishes it.
+ * @param ex The executor.
+ * @param f The future.
+ * @return The task's result.
+ */
+void* executor_future_help(executor* ex, executor_future* f) {
+    (void)ex;
+    executor_worker* w = get_tls_data();
+    while (!latch_try_wait(&f->done)) {
+        if (!run_one(w)) {
+            latch_wait(&f->done);
+        }
+    }
+    return f->result;
+}
+
+/**
+ * Returns the calling worker's index (only valid inside a task).
+ * @return The index.
+ */
+int executor_worker_id(void) {
+    executor_worker* w = get_tls_data();
+    return w->id;
+}
+
+/**
+ * Sums the per-worker statistics.
+ * @param ex The executor.
+ * @param executed Out: tasks run by workers.
+ * @param stolen Out: tasks a worker took from another worker's deque.
+ * @param inline_runs Out: tasks their submitter ran because every deque was full.
+ */
+void executor_stats(executor* ex, long* executed, long* stolen, long* inline_runs) {
+    *executed = 0;
+    *stolen = 0;
+    for (int i = 0; i < ex->nworkers; i++) {
+        *executed += atomic_load_explicit(&ex->workers[i].executed, memory_order_relaxed);
+        *stolen += atomic_load_explicit(&ex->workers[i].stolen, memory_order_relaxed);
+    }
+    *inline_runs = atomic_load_explicit(&ex->inline_runs, memory_order_relaxed);
+}
@@ -0,0 +1,111 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "ws_deque.h"
+#include "latch.h"
+#include "eventcount.h"
+
+#define EXECUTOR_QUEUE_CAPACITY 4096 // Tasks each worker's deque can hold.
+
+/*
+ * Task function: runs on a worker, its return value becomes the future's result.
+ */
+typedef void* (*executor_fn)(void* arg);
+
+/*
+ * A submitted task and its completion handle in one, owned by the submitter (no
+ * allocation per task). It must stay alive until executor_future_wait returns.
+ */
+typedef struct {
+    executor_fn fn;
+    void* arg;
+    void* result; // Valid once 'done' is released.
+    latch done; // Counted down when the task has run.
+} executor_future;
+
+struct executor;
+
+/*
+ * One worker thread and its task deque. Submitters push at the bottom; the worker and
+ * idle thieves take from the top, so tasks start in submission order per deque.
+ */
+typedef struct {
+    struct executor* ex;
+    int id; // Index in ex->workers.
+    ws_deque queue;
+    pthread_t thread;
+    atomic_long executed; // Statistics: tasks run by this worker.
+    atomic_long stolen; // Statistics: of those, taken from another worker's deque.
+} executor_worker;
+
+/*
+ * Fixed-size thread pool. Workers are created once and park on an eventcount while
+ * every deque is empty, so a submit costs a deque push and one load while workers are
+ * busy. Each worker registers itself in task5's thread-local storage, which is how a
+ * task finds the worker it runs on (executor_worker_id, executor_submit_local).
+ */
+typedef struct executor {
+    executor_worker* workers;
+    int nworkers;
+    atomic_uint next; // Round-robin cursor of executor_submit.
+    eventcount idle; // Workers with nothing to take sleep here.
+    atomic_int stopping; // Set by executor_shutdown.
+    atomic_long inline_runs; // Statistics: tasks run by the submitter because every deque was full.
+} executor;
+
+/*
+ * Starts 'workers' worker threads. Workers register in task5's g_tls, so init_storage()
+ * must have run and MAX_THREADS bounds the workers of all executors together.
+ */
+void executor_init(executor* ex, int workers);
+
+/*
+ * Runs every task still queued, then stops and joins the workers and frees the deques.
+ */
+void executor_shutdown(executor* ex);
+
+/*
+ * Queues fn(arg) on the next worker in round-robin order and returns at once.
+ * If every deque is full the caller runs the task itself.
+ */
+void executor_submit(executor* ex, executor_future* f, executor_fn fn, void* arg);
+
+/*
+ * From inside a task: queues fn(arg) on the calling worker's own deque (falling back to
+ * executor_submit), so related tasks stay on one worker unless someone steals them.
+ */
+void executor_submit_local(executor* ex, executor_future* f, executor_fn fn, void* arg);
+
+/*
+ * Blocks until the task has run and returns its result. A task that waits this way
+ * holds its worker meanwhile; if every worker does, nothing runs - tasks use
+ * executor_future_help instead.
+ */
+void* executor_future_wait(executor_future* f);
+
+/*
+ * From inside a task: runs other queued tasks until 'f' has run, then returns its result.
+ * Blocks only once nothing is queued, when 'f' is already running on another worker.
+ */
+void* executor_future_help(executor* ex, executor_future* f);
+
+/*
+ * Returns 1 if the task has run, without blocking.
+ */
+static inline int executor_future_ready(executor_future* f) {
+    return latch_try_wait(&f->done);
+}
+
+/*
+ * From inside a task: the index of the worker running it (for per-worker scratch data).
+ */
+int executor_worker_id(void);
+
+/*
+ * Reports tasks run by workers, how many of those were stolen, and tasks run inline by submitters.
+ */
+void executor_stats(executor* ex, long* executed, long* stolen, long* inline_runs);
+
+#endif // EXECUTOR_H
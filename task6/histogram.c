@@ -0,0 +1,61 @@
+#include "histogram.h"
+#include <string.h>
+
+/**
+ * Empties the histogram.
+ * @param h The histogram.
+ */
+void histogram_init(histogram* h) {
+    memset(h, 0, sizeof(*h));
+}
+
+/**
+ * Merges another histogram into this one.
+ * @param into The histogram to add to.
+ * @param from The histogram to add.
+ */
+void histogram_merge(histogram* into, const histogram* from) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->total += from->total;
+    into->sum += from->sum;
+    into->max = from->max > into->max ? from->max : into->max;
+}
+
+/**
+ * Returns the highest value that falls into a bucket.
+ * @param bucket The bucket.
+ */
+static uint64_t bucket_high(int bucket) {
+    int band = bucket >> HISTOGRAM_SUB_BITS;
+    uint64_t sub = (uint64_t)(bucket & (HISTOGRAM_SUB_BUCKETS - 1));
+    if (band == 0) {
+        return sub;
+    }
+    int shift = band - 1;
+    return (((HISTOGRAM_SUB_BUCKETS + sub + 1) << shift) - 1);
+}
+
+/**
+ * Finds the value at a quantile by walking the buckets.
+ * @param h The histogram.
+ * @param q The quantile, 0..1 (0.5 for the median).
+ * @return The value, within the bucket resolution.
+ */
+uint64_t histogram_quantile(const histogram* h, double q) {
+    if (h->total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * (double)h->total);
+    rank = rank < 1 ? 1 : rank > h->total ? h->total : rank;
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t high = bucket_high(i);
+            return high < h->max ? high : h->max;
+        }
+    }
+    return h->max;
+}
@@ -0,0 +1,61 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+#define HISTOGRAM_SUB_BITS 5 // log2 of the buckets per power of two: values are kept to within 1/32.
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+/*
+ * Log-linear (HDR-style) histogram of 64-bit values: exact below HISTOGRAM_SUB_BUCKETS,
+ * then HISTOGRAM_SUB_BUCKETS equal buckets per power of two, so every recorded value
+ * is known to within about 3% at a fixed 15 KiB. Recording is an index computation
+ * and an increment; a histogram belongs to one thread, and histograms are merged
+ * for reporting once their threads are done.
+ */
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total; // Values recorded.
+    uint64_t max; // Largest value recorded, exactly.
+    uint64_t sum; // For the mean (wraps only after 2^64).
+} histogram;
+
+/*
+ * Empties the histogram.
+ */
+void histogram_init(histogram* h);
+
+/*
+ * Returns the bucket of a value.
+ */
+static inline int histogram_bucket(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (int)value;
+    }
+    int shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS; // Bits below the kept ones.
+    return ((shift + 1) << HISTOGRAM_SUB_BITS) | (int)((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/*
+ * Records one value.
+ */
+static inline void histogram_record(histogram* h, uint64_t value) {
+    h->counts[histogram_bucket(value)]++;
+    h->total++;
+    h->sum += value;
+    h->max = value > h->max ? value : h->max;
+}
+
+/*
+ * Adds the counts of 'from' to 'into'.
+ */
+void histogram_merge(histogram* into, const histogram* from);
+
+/*
+ * Returns the value at quantile q (0..1): the highest value of the bucket holding
+ * it, capped at the recorded maximum. 0 for an empty histogram.
+ */
+uint64_t histogram_quantile(const histogram* h, double q);
+
+#endif // HISTOGRAM_H
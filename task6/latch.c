@@ -0,0 +1,71 @@
+#include "latch.h"
+#include "sync_wait.h" // Spin policy and futex wait/wake.
+
+/**
+ * Initializes the latch.
+ * @param l Pointer to the latch.
+ * @param count Number of count-downs before waiters are released.
+ */
+void latch_init(latch* l, int count) {
+    atomic_init(&l->count, count);
+}
+
+/**
+ * Counts the latch down by one. Extra count-downs after zero are ignored.
+ * @param l Pointer to the latch.
+ */
+void latch_count_down(latch* l) {
+    int count = atomic_load_explicit(&l->count, memory_order_relaxed);
+    // Release: publishes the caller's writes to the waiters. The flag comes back with the
+    // old value, so nothing reads the latch after the CAS that zeroes it.
+    while ((count & ~LATCH_SLEEPING) > 0
+           && !atomic_compare_exchange_weak_explicit(&l->count, &count, count - 1,
+                                                     memory_order_release, memory_order_relaxed)) {
+        // 'count' was reloaded by the failed CAS.
+    }
+    if (count == (1 | LATCH_SLEEPING)) {
+        // The latch may be gone by now; a wake on a dead address finds nobody or wakes a
+        // futex waiter spuriously, which every waiter tolerates.
+        sync_futex_wake(&l->count, SYNC_WAKE_ALL, SYNC_BITSET_ALL, SYNC_PRIVATE);
+    }
+}
+
+/**
+ * Sleeps until the count reaches zero.
+ * @param l Pointer to the latch.
+ */
+void latch_wait(latch* l) {
+    latch_wait_until(l, NULL);
+}
+
+/**
+ * Sleeps until the count reaches zero or the deadline passes.
+ * @param l Pointer to the latch.
+ * @param deadline Absolute CLOCK_MONOTONIC deadline, or NULL to wait forever.
+ * @return 0 once the count reached zero, -1 on timeout.
+ */
+int latch_wait_until(latch* l, const struct timespec* deadline) {
+    int budget = sync_backoff_budget(NULL);
+    for (int round = 0; round < budget; ) {
+        if (latch_try_wait(l)) {
+            return 0;
+        }
+        sync_backoff(&round, NULL);
+    }
+    int count = atomic_load_explicit(&l->count, memory_order_acquire);
+    while ((count & ~LATCH_SLEEPING) > 0) {
+        if (!(count & LATCH_SLEEPING)) {
+            // Set the flag in the word the last count-down swaps, so it can't miss us.
+            if (!atomic_compare_exchange_weak_explicit(&l->count, &count, count | LATCH_SLEEPING,
+                                                       memory_order_acquire, memory_order_acquire)) {
+                continue; // 'count' was reloaded.
+            }
+            count |= LATCH_SLEEPING;
+        }
+        if (sync_futex_wait(&l->count, count, SYNC_BITSET_ALL, SYNC_PRIVATE, deadline) == SYNC_TIMEDOUT) {
+            return -1;
+        }
+        count = atomic_load_explicit(&l->count, memory_order_acquire);
+    }
+    return 0;
+}
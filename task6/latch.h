@@ -0,0 +1,47 @@
+#ifndef LATCH_H
+#define LATCH_H
+
+#include <stdatomic.h>
+#include <time.h> // For struct timespec.
+
+#define LATCH_SLEEPING (1 << 30) // Flag in 'count': a waiter may be asleep.
+
+/*
+ * Single-use countdown latch.
+ * Waiters sleep in the kernel until the count reaches zero. The sleeping flag lives in
+ * the count word, so the final count-down touches the latch only in its RMW: a waiter
+ * may free the latch as soon as it sees zero (a future on the waiter's stack, say).
+ */
+typedef struct {
+    atomic_int count; // Remaining count-downs | LATCH_SLEEPING; also the futex word.
+} latch;
+
+/*
+ * Initializes the latch with 'count' pending count-downs.
+ */
+void latch_init(latch* l, int count);
+
+/*
+ * Decrements the count (never below zero); the call that reaches zero wakes every waiter.
+ */
+void latch_count_down(latch* l);
+
+/*
+ * Returns 1 if the count already reached zero, without blocking.
+ */
+static inline int latch_try_wait(latch* l) {
+    return (atomic_load_explicit(&l->count, memory_order_acquire) & ~LATCH_SLEEPING) == 0; // Pairs with the count-downs.
+}
+
+/*
+ * Blocks until the count reaches zero.
+ */
+void latch_wait(latch* l);
+
+/*
+ * Blocks until the count reaches zero or the absolute CLOCK_MONOTONIC 'deadline' passes.
+ * Returns 0 if the count reached zero, -1 on timeout.
+ */
+int latch_wait_until(latch* l, const struct timespec* deadline);
+
+#endif // LATCH_H
@@ -0,0 +1,127 @@
+#include "ms_queue.h"
+#include <stdlib.h>
+
+/*
+ * Memory ordering: every shared pointer access is seq_cst, as ebr.h requires of readers
+ * and of the unlinking CAS (plain loads and locked instructions on x86 either way).
+ */
+
+/**
+ * Frees a reclaimed node (the domain's free function).
+ * @param ctx Unused.
+ * @param ptr The node.
+ */
+static void free_node(void* ctx, void* ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+/**
+ * Initializes the queue with a dummy node.
+ * @param q The queue.
+ * @param mode Reclamation mode of its nodes.
+ */
+void ms_queue_init(ms_queue* q, int mode) {
+    ebr_init(&q->reclaim, mode, 0, sizeof(ms_node), free_node);
+    ms_node* dummy = malloc(sizeof(ms_node));
+    dummy->birth = atomic_load_explicit(&q->reclaim.epoch, memory_order_relaxed);
+    atomic_init(&dummy->next, NULL);
+    atomic_init(&q->head, dummy);
+    atomic_init(&q->tail, dummy);
+}
+
+/**
+ * Frees the nodes still linked and the deferred ones.
+ * @param q The queue.
+ */
+void ms_queue_destroy(ms_queue* q) {
+    ms_node* n = atomic_load_explicit(&q->head, memory_order_relaxed);
+    while (n != NULL) {
+        ms_node* next = atomic_load_explicit(&n->next, memory_order_relaxed);
+        free(n);
+        n = next;
+    }
+    ebr_destroy(&q->reclaim);
+}
+
+/**
+ * Appends a value: links a new node after the tail, then swings the tail to it
+ * (or helps a push that linked its node but hasn't swung the tail yet).
+ * @param q The queue.
+ * @param t The calling thread's reclamation handle.
+ * @param value The value.
+ */
+void ms_queue_push(ms_queue* q, ebr_thread* t, int64_t value) {
+    ms_node* node = malloc(sizeof(ms_node));
+    node->value = value;
+    node->birth = ebr_alloc(t);
+    atomic_init(&node->next, NULL);
+    ebr_enter(t);
+    while (1) {
+        ms_node* tail = atomic_load_explicit(&q->tail, memory_order_seq_cst);
+        if (!ebr_validate(t)) {
+            continue;
+        }
+        ms_node* next = atomic_load_explicit(&tail->next, memory_order_seq_cst);
+        if (tail != atomic_load_explicit(&q->tail, memory_order_seq_cst)) {
+            continue; // The tail moved under us.
+        }
+        if (next == NULL) {
+            if (atomic_compare_exchange_strong_explicit(&tail->next, &next, node, memory_order_seq_cst,
+                                                        memory_order_seq_cst)) {
+                // Linked. If this fails another thread already swung the tail for us.
+                atomic_compare_exchange_strong_explicit(&q->tail, &tail, node, memory_order_seq_cst,
+                                                        memory_order_seq_cst);
+                break;
+            }
+        } else {
+            atomic_compare_exchange_strong_explicit(&q->tail, &tail, next, memory_order_seq_cst,
+                                                    memory_order_seq_cst); // Help the lagging push.
+        }
+    }
+    ebr_exit(t);
+}
+
+/**
+ * Takes the oldest value: its node becomes the new dummy and the old dummy is retired.
+ * @param q The queue.
+ * @param t The calling thread's reclamation handle.
+ * @param value Out: the value.
+ * @return 1 on success, 0 if the queue was empty.
+ */
+int ms_queue_pop(ms_queue* q, ebr_thread* t, int64_t* value) {
+    ms_node* head;
+    ebr_enter(t);
+    while (1) {
+        head = atomic_load_explicit(&q->head, memory_order_seq_cst);
+        if (!ebr_validate(t)) {
+            continue;
+        }
+        ms_node* tail = atomic_load_explicit(&q->tail, memory_order_seq_cst);
+        ms_node* next = atomic_load_explicit(&head->next, memory_order_seq_cst);
+        if (!ebr_validate(t)) {
+            continue; // 'next' is dereferenced below.
+        }
+        if (head != atomic_load_explicit(&q->head, memory_order_seq_cst)) {
+            continue;
+        }
+        if (next == NULL) {
+            ebr_exit(t);
+            return 0;
+        }
+        if (head == tail) {
+            atomic_compare_exchange_strong_explicit(&q->tail, &tail, next, memory_order_seq_cst,
+                                                    memory_order_seq_cst); // Tail lags behind a push - help it.
+            continue;
+        }
+        int64_t v = next->value; // Before the CAS: afterwards another pop may retire 'next'.
+        if (atomic_compare_exchange_strong_explicit(&q->head, &head, next, memory_order_seq_cst,
+                                                    memory_order_seq_cst)) {
+            *value = v;
+            break;
+        }
+    }
+    ebr_exit(t);
+    ebr_retire(t, head, head->birth); // Only this pop unlinked it, so it is ours until retired.
+    return 1;
+}
@@ -0,0 +1,55 @@
+#ifndef MS_QUEUE_H
+#define MS_QUEUE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "ebr.h"
+
+/*
+ * Node of the lock-free queue. 'birth' is its allocation epoch for interval reclamation.
+ */
+typedef struct ms_node {
+    int64_t value;
+    uint64_t birth;
+    struct ms_node* _Atomic next;
+} ms_node;
+
+/*
+ * Unbounded lock-free FIFO queue (Michael-Scott, with a dummy head node).
+ * Nodes are malloc'd and, once dequeued, retired to the queue's reclamation domain
+ * rather than freed, since other threads may still be reading them.
+ * Every thread registers an ebr_thread in 'reclaim' before its first operation:
+ *
+ *     ebr_thread t;
+ *     ebr_thread_register(&q.reclaim, &t, NULL);
+ *     ms_queue_push(&q, &t, 42);
+ *     ...
+ *     ebr_thread_unregister(&t);
+ */
+typedef struct {
+    _Alignas(64) ms_node* _Atomic head; // Dummy node; the first value is in head->next.
+    _Alignas(64) ms_node* _Atomic tail; // Last node, or one behind it while a push is finishing.
+    ebr_domain reclaim;
+} ms_queue;
+
+/*
+ * Initializes an empty queue whose nodes are reclaimed in 'mode' (EBR_EPOCH or EBR_INTERVAL).
+ */
+void ms_queue_init(ms_queue* q, int mode);
+
+/*
+ * Frees the remaining nodes. No thread may use the queue or still be registered.
+ */
+void ms_queue_destroy(ms_queue* q);
+
+/*
+ * Appends a value.
+ */
+void ms_queue_push(ms_queue* q, ebr_thread* t, int64_t value);
+
+/*
+ * Takes the oldest value. Returns 1 on success, 0 if the queue was empty.
+ */
+int ms_queue_pop(ms_queue* q, ebr_thread* t, int64_t* value);
+
+#endif // MS_QUEUE_H
@@ -0,0 +1,250 @@
+#define _GNU_SOURCE // For MAP_HUGETLB and MADV_HUGEPAGE.
+#include "node_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define HUGE_PAGE_SIZE (2UL << 20) // Default x86-64 huge page.
+
+/**
+ * Checks whether a node was carved from the slab (as opposed to malloc).
+ */
+static int in_arena(node_pool* pool, node_t* node) {
+    return pool != NULL && pool->arena != NULL && node >= pool->arena && node < pool->arena + pool->capacity;
+}
+
+/**
+ * Pushes a chain of free nodes (linked through 'next') on the global stack.
+ * The tag in the high half of the head makes a concurrent pop of a recycled head fail its CAS (ABA).
+ * @param pool Pointer to the pool.
+ * @param head First node of the chain.
+ */
+static void push_batch(node_pool* pool, node_t* head) {
+    uint32_t idx = (uint32_t)(head - pool->arena);
+    uint64_t old = atomic_load_explicit(&pool->free_batches, memory_order_relaxed);
+    uint64_t new_head;
+    do {
+        atomic_store_explicit(&pool->batch_next[idx], (uint32_t)old, memory_order_relaxed);
+        new_head = (((old >> 32) + 1) << 32) | (idx + 1);
+        // Release publishes batch_next and the chain's links to the popper.
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_batches, &old, new_head,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+/**
+ * Pops a chain of free nodes from the global stack.
+ * @param pool Pointer to the pool.
+ * @return The first node of the chain, or NULL if the stack is empty.
+ */
+static node_t* pop_batch(node_pool* pool) {
+    // Acquire (here and on a failed CAS, which reloads 'old'): batch_next of the head we read.
+    uint64_t old = atomic_load_explicit(&pool->free_batches, memory_order_acquire);
+    while ((uint32_t)old != 0) {
+        uint32_t idx = (uint32_t)old - 1;
+        uint32_t next = atomic_load_explicit(&pool->batch_next[idx], memory_order_relaxed);
+        uint64_t new_head = (((old >> 32) + 1) << 32) | next;
+        if (atomic_compare_exchange_weak_explicit(&pool->free_batches, &old, new_head,
+                                                  memory_order_acquire, memory_order_acquire)) {
+            return &pool->arena[idx];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Refills an empty cache: first from batches other threads returned,
+ * then by carving a fresh batch from the untouched part of the slab.
+ * Leaves the cache empty if the slab is exhausted.
+ * @param cache Pointer to the calling thread's cache.
+ */
+static void cache_refill(node_cache* cache) {
+    node_pool* pool = cache->pool;
+    if (pool == NULL || pool->arena == NULL) {
+        return;
+    }
+    node_t* head = pop_batch(pool);
+    if (head != NULL) {
+        int count = 0;
+        for (node_t* n = head; n != NULL; n = n->next) {
+            count++;
+        }
+        cache->free_list = head;
+        cache->free_count = count;
+        cache->refills++;
+        return;
+    }
+    size_t start = atomic_fetch_add_explicit(&pool->carved, NODE_BATCH, memory_order_relaxed); // Just hands out ranges.
+    if (start >= pool->capacity) {
+        return; // Slab exhausted.
+    }
+    size_t count = pool->capacity - start < NODE_BATCH ? pool->capacity - start : NODE_BATCH;
+    for (size_t i = 0; i < count; i++) {
+        pool->arena[start + i].next = (i + 1 < count) ? &pool->arena[start + i + 1] : NULL;
+    }
+    cache->free_list = &pool->arena[start];
+    cache->free_count = (int)count;
+    cache->carves++;
+}
+
+/**
+ * Initializes the pool and maps its slab.
+ * The slab is touched up front so that steady-state allocation never page-faults.
+ * @param pool Pointer to the pool.
+ * @param capacity Number of nodes in the slab; 0 disables the pool.
+ * @param hugepages Non-zero to back the slab with huge pages when possible.
+ * @return 0 on success, -1 if the mapping failed.
+ */
+int node_pool_init(node_pool* pool, size_t capacity, int hugepages) {
+    pool->arena = NULL;
+    pool->batch_next = NULL;
+    pool->capacity = 0;
+    pool->mapped_bytes = 0;
+    pool->huge = 0;
+    atomic_init(&pool->carved, 0);
+    atomic_init(&pool->free_batches, 0);
+    atomic_init(&pool->hits, 0);
+    atomic_init(&pool->refills, 0);
+    atomic_init(&pool->carves, 0);
+    atomic_init(&pool->returns, 0);
+    atomic_init(&pool->fallbacks, 0);
+    if (capacity == 0) {
+        return 0; // Pool disabled.
+    }
+
+    // Nodes first, then the batch link array.
+    size_t bytes = capacity * (sizeof(node_t) + sizeof(uint32_t));
+    void* mem = MAP_FAILED;
+    if (hugepages) {
+        size_t huge_bytes = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        mem = mmap(NULL, huge_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (mem != MAP_FAILED) {
+            bytes = huge_bytes;
+            pool->huge = 1;
+        }
+    }
+    if (mem == MAP_FAILED) {
+        mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            return -1;
+        }
+        if (hugepages && madvise(mem, bytes, MADV_HUGEPAGE) == 0) {
+            pool->huge = 2; // No hugetlbfs pages reserved - ask for transparent huge pages instead.
+        }
+        memset(mem, 0, bytes); // Pre-fault after the THP hint so the kernel can use huge pages.
+    }
+    pool->arena = mem;
+    pool->batch_next = (_Atomic uint32_t*)(pool->arena + capacity);
+    pool->capacity = capacity;
+    pool->mapped_bytes = bytes;
+    return 0;
+}
+
+/**
+ * Unmaps the slab.
+ * @param pool Pointer to the pool.
+ */
+void node_pool_destroy(node_pool* pool) {
+    if (pool->arena != NULL) {
+        munmap(pool->arena, pool->mapped_bytes);
+        pool->arena = NULL;
+    }
+}
+
+/**
+ * Prints allocation counters and the cache hit rate.
+ * @param pool Pointer to the pool.
+ */
+void node_pool_print_stats(node_pool* pool) {
+    long hits = atomic_load_explicit(&pool->hits, memory_order_relaxed);
+    long refills = atomic_load_explicit(&pool->refills, memory_order_relaxed);
+    long carves = atomic_load_explicit(&pool->carves, memory_order_relaxed);
+    long fallbacks = atomic_load_explicit(&pool->fallbacks, memory_order_relaxed);
+    long allocs = hits + refills + carves + fallbacks;
+    const char* backing = pool->arena == NULL ? "disabled" : pool->huge == 1 ? "hugetlb" : pool->huge == 2 ? "thp" : "4k pages";
+    printf("Node pool: capacity %zu (%s), allocations %ld, cache hits %.2f%%, refills %ld, carves %ld, returns %ld, malloc fallbacks %ld\n",
+           pool->capacity, backing, allocs, allocs ? 100.0 * hits / allocs : 0.0, refills, carves, atomic_load_explicit(&pool->returns, memory_order_relaxed), fallbacks);
+}
+
+/**
+ * Attaches an empty cache to the pool.
+ * @param cache Pointer to the cache.
+ * @param pool Pointer to the pool (may be disabled).
+ */
+void node_cache_init(node_cache* cache, node_pool* pool) {
+    cache->pool = pool;
+    cache->free_list = NULL;
+    cache->free_count = 0;
+    cache->hits = cache->refills = cache->carves = cache->returns = cache->fallbacks = 0;
+}
+
+/**
+ * Returns every cached node to the pool and publishes the local counters.
+ * @param cache Pointer to the cache.
+ */
+void node_cache_flush(node_cache* cache) {
+    node_pool* pool = cache->pool;
+    if (cache->free_list != NULL) {
+        push_batch(pool, cache->free_list);
+        cache->free_list = NULL;
+        cache->free_count = 0;
+        cache->returns++;
+    }
+    atomic_fetch_add_explicit(&pool->hits, cache->hits, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->refills, cache->refills, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->carves, cache->carves, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->returns, cache->returns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->fallbacks, cache->fallbacks, memory_order_relaxed);
+    cache->hits = cache->refills = cache->carves = cache->returns = cache->fallbacks = 0;
+}
+
+/**
+ * Allocates a node: a pop from the thread cache, refilled a batch at a time.
+ * @param cache Pointer to the calling thread's cache.
+ * @return The node, or a malloc'd node once the slab is exhausted.
+ */
+node_t* node_alloc(node_cache* cache) {
+    node_t* node = cache->free_list;
+    if (node != NULL) {
+        cache->hits++;
+    } else {
+        cache_refill(cache);
+        node = cache->free_list;
+        if (node == NULL) {
+            cache->fallbacks++;
+            return malloc(sizeof(node_t));
+        }
+    }
+    cache->free_list = node->next;
+    cache->free_count--;
+    return node;
+}
+
+/**
+ * Frees a node into the thread cache. Once the cache holds two batches,
+ * one batch goes back to the global stack for the threads that allocate.
+ * @param cache Pointer to the calling thread's cache.
+ * @param node The node to free.
+ */
+void node_free(node_cache* cache, node_t* node) {
+    if (!in_arena(cache->pool, node)) {
+        free(node); // malloc fallback (or pool disabled).
+        return;
+    }
+    node->next = cache->free_list;
+    cache->free_list = node;
+    cache->free_count++;
+    if (cache->free_count >= 2 * NODE_BATCH) {
+        // Detach the first NODE_BATCH nodes and hand them back.
+        node_t* head = cache->free_list;
+        node_t* tail = head;
+        for (int i = 1; i < NODE_BATCH; i++) {
+            tail = tail->next;
+        }
+        cache->free_list = tail->next;
+        cache->free_count -= NODE_BATCH;
+        tail->next = NULL;
+        push_batch(cache->pool, head);
+        cache->returns++;
+    }
+}
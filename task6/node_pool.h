@@ -0,0 +1,84 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NODE_BATCH 64 // Nodes moved between a thread cache and the global pool at once.
+
+// Queue node structure. will use us for communication between producers to consumers.
+typedef struct node {
+    int64_t value;
+    struct node* next;
+} node_t;
+
+/*
+ * Slab of queue nodes carved from one pre-sized mapping.
+ * Threads allocate from private caches; full batches travel between caches through
+ * a lock-free stack, so steady-state allocation is a pointer pop with no syscalls
+ * and no allocator locks. Requests beyond the capacity fall back to malloc.
+ */
+typedef struct {
+    node_t* arena; // The slab (NULL when the pool is disabled).
+    _Atomic uint32_t* batch_next; // Per node: index + 1 of the next free batch (only meaningful for batch heads).
+    size_t capacity; // Nodes in the slab.
+    size_t mapped_bytes; // Size of the mapping.
+    int huge; // 1 if backed by MAP_HUGETLB, 2 if THP was requested with madvise.
+    atomic_size_t carved; // Nodes handed out from the slab so far.
+    _Atomic uint64_t free_batches; // Stack head: ABA tag in the high half, batch head index + 1 in the low half.
+    atomic_long hits; // Allocations served by a thread cache.
+    atomic_long refills; // Batches taken from the global stack.
+    atomic_long carves; // Batches carved from untouched slab space.
+    atomic_long returns; // Batches returned to the global stack.
+    atomic_long fallbacks; // Allocations served by malloc.
+} node_pool;
+
+/*
+ * Per-thread node cache. Lives in the thread that owns it; never shared.
+ */
+typedef struct {
+    node_pool* pool;
+    node_t* free_list; // Cached free nodes.
+    int free_count; // Length of free_list.
+    long hits, refills, carves, returns, fallbacks; // Local counters, added to the pool on flush.
+} node_cache;
+
+/*
+ * Maps a slab of 'capacity' nodes. 'capacity' 0 disables the pool (plain malloc/free).
+ * With 'hugepages' set, tries MAP_HUGETLB first and falls back to a THP hint.
+ * Returns 0 on success, -1 if the mapping failed (the pool is then disabled).
+ */
+int node_pool_init(node_pool* pool, size_t capacity, int hugepages);
+
+/*
+ * Unmaps the slab. All caches must have been flushed.
+ */
+void node_pool_destroy(node_pool* pool);
+
+/*
+ * Prints allocation counters and the cache hit rate.
+ */
+void node_pool_print_stats(node_pool* pool);
+
+/*
+ * Attaches an empty cache to the pool.
+ */
+void node_cache_init(node_cache* cache, node_pool* pool);
+
+/*
+ * Returns the cached nodes to the pool and publishes the cache's counters.
+ */
+void node_cache_flush(node_cache* cache);
+
+/*
+ * Allocates a node through the calling thread's cache.
+ */
+node_t* node_alloc(node_cache* cache);
+
+/*
+ * Frees a node through the calling thread's cache (it may come from any thread's cache).
+ */
+void node_free(node_cache* cache, node_t* node);
+
+#endif // NODE_POOL_H
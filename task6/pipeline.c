@@ -0,0 +1,230 @@
+#include "pipeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Identifies a worker thread to pipeline_worker.
+typedef struct {
+    pipeline* p;
+    int stage;
+    int worker;
+} pipeline_worker_arg;
+
+/**
+ * Returns the current monotonic time in nanoseconds.
+ */
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/**
+ * Initializes a channel with room for 'capacity' slots.
+ */
+static void channel_init(pipeline_channel* ch, int capacity) {
+    ch->items = malloc(sizeof(void*) * capacity);
+    ch->capacity = capacity;
+    ch->head = 0;
+    ch->count = 0;
+    ch->closed = 0;
+    ticketlock_init(&ch->lock);
+    condition_variable_init(&ch->not_empty);
+    condition_variable_init(&ch->not_full);
+}
+
+/**
+ * Frees a channel's slot array and its condition variables' eventfds.
+ */
+static void channel_destroy(pipeline_channel* ch) {
+    free(ch->items);
+    condition_variable_destroy(&ch->not_empty);
+    condition_variable_destroy(&ch->not_full);
+}
+
+/**
+ * Queues a slot, blocking while the channel is full.
+ */
+static void channel_push(pipeline_channel* ch, void* slot) {
+    ticketlock_acquire(&ch->lock);
+    while (ch->count == ch->capacity) {
+        condition_variable_wait(&ch->not_full, &ch->lock); // Backpressure on the upstream stage.
+    }
+    ch->items[(ch->head + ch->count) % ch->capacity] = slot;
+    ch->count++;
+    condition_variable_signal(&ch->not_empty);
+    ticketlock_release(&ch->lock);
+}
+
+/**
+ * Takes the oldest slot, blocking while the channel is empty and still open.
+ * @return The slot, or NULL once the channel is closed and drained.
+ */
+static void* channel_pop(pipeline_channel* ch) {
+    ticketlock_acquire(&ch->lock);
+    while (ch->count == 0 && !ch->closed) {
+        condition_variable_wait(&ch->not_empty, &ch->lock);
+    }
+    void* slot = NULL;
+    if (ch->count > 0) {
+        slot = ch->items[ch->head];
+        ch->head = (ch->head + 1) % ch->capacity;
+        ch->count--;
+        condition_variable_signal(&ch->not_full);
+    }
+    ticketlock_release(&ch->lock);
+    return slot;
+}
+
+/**
+ * Marks the channel closed and wakes every consumer so they can drain and exit.
+ */
+static void channel_close(pipeline_channel* ch) {
+    ticketlock_acquire(&ch->lock);
+    ch->closed = 1;
+    condition_variable_broadcast(&ch->not_empty);
+    ticketlock_release(&ch->lock);
+}
+
+/**
+ * Worker thread: pops slots from the stage's input, runs the stage function on them
+ * and routes them on. The last worker of a stage to finish closes the next channel,
+ * which lets the downstream stage drain and shut down in turn.
+ * @param arg Pointer to the worker's pipeline_worker_arg.
+ */
+static void* pipeline_worker(void* arg) {
+    pipeline_worker_arg* a = arg;
+    pipeline* p = a->p;
+    pipeline_stage* st = &p->stages[a->stage];
+    pipeline_channel* free_pool = &p->channels[0];
+    pipeline_channel* out = a->stage + 1 < p->nstages ? &p->channels[a->stage + 1] : free_pool;
+    void* slot;
+    while ((slot = channel_pop(&p->channels[a->stage])) != NULL) {
+        long start = now_ns();
+        int result = st->fn(slot, st->ctx, a->worker);
+        atomic_fetch_add_explicit(&st->busy_ns, now_ns() - start, memory_order_relaxed);
+        if (result == PIPELINE_FORWARD) {
+            atomic_fetch_add_explicit(&st->items, 1, memory_order_relaxed);
+            channel_push(out, slot);
+        } else {
+            channel_push(free_pool, slot); // Dropped or unused.
+            if (result == PIPELINE_END) {
+                break;
+            }
+            atomic_fetch_add_explicit(&st->items, 1, memory_order_relaxed);
+        }
+    }
+    // acq_rel: the last worker out closes the channel after every other worker's pushes.
+    if (atomic_fetch_sub_explicit(&st->running, 1, memory_order_acq_rel) == 1 && a->stage + 1 < p->nstages) {
+        channel_close(&p->channels[a->stage + 1]); // Last worker out.
+    }
+    return NULL;
+}
+
+/**
+ * Initializes an empty pipeline and its slot pool.
+ * @param p Pointer to the pipeline.
+ * @param nslots Number of payload slots (items in flight).
+ * @param slot_size Size of each payload slot in bytes.
+ */
+void pipeline_init(pipeline* p, int nslots, size_t slot_size) {
+    p->nstages = 0;
+    p->slot_size = slot_size;
+    p->nslots = nslots;
+    p->slots = calloc(nslots, slot_size);
+    p->elapsed = 0;
+    channel_init(&p->channels[0], nslots); // Free slot pool.
+    for (int i = 0; i < nslots; i++) {
+        channel_push(&p->channels[0], p->slots + (size_t)i * slot_size);
+    }
+}
+
+/**
+ * Appends a stage.
+ * @param p Pointer to the pipeline.
+ * @param name Stage name for the statistics.
+ * @param fn Stage function.
+ * @param ctx Passed to every call of 'fn'.
+ * @param workers Number of worker threads.
+ * @param capacity Capacity of the stage's input channel (ignored for the first stage).
+ * @return The stage index, or -1 if there are too many stages.
+ */
+int pipeline_add_stage(pipeline* p, const char* name, pipeline_stage_fn fn, void* ctx, int workers, int capacity) {
+    if (p->nstages == PIPELINE_MAX_STAGES) {
+        return -1;
+    }
+    int s = p->nstages++;
+    pipeline_stage* st = &p->stages[s];
+    st->name = name;
+    st->fn = fn;
+    st->ctx = ctx;
+    st->workers = workers;
+    atomic_init(&st->running, workers);
+    atomic_init(&st->items, 0);
+    atomic_init(&st->busy_ns, 0);
+    st->threads = malloc(sizeof(pthread_t) * workers);
+    if (s > 0) {
+        channel_init(&p->channels[s], capacity);
+    }
+    return s;
+}
+
+/**
+ * Starts every worker and waits for the pipeline to drain.
+ * @param p Pointer to the pipeline.
+ */
+void pipeline_run(pipeline* p) {
+    int total = 0;
+    for (int s = 0; s < p->nstages; s++) {
+        total += p->stages[s].workers;
+    }
+    pipeline_worker_arg* args = malloc(sizeof(pipeline_worker_arg) * total);
+    long start = now_ns();
+    int k = 0;
+    for (int s = 0; s < p->nstages; s++) {
+        for (int w = 0; w < p->stages[s].workers; w++, k++) {
+            args[k].p = p;
+            args[k].stage = s;
+            args[k].worker = w;
+            pthread_create(&p->stages[s].threads[w], NULL, pipeline_worker, &args[k]);
+        }
+    }
+    for (int s = 0; s < p->nstages; s++) {
+        for (int w = 0; w < p->stages[s].workers; w++) {
+            pthread_join(p->stages[s].threads[w], NULL);
+        }
+    }
+    p->elapsed = (now_ns() - start) / 1e9;
+    free(args);
+}
+
+/**
+ * Prints per-stage statistics of the last run.
+ * @param p Pointer to the pipeline.
+ */
+void pipeline_print_stats(pipeline* p) {
+    printf("Pipeline: %d stages, %d slots, %.3f s\n", p->nstages, p->nslots, p->elapsed);
+    for (int s = 0; s < p->nstages; s++) {
+        pipeline_stage* st = &p->stages[s];
+        double capacity = p->elapsed * st->workers;
+        printf("Stage %d (%s): %d workers, %ld items, utilization %.1f%%\n", s, st->name, st->workers,
+               atomic_load_explicit(&st->items, memory_order_relaxed),
+               capacity > 0 ? 100.0 * atomic_load_explicit(&st->busy_ns, memory_order_relaxed) / 1e9 / capacity : 0.0);
+    }
+}
+
+/**
+ * Frees the slots, channels and thread arrays.
+ * @param p Pointer to the pipeline.
+ */
+void pipeline_destroy(pipeline* p) {
+    for (int s = 0; s < p->nstages; s++) {
+        free(p->stages[s].threads);
+        channel_destroy(&p->channels[s]);
+    }
+    if (p->nstages == 0) {
+        channel_destroy(&p->channels[0]);
+    }
+    free(p->slots);
+    p->nstages = 0;
+}
@@ -0,0 +1,96 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include "ticket_lock.h"
+#include "cond_var.h"
+
+#define PIPELINE_MAX_STAGES 8
+
+// Stage function results.
+#define PIPELINE_FORWARD 0 // Pass the slot to the next stage (the last stage frees it).
+#define PIPELINE_DROP 1 // Done with the slot - return it to the free pool.
+#define PIPELINE_END 2 // Source stage only: input exhausted, this worker stops.
+
+/*
+ * Stage function. Works on 'slot' in place; payloads are never copied between stages.
+ * The source stage (stage 0) receives an empty slot to fill.
+ * 'worker' is the index of the calling worker within its stage.
+ */
+typedef int (*pipeline_stage_fn)(void* slot, void* ctx, int worker);
+
+/*
+ * Bounded channel of slot pointers. Producers block while it is full (backpressure),
+ * consumers block while it is empty. Once closed, consumers drain it and then get NULL.
+ */
+typedef struct {
+    void** items; // Circular buffer.
+    int capacity; // Maximum number of queued slots.
+    int head; // Index of the oldest slot.
+    int count; // Queued slots.
+    int closed; // Set when the upstream stage has finished.
+    ticket_lock lock; // Protects the fields above.
+    condition_variable not_empty; // Signaled when a slot is queued or the channel closes.
+    condition_variable not_full; // Signaled when a slot is taken.
+} pipeline_channel;
+
+/*
+ * One stage: a function run by a fixed number of worker threads.
+ */
+typedef struct {
+    const char* name;
+    pipeline_stage_fn fn;
+    void* ctx;
+    int workers; // Parallelism.
+    atomic_int running; // Workers not finished yet; the last one closes the output channel.
+    atomic_long items; // Slots processed.
+    atomic_long busy_ns; // Time spent inside 'fn', over all workers.
+    pthread_t* threads;
+} pipeline_stage;
+
+/*
+ * A pipeline: stages connected by channels, plus the pool of payload slots.
+ * channels[0] holds free slots; channels[i] feeds stage i.
+ */
+typedef struct {
+    int nstages;
+    pipeline_stage stages[PIPELINE_MAX_STAGES];
+    pipeline_channel channels[PIPELINE_MAX_STAGES];
+    char* slots; // nslots * slot_size bytes.
+    size_t slot_size;
+    int nslots;
+    double elapsed; // Wall-clock seconds of the last pipeline_run.
+} pipeline;
+
+/*
+ * Initializes an empty pipeline with 'nslots' payload slots of 'slot_size' bytes.
+ * The number of slots bounds how many items are in flight at once.
+ */
+void pipeline_init(pipeline* p, int nslots, size_t slot_size);
+
+/*
+ * Appends a stage run by 'workers' threads. 'capacity' bounds the channel feeding it
+ * (ignored for the first stage, which is fed by the free slot pool).
+ * Returns the stage index, or -1 if PIPELINE_MAX_STAGES is exceeded.
+ */
+int pipeline_add_stage(pipeline* p, const char* name, pipeline_stage_fn fn, void* ctx, int workers, int capacity);
+
+/*
+ * Runs the pipeline until every source worker returned PIPELINE_END and every
+ * stage has drained its input. Blocks the caller.
+ */
+void pipeline_run(pipeline* p);
+
+/*
+ * Prints per-stage item counts and utilization (busy time / wall time / workers).
+ */
+void pipeline_print_stats(pipeline* p);
+
+/*
+ * Frees the slots and channels.
+ */
+void pipeline_destroy(pipeline* p);
+
+#endif // PIPELINE_H
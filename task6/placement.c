@@ -0,0 +1,393 @@
+#define _GNU_SOURCE // For sched_getaffinity, CPU_SET and pthread_attr_setaffinity_np.
+#include "placement.h"
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define SYSFS_CPU "/sys/devices/system/cpu"
+
+/**
+ * Parses a CPU list in the kernel's format ("0-3,8,10-11").
+ * @param s The list.
+ * @param out Out: the CPUs, in the order listed.
+ * @param max Room in 'out'.
+ * @return Number of CPUs, or -1 if the list is malformed or too long.
+ */
+static int parse_cpu_list(const char* s, int* out, int max) {
+    int n = 0;
+    while (*s != '\0' && *s != '\n') {
+        char* end;
+        long first = strtol(s, &end, 10);
+        long last = first;
+        if (end == s || first < 0) {
+            return -1;
+        }
+        if (*end == '-') {
+            s = end + 1;
+            last = strtol(s, &end, 10);
+            if (end == s || last < first) {
+                return -1;
+            }
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (n == max) {
+                return -1;
+            }
+            out[n++] = (int)cpu;
+        }
+        s = end;
+        if (*s == ',') {
+            s++;
+        } else if (*s != '\0' && *s != '\n') {
+            return -1;
+        }
+    }
+    return n;
+}
+
+/**
+ * Reads the first number of a sysfs file: an integer, or the lowest CPU of a CPU list.
+ * @param cpu The CPU whose directory to read.
+ * @param file Path below /sys/devices/system/cpu/cpuN.
+ * @return The number, or -1 if the file is missing or empty.
+ */
+static int read_sysfs(int cpu, const char* file) {
+    char path[128];
+    snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/%s", cpu, file);
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    int value;
+    if (fscanf(f, "%d", &value) != 1) {
+        value = -1;
+    }
+    fclose(f);
+    return value;
+}
+
+/**
+ * Finds the CPU's level-3 cache in sysfs.
+ * @param cpu The CPU.
+ * @return The lowest CPU sharing that cache, or -1.
+ */
+static int read_l3(int cpu) {
+    for (int index = 0; index < 8; index++) {
+        char file[64];
+        snprintf(file, sizeof(file), "cache/index%d/level", index);
+        int level = read_sysfs(cpu, file);
+        if (level < 0) {
+            return -1;
+        }
+        if (level == 3) {
+            snprintf(file, sizeof(file), "cache/index%d/shared_cpu_list", index);
+            return read_sysfs(cpu, file);
+        }
+    }
+    return -1;
+}
+
+// Sort key of one CPU; compared field by field.
+typedef struct {
+    int key[4];
+    int cpu;
+} order_key;
+
+/**
+ * qsort comparator for order_key.
+ */
+static int compare_keys(const void* a, const void* b) {
+    const order_key* x = a;
+    const order_key* y = b;
+    for (int i = 0; i < 4; i++) {
+        if (x->key[i] != y->key[i]) {
+            return x->key[i] < y->key[i] ? -1 : 1;
+        }
+    }
+    return x->cpu - y->cpu;
+}
+
+// Fields of placement_cpu that ranks and counts are taken over.
+enum { FIELD_CPU, FIELD_CORE, FIELD_L3, FIELD_PACKAGE };
+
+/**
+ * Reads one field of a CPU.
+ */
+static int field_of(const placement_cpu* c, int field) {
+    switch (field) {
+    case FIELD_CORE: return c->core;
+    case FIELD_L3: return c->l3;
+    case FIELD_PACKAGE: return c->package;
+    default: return c->cpu;
+    }
+}
+
+/**
+ * Checks whether cpus[i] is the first CPU with its value of 'field'.
+ */
+static int first_of_value(const placement* p, int i, int field) {
+    for (int j = 0; j < i; j++) {
+        if (field_of(&p->cpus[j], field) == field_of(&p->cpus[i], field)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Ranks cpus[i]'s value of 'field' among the distinct values found in its 'group'
+ * (its core among the cores of its L3, say).
+ * @return Number of distinct smaller values in the group.
+ */
+static int rank_in_group(const placement* p, int i, int group, int field) {
+    int rank = 0;
+    for (int j = 0; j < p->ncpus; j++) {
+        if (field_of(&p->cpus[j], group) == field_of(&p->cpus[i], group)
+            && field_of(&p->cpus[j], field) < field_of(&p->cpus[i], field) && first_of_value(p, j, field)) {
+            rank++;
+        }
+    }
+    return rank;
+}
+
+/**
+ * Counts the distinct values of a field.
+ */
+static int count_distinct(const placement* p, int field) {
+    int distinct = 0;
+    for (int i = 0; i < p->ncpus; i++) {
+        distinct += first_of_value(p, i, field);
+    }
+    return distinct;
+}
+
+/**
+ * Reads the topology of the allowed CPUs and builds the slot order.
+ * PLACE_COMPACT sorts by package, L3, core and CPU, so siblings are adjacent and a
+ * core's neighbours share its L3. PLACE_SCATTER sorts by sibling rank, core rank within
+ * the L3, L3 rank within the package and package, so consecutive slots land on
+ * different packages, then different L3s, then different cores.
+ * @param p The plan.
+ * @param strategy PLACE_NONE, PLACE_COMPACT, PLACE_SCATTER or PLACE_LIST.
+ * @param list PLACE_LIST: the CPUs.
+ * @return 0 on success, -1 on a bad list.
+ */
+int placement_init(placement* p, int strategy, const char* list) {
+    memset(p, 0, sizeof(*p));
+    p->strategy = strategy;
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        CPU_ZERO(&allowed);
+        CPU_SET(0, &allowed);
+    }
+    p->cpus = malloc(sizeof(placement_cpu) * CPU_COUNT(&allowed));
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        placement_cpu* c = &p->cpus[p->ncpus++];
+        c->cpu = cpu;
+        c->core = read_sysfs(cpu, "topology/thread_siblings_list");
+        c->core = c->core < 0 ? cpu : c->core;
+        c->package = read_sysfs(cpu, "topology/physical_package_id");
+        c->package = c->package < 0 ? 0 : c->package;
+        c->l3 = read_l3(cpu);
+        c->l3 = c->l3 < 0 ? c->core : c->l3;
+    }
+    for (int i = 0; i < p->ncpus; i++) {
+        p->cpus[i].smt = rank_in_group(p, i, FIELD_CORE, FIELD_CPU);
+    }
+    p->cores = count_distinct(p, FIELD_CORE);
+    p->l3s = count_distinct(p, FIELD_L3);
+    p->packages = count_distinct(p, FIELD_PACKAGE);
+
+    if (strategy == PLACE_LIST) {
+        p->order = malloc(sizeof(int) * CPU_SETSIZE);
+        p->count = parse_cpu_list(list, p->order, CPU_SETSIZE);
+        if (p->count <= 0) {
+            return -1;
+        }
+        for (int i = 0; i < p->count; i++) {
+            if (p->order[i] >= CPU_SETSIZE || !CPU_ISSET(p->order[i], &allowed)) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (strategy == PLACE_NONE) {
+        return 0;
+    }
+    order_key* keys = malloc(sizeof(order_key) * p->ncpus);
+    for (int i = 0; i < p->ncpus; i++) {
+        placement_cpu* c = &p->cpus[i];
+        keys[i].cpu = c->cpu;
+        if (strategy == PLACE_COMPACT) {
+            keys[i].key[0] = c->package;
+            keys[i].key[1] = c->l3;
+            keys[i].key[2] = c->core;
+            keys[i].key[3] = c->smt;
+        } else {
+            keys[i].key[0] = c->smt;
+            keys[i].key[1] = rank_in_group(p, i, FIELD_L3, FIELD_CORE);
+            keys[i].key[2] = rank_in_group(p, i, FIELD_PACKAGE, FIELD_L3);
+            keys[i].key[3] = c->package;
+        }
+    }
+    qsort(keys, p->ncpus, sizeof(order_key), compare_keys);
+    p->order = malloc(sizeof(int) * p->ncpus);
+    p->count = p->ncpus;
+    for (int i = 0; i < p->ncpus; i++) {
+        p->order[i] = keys[i].cpu;
+    }
+    free(keys);
+    return 0;
+}
+
+/**
+ * Frees the plan.
+ * @param p The plan.
+ */
+void placement_destroy(placement* p) {
+    free(p->cpus);
+    free(p->order);
+    p->cpus = NULL;
+    p->order = NULL;
+}
+
+/**
+ * Returns the CPU of a slot.
+ * @param p The plan.
+ * @param slot The thread's slot.
+ * @return The CPU, or -1 when placement is left to the scheduler.
+ */
+int placement_cpu_of(const placement* p, int slot) {
+    return p->strategy == PLACE_NONE || p->count == 0 ? -1 : p->order[slot % p->count];
+}
+
+/**
+ * Pins threads created with 'attr' to the slot's CPU from their first instruction,
+ * so they never run, and fill caches, elsewhere first.
+ * @param p The plan.
+ * @param attr Attributes for pthread_create.
+ * @param slot The thread's slot.
+ * @return 0, or the errno value of pthread_attr_setaffinity_np.
+ */
+int placement_set_attr(const placement* p, pthread_attr_t* attr, int slot) {
+    int cpu = placement_cpu_of(p, slot);
+    if (cpu < 0) {
+        return 0;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+}
+
+/**
+ * Prints the strategy, the topology, and each slot's CPU.
+ * @param p The plan.
+ * @param slots Slots in use.
+ */
+void placement_print(const placement* p, int slots) {
+    static const char* names[] = {"none", "compact", "scatter", "list"};
+    printf("Placement %s: %d CPUs, %d cores, %d L3 domains, %d packages", names[p->strategy], p->ncpus,
+           p->cores, p->l3s, p->packages);
+    if (p->strategy != PLACE_NONE) {
+        printf("; slots on CPUs");
+        for (int i = 0; i < slots; i++) {
+            printf("%c%d", i ? ',' : ' ', placement_cpu_of(p, i));
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * Opens a disabled, inherited counter on the calling thread.
+ * @param type PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE or PERF_TYPE_SOFTWARE.
+ * @param config The event.
+ * @return The counter, or -1 with errno set.
+ */
+static int open_counter(unsigned type, unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1; // Threads created later count into this counter.
+    attr.exclude_hv = 1;
+    int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0 && errno == EACCES) {
+        attr.exclude_kernel = 1; // perf_event_paranoid >= 2 still allows user-space counts.
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    return fd;
+}
+
+/**
+ * Opens the counters. Failures are remembered, not fatal.
+ * @param c The counters.
+ */
+void placement_counters_start(placement_counters* c) {
+    c->error = 0;
+    c->migrations_fd = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS);
+    c->llc_misses_fd = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    if (c->llc_misses_fd < 0) {
+        c->error = errno;
+    }
+    c->l1d_misses_fd = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    if (c->l1d_misses_fd < 0 && c->error == 0) {
+        c->error = errno;
+    }
+}
+
+/**
+ * Disables, reads and closes a counter.
+ * @param fd The counter, or -1.
+ * @return Its count, or -1 if it never opened.
+ */
+static long long close_counter(int fd) {
+    if (fd < 0) {
+        return -1;
+    }
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    long long count;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+        count = -1;
+    }
+    close(fd);
+    return count;
+}
+
+/**
+ * Prints CPU migrations and cache misses, per number where it helps comparing runs.
+ * @param c The counters.
+ * @param numbers Numbers the run produced.
+ */
+void placement_counters_print(placement_counters* c, long numbers) {
+    long long migrations = close_counter(c->migrations_fd);
+    long long llc = close_counter(c->llc_misses_fd);
+    long long l1d = close_counter(c->l1d_misses_fd);
+    if (migrations >= 0) {
+        printf("CPU migrations: %lld\n", migrations);
+    } else {
+        printf("CPU migrations: unavailable\n");
+    }
+    if (llc >= 0 || l1d >= 0) {
+        printf("Cache misses: LLC %lld (%.2f per number), L1D read %lld (%.2f per number)\n", llc,
+               (double)llc / numbers, l1d, (double)l1d / numbers);
+    }
+    if (c->error != 0) {
+        printf("Hardware cache counters unavailable: %s\n", strerror(c->error));
+    }
+}
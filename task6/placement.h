@@ -0,0 +1,90 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <pthread.h>
+
+#define PLACE_NONE 0 // Leave placement to the scheduler.
+#define PLACE_COMPACT 1 // Neighbouring slots on sibling hyperthreads, then cores sharing an L3.
+#define PLACE_SCATTER 2 // Neighbouring slots on different L3 domains, then different cores.
+#define PLACE_LIST 3 // Slots take the user's CPUs in the order given.
+
+/*
+ * One CPU the process may run on, as sysfs describes it.
+ */
+typedef struct {
+    int cpu;
+    int core; // Lowest CPU of its thread_siblings_list: unique per physical core.
+    int l3; // Lowest CPU sharing its last-level cache (its core when sysfs has no L3).
+    int package; // physical_package_id.
+    int smt; // Its position among its core's siblings.
+} placement_cpu;
+
+/*
+ * Thread placement plan. Threads are numbered by slot; slot i is pinned to
+ * order[i % count], so with PLACE_COMPACT slots 2k and 2k+1 share a core or an L3
+ * and with PLACE_SCATTER they are as far apart as the machine allows.
+ */
+typedef struct {
+    int strategy;
+    placement_cpu* cpus; // Allowed CPUs (sched_getaffinity), in CPU order.
+    int ncpus;
+    int* order; // CPU of each slot, modulo 'count'.
+    int count;
+    int cores, l3s, packages; // Distinct ones among 'cpus'.
+} placement;
+
+/*
+ * Reads the topology of the CPUs the process may run on from
+ * /sys/devices/system/cpu and orders them for 'strategy'. 'list' is the
+ * PLACE_LIST CPU list ("0-3,8,10-11"), ignored otherwise.
+ * Returns 0 on success, -1 if the list is malformed or names a CPU the process
+ * may not use.
+ */
+int placement_init(placement* p, int strategy, const char* list);
+
+/*
+ * Frees the plan.
+ */
+void placement_destroy(placement* p);
+
+/*
+ * Returns the CPU of a slot, or -1 for PLACE_NONE.
+ */
+int placement_cpu_of(const placement* p, int slot);
+
+/*
+ * Makes threads created with 'attr' start pinned to the slot's CPU
+ * (pthread_attr_setaffinity_np). A no-op for PLACE_NONE. Returns 0 or an errno value.
+ */
+int placement_set_attr(const placement* p, pthread_attr_t* attr, int slot);
+
+/*
+ * Prints the strategy, the topology it saw, and the CPUs of slots [0, slots).
+ */
+void placement_print(const placement* p, int slots);
+
+/*
+ * Process-wide hardware counters (perf_event_open), inherited by threads
+ * created after placement_counters_start. A counter the kernel refuses
+ * (perf_event_paranoid, no PMU in a VM) stays closed and is reported as such.
+ */
+typedef struct {
+    int migrations_fd; // PERF_COUNT_SW_CPU_MIGRATIONS.
+    int llc_misses_fd; // PERF_COUNT_HW_CACHE_MISSES: lines fetched past the last-level cache.
+    int l1d_misses_fd; // L1D read misses: includes lines another core owned.
+    int error; // errno of the first hardware counter that failed to open.
+} placement_counters;
+
+/*
+ * Opens and enables the counters on the calling thread; threads it creates
+ * from now on are counted too.
+ */
+void placement_counters_start(placement_counters* c);
+
+/*
+ * Stops the counters, prints them and closes them. Exited threads' counts are
+ * included, so call it after joining them.
+ */
+void placement_counters_print(placement_counters* c, long numbers);
+
+#endif // PLACEMENT_H
@@ -0,0 +1,203 @@
+#include "seg_bitmap.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define SEGMENT_BYTES (SEG_BITMAP_SEGMENT_BITS / 8)
+#define LEAF_SEGMENTS (1ULL << SEG_BITMAP_LEAF_SHIFT)
+
+/**
+ * Creates the bitmap's table directory and, with a path, its sparse backing file.
+ * @param b The bitmap.
+ * @param bits Size of the range.
+ * @param path Backing file, or NULL for anonymous memory.
+ * @return 0, or -1 if the file can't be created or sized.
+ */
+int seg_bitmap_init(seg_bitmap* b, uint64_t bits, const char* path) {
+    b->bits = bits;
+    b->segments = (bits + SEG_BITMAP_SEGMENT_BITS - 1) / SEG_BITMAP_SEGMENT_BITS;
+    b->leaves = (b->segments + LEAF_SEGMENTS - 1) / LEAF_SEGMENTS;
+    b->table = calloc(b->leaves, sizeof(*b->table));
+    if (b->table == NULL) {
+        printf("cannot allocate the table of a %llu-bit bitmap\n", (unsigned long long)bits);
+        exit(1);
+    }
+    b->fd = -1;
+    atomic_init(&b->mapped, 0);
+    atomic_init(&b->peak_mapped, 0);
+    atomic_init(&b->released, 0);
+    if (path != NULL) {
+        b->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (b->fd < 0 || ftruncate(b->fd, (off_t)((bits + 63) / 64 * 8)) != 0) {
+            if (b->fd >= 0) {
+                close(b->fd);
+            }
+            free(b->table);
+            b->table = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Unmaps the segments, frees the table and closes the file; a file-backed bitmap is
+ * complete on disk.
+ * @param b The bitmap.
+ */
+void seg_bitmap_destroy(seg_bitmap* b) {
+    for (uint64_t l = 0; l < b->leaves; l++) {
+        seg_bitmap_entry* leaf = atomic_load_explicit(&b->table[l], memory_order_relaxed);
+        if (leaf == NULL) {
+            continue;
+        }
+        uint64_t count = b->segments - l * LEAF_SEGMENTS < LEAF_SEGMENTS ? b->segments - l * LEAF_SEGMENTS : LEAF_SEGMENTS;
+        for (uint64_t i = 0; i < count; i++) {
+            _Atomic uint64_t* segment = atomic_load_explicit(&leaf[i], memory_order_relaxed);
+            if (segment != NULL) {
+                munmap((void*)segment, SEGMENT_BYTES);
+            }
+        }
+        free(leaf);
+    }
+    if (b->fd >= 0) {
+        close(b->fd);
+    }
+    free(b->table);
+    b->table = NULL;
+}
+
+/**
+ * Returns the table entry of a segment, allocating its leaf on first touch. Racing
+ * threads each allocate it and the loser of the CAS frees its copy.
+ * @param b The bitmap.
+ * @param index The segment.
+ * @return The entry.
+ */
+static seg_bitmap_entry* segment_entry(seg_bitmap* b, uint64_t index) {
+    _Atomic(seg_bitmap_entry*)* slot = &b->table[index >> SEG_BITMAP_LEAF_SHIFT];
+    // Acquire: the zeroed entries behind a leaf another thread installed.
+    seg_bitmap_entry* leaf = atomic_load_explicit(slot, memory_order_acquire);
+    if (leaf == NULL) {
+        uint64_t first = index & ~(LEAF_SEGMENTS - 1);
+        uint64_t count = b->segments - first < LEAF_SEGMENTS ? b->segments - first : LEAF_SEGMENTS;
+        seg_bitmap_entry* fresh = calloc(count, sizeof(*fresh));
+        if (fresh == NULL) {
+            printf("cannot allocate bitmap table leaf %llu\n", (unsigned long long)(index >> SEG_BITMAP_LEAF_SHIFT));
+            exit(1);
+        }
+        if (atomic_compare_exchange_strong_explicit(slot, &leaf, fresh, memory_order_acq_rel, memory_order_acquire)) {
+            leaf = fresh;
+        } else {
+            free(fresh); // Installed by another thread.
+        }
+    }
+    return &leaf[index & (LEAF_SEGMENTS - 1)];
+}
+
+/**
+ * Maps a segment on its first touch. Racing threads each map it and the loser of
+ * the CAS unmaps its copy (for a file both copies are the same pages).
+ * @param b The bitmap.
+ * @param bit Any bit of the segment.
+ * @return The segment's words.
+ */
+_Atomic uint64_t* seg_bitmap_segment(seg_bitmap* b, uint64_t bit) {
+    uint64_t index = bit >> SEG_BITMAP_SHIFT;
+    seg_bitmap_entry* entry = segment_entry(b, index);
+    // Acquire: the zeroed (or file) contents behind a pointer another thread installed.
+    _Atomic uint64_t* segment = atomic_load_explicit(entry, memory_order_acquire);
+    if (segment != NULL) {
+        return segment;
+    }
+    void* mem = b->fd >= 0
+        ? mmap(NULL, SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, b->fd, (off_t)(index * SEGMENT_BYTES))
+        : mmap(NULL, SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+        printf("cannot map bitmap segment %llu\n", (unsigned long long)index);
+        exit(1);
+    }
+    if (!atomic_compare_exchange_strong_explicit(entry, &segment, mem, memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+        munmap(mem, SEGMENT_BYTES);
+        return segment; // Installed by another thread.
+    }
+    long mapped = atomic_fetch_add_explicit(&b->mapped, 1, memory_order_relaxed) + 1;
+    if (mapped > atomic_load_explicit(&b->peak_mapped, memory_order_relaxed)) {
+        atomic_store_explicit(&b->peak_mapped, mapped, memory_order_relaxed); // Only reported.
+    }
+    return mem;
+}
+
+/**
+ * Finds the first clear bit in [lo, hi) of a segment, a word at a time.
+ * @param segment The segment's words.
+ * @param lo First bit offset to look at.
+ * @param hi Bit offset to stop at.
+ * @return The offset of the clear bit, or hi.
+ */
+static uint64_t scan_clear(_Atomic uint64_t* segment, uint64_t lo, uint64_t hi) {
+    if (lo >= hi) {
+        return hi;
+    }
+    uint64_t w = lo / 64;
+    uint64_t clear = ~atomic_load_explicit(&segment[w], memory_order_relaxed) & (~0ULL << (lo % 64));
+    while (clear == 0) {
+        if (++w * 64 >= hi) {
+            return hi;
+        }
+        clear = ~atomic_load_explicit(&segment[w], memory_order_relaxed);
+    }
+    uint64_t found = w * 64 + (uint64_t)__builtin_ctzll(clear);
+    return found < hi ? found : hi;
+}
+
+/**
+ * Finds a clear bit near 'from', wrapping around to 'begin'.
+ * @param b The bitmap.
+ * @param from Where to start looking.
+ * @param begin Start of the range (same segment as 'from').
+ * @param end End of the range (at most the end of that segment).
+ * @return The clear bit, or 'end' if the range is full.
+ */
+uint64_t seg_bitmap_next_clear(seg_bitmap* b, uint64_t from, uint64_t begin, uint64_t end) {
+    _Atomic uint64_t* segment = seg_bitmap_segment(b, begin);
+    uint64_t base = begin & ~(SEG_BITMAP_SEGMENT_BITS - 1);
+    uint64_t found = scan_clear(segment, from - base, end - base);
+    if (found == end - base) {
+        found = scan_clear(segment, begin - base, from - base);
+        if (found == from - base) {
+            return end;
+        }
+    }
+    return base + found;
+}
+
+/**
+ * Unmaps a segment for good; its memory (or page cache) goes back to the system.
+ * @param b The bitmap.
+ * @param segment Index of the segment.
+ */
+void seg_bitmap_release(seg_bitmap* b, uint64_t segment) {
+    _Atomic uint64_t* mem = atomic_exchange_explicit(segment_entry(b, segment), NULL, memory_order_relaxed);
+    if (mem != NULL) {
+        munmap((void*)mem, SEGMENT_BYTES);
+        atomic_fetch_sub_explicit(&b->mapped, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&b->released, 1, memory_order_relaxed);
+    }
+}
+
+/**
+ * Reports the bitmap's mapping statistics.
+ * @param b The bitmap.
+ * @param mapped_bytes Out: bytes mapped now.
+ * @param peak_bytes Out: most bytes mapped at once.
+ * @param released Out: segments released.
+ */
+void seg_bitmap_stats(seg_bitmap* b, size_t* mapped_bytes, size_t* peak_bytes, long* released) {
+    *mapped_bytes = (size_t)atomic_load_explicit(&b->mapped, memory_order_relaxed) * SEGMENT_BYTES;
+    *peak_bytes = (size_t)atomic_load_explicit(&b->peak_mapped, memory_order_relaxed) * SEGMENT_BYTES;
+    *released = atomic_load_explicit(&b->released, memory_order_relaxed);
+}
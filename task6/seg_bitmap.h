@@ -0,0 +1,82 @@
+#ifndef SEG_BITMAP_H
+#define SEG_BITMAP_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SEG_BITMAP_SHIFT 21 // log2 of the bits per segment.
+#define SEG_BITMAP_SEGMENT_BITS (1ULL << SEG_BITMAP_SHIFT) // 2 Mi bits = 256 KiB per segment.
+#define SEG_BITMAP_LEAF_SHIFT 20 // log2 of the segments per table leaf (8 MiB, 2^41 bits of range).
+
+typedef _Atomic(_Atomic uint64_t*) seg_bitmap_entry; // A segment, NULL until touched or after release.
+
+/*
+ * Bitmap over a 64-bit range, mapped one segment at a time on first touch.
+ * The segment table has two levels: a directory allocated up front (8 bytes per 2^41
+ * bits, 16 MiB for a 2^62 range) and leaves of up to 2^20 segments allocated on first touch,
+ * so memory follows the touched part of the range rather than its size, and a segment
+ * no thread will touch again can be unmapped. Bits are set with atomic RMWs, so
+ * threads may set bits concurrently; mapping races are settled with a CAS.
+ *
+ * With a path the segments are shared mappings of that file (sized, sparse, at
+ * creation), so the bitmap ends up on disk in the plain layout: bit v of the range
+ * is bit v % 64 of little-endian word v / 64.
+ */
+typedef struct {
+    uint64_t bits; // Size of the range.
+    uint64_t segments; // Segments covering the range.
+    uint64_t leaves; // Entries in 'table'.
+    _Atomic(seg_bitmap_entry*)* table; // Leaves of segment entries; NULL until one of their segments is touched.
+    int fd; // Backing file, or -1 for anonymous memory.
+    atomic_long mapped; // Segments mapped now.
+    atomic_long peak_mapped; // Statistics: most segments mapped at once.
+    atomic_long released; // Statistics: segments unmapped by seg_bitmap_release.
+} seg_bitmap;
+
+/*
+ * Sets up an all-zero bitmap of 'bits' bits, in anonymous memory or, if 'path' is
+ * not NULL, in that file (created or truncated). Returns 0, or -1 if the file can't
+ * be created or sized. Exits if the table can't be allocated.
+ */
+int seg_bitmap_init(seg_bitmap* b, uint64_t bits, const char* path);
+
+/*
+ * Unmaps every segment and closes the file. No thread may use the bitmap any more.
+ */
+void seg_bitmap_destroy(seg_bitmap* b);
+
+/*
+ * Returns the segment holding 'bit', mapping it if this is its first touch.
+ * Exits if the mapping fails.
+ */
+_Atomic uint64_t* seg_bitmap_segment(seg_bitmap* b, uint64_t bit);
+
+/*
+ * Sets a bit. Returns its previous value.
+ */
+static inline int seg_bitmap_set(seg_bitmap* b, uint64_t bit) {
+    _Atomic uint64_t* word = &seg_bitmap_segment(b, bit)[(bit % SEG_BITMAP_SEGMENT_BITS) / 64];
+    uint64_t mask = 1ULL << (bit % 64);
+    return (atomic_fetch_or_explicit(word, mask, memory_order_relaxed) & mask) != 0;
+}
+
+/*
+ * Returns the first clear bit at or after 'from' in [from, end), else the first one
+ * in [begin, from), else 'end'. The range must lie within one segment.
+ * Callers must not set bits of the range concurrently.
+ */
+uint64_t seg_bitmap_next_clear(seg_bitmap* b, uint64_t from, uint64_t begin, uint64_t end);
+
+/*
+ * Unmaps a segment that will not be touched again (anonymous contents are lost;
+ * a file keeps them). No thread may be using it.
+ */
+void seg_bitmap_release(seg_bitmap* b, uint64_t segment);
+
+/*
+ * Reports the bytes mapped now and at most, and the segments released.
+ */
+void seg_bitmap_stats(seg_bitmap* b, size_t* mapped_bytes, size_t* peak_bytes, long* released);
+
+#endif // SEG_BITMAP_H
@@ -0,0 +1,135 @@
+#include "shm_ring.h"
+#include <fcntl.h> // For O_* constants.
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * Maps and initializes a ring. The shm object is unlinked right after mapping:
+ * the mapping (and the children forked later) keep it alive, and nothing is left
+ * behind in /dev/shm if the program dies.
+ * @param capacity Number of slots.
+ * @return The ring, or NULL on failure.
+ */
+shm_ring* shm_ring_create(int capacity) {
+    char name[64];
+    snprintf(name, sizeof(name), "/shm_ring.%d", (int)getpid());
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    shm_unlink(name);
+    size_t size = sizeof(shm_ring) + sizeof(int64_t) * (size_t)capacity;
+    void* mem = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0) {
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+    shm_ring* ring = mem;
+    ticketlock_init_shared(&ring->lock);
+    condition_variable_init_shared(&ring->not_empty);
+    condition_variable_init_shared(&ring->not_full);
+    ring->head = 0;
+    ring->tail = 0;
+    ring->capacity = capacity;
+    ring->closed = 0;
+    ring->consumers_waiting = 0;
+    ring->producers_waiting = 0;
+    ring->size = size;
+    atomic_init(&ring->full_waits, 0);
+    atomic_init(&ring->empty_waits, 0);
+    return ring;
+}
+
+/**
+ * Unmaps the ring.
+ * @param ring The ring.
+ */
+void shm_ring_destroy(shm_ring* ring) {
+    munmap(ring, ring->size);
+}
+
+/**
+ * Appends a value. Signals only if a consumer waits, so a steady stream into a
+ * busy ring costs the lock and nothing else.
+ * @param ring The ring.
+ * @param value The value.
+ */
+void shm_ring_push(shm_ring* ring, int64_t value) {
+    ticketlock_acquire(&ring->lock);
+    if (ring->tail - ring->head == ring->capacity) {
+        atomic_fetch_add_explicit(&ring->full_waits, 1, memory_order_relaxed);
+        ring->producers_waiting++;
+        do {
+            condition_variable_wait(&ring->not_full, &ring->lock);
+        } while (ring->tail - ring->head == ring->capacity);
+        ring->producers_waiting--;
+    }
+    ring->values[ring->tail % ring->capacity] = value;
+    ring->tail++;
+    int wake = ring->consumers_waiting > 0;
+    ticketlock_release(&ring->lock);
+    if (wake) {
+        condition_variable_signal(&ring->not_empty);
+    }
+}
+
+/**
+ * Takes up to 'max' values. Wakes the producers waiting for room, and another
+ * waiting consumer if values are left over.
+ * @param ring The ring.
+ * @param values Out: the values taken.
+ * @param max Room in 'values'.
+ * @return How many values were taken, 0 once the ring is closed and drained.
+ */
+int shm_ring_pop(shm_ring* ring, int64_t* values, int max) {
+    ticketlock_acquire(&ring->lock);
+    if (ring->tail == ring->head && !ring->closed) {
+        atomic_fetch_add_explicit(&ring->empty_waits, 1, memory_order_relaxed);
+        ring->consumers_waiting++;
+        do {
+            condition_variable_wait(&ring->not_empty, &ring->lock);
+        } while (ring->tail == ring->head && !ring->closed);
+        ring->consumers_waiting--;
+    }
+    int n = 0;
+    while (n < max && ring->head < ring->tail) {
+        values[n++] = ring->values[ring->head % ring->capacity];
+        ring->head++;
+    }
+    int wake_producers = n > 0 && ring->producers_waiting > 0;
+    int wake_consumer = ring->tail > ring->head && ring->consumers_waiting > 0;
+    ticketlock_release(&ring->lock);
+    if (wake_producers) {
+        condition_variable_broadcast(&ring->not_full); // Each rechecks for room.
+    }
+    if (wake_consumer) {
+        condition_variable_signal(&ring->not_empty);
+    }
+    return n;
+}
+
+/**
+ * Closes the ring: pops drain what is left, then return 0.
+ * @param ring The ring.
+ */
+void shm_ring_close(shm_ring* ring) {
+    ticketlock_acquire(&ring->lock);
+    ring->closed = 1;
+    ticketlock_release(&ring->lock);
+    condition_variable_broadcast(&ring->not_empty);
+}
+
+/**
+ * Reports the ring's statistics.
+ * @param ring The ring.
+ * @param full_waits Out: pushes that had to wait for room.
+ * @param empty_waits Out: pops that had to wait for values.
+ */
+void shm_ring_stats(shm_ring* ring, long* full_waits, long* empty_waits) {
+    *full_waits = atomic_load_explicit(&ring->full_waits, memory_order_relaxed);
+    *empty_waits = atomic_load_explicit(&ring->empty_waits, memory_order_relaxed);
+}
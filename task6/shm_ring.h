@@ -0,0 +1,66 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ticket_lock.h"
+#include "cond_var.h"
+
+/*
+ * Bounded ring of 64-bit values in a shm_open/mmap region, for handing values between processes.
+ * Everything lives inside the mapping and is addressed by index, never by pointer, so
+ * the ring works wherever each process maps it. The lock and condition variables are
+ * the process-shared variants: an uncontended push or pop makes no syscall, and the
+ * values are written once into the ring and read once out of it.
+ * Create it before fork(); the children inherit the mapping.
+ */
+typedef struct {
+    ticket_lock lock; // Protects every plain field below.
+    condition_variable not_empty; // Consumers wait here while the ring is empty.
+    condition_variable not_full; // Producers wait here while the ring is full.
+    long head; // Values taken so far; the next one is at head % capacity.
+    long tail; // Values added so far.
+    int capacity; // Slots in 'values'.
+    int closed; // Set once no more values will be pushed.
+    int consumers_waiting; // Pops waiting on not_empty.
+    int producers_waiting; // Pushes waiting on not_full.
+    size_t size; // Bytes mapped, for munmap.
+    atomic_long full_waits; // Statistics: pushes that found the ring full.
+    atomic_long empty_waits; // Statistics: pops that found the ring empty.
+    int64_t values[]; // The slots.
+} shm_ring;
+
+/*
+ * Maps a new shared ring with 'capacity' slots. Returns NULL if the shared memory
+ * can't be created.
+ */
+shm_ring* shm_ring_create(int capacity);
+
+/*
+ * Unmaps the ring in the calling process.
+ */
+void shm_ring_destroy(shm_ring* ring);
+
+/*
+ * Appends a value, waiting while the ring is full.
+ */
+void shm_ring_push(shm_ring* ring, int64_t value);
+
+/*
+ * Takes up to 'max' values in FIFO order, waiting while the ring is empty.
+ * Returns how many were taken, 0 once the ring is closed and drained.
+ */
+int shm_ring_pop(shm_ring* ring, int64_t* values, int max);
+
+/*
+ * Marks the end of the input and wakes every waiting consumer.
+ */
+void shm_ring_close(shm_ring* ring);
+
+/*
+ * Reports pushes that found the ring full and pops that found it empty.
+ */
+void shm_ring_stats(shm_ring* ring, long* full_waits, long* empty_waits);
+
+#endif // SHM_RING_H
@@ -0,0 +1,88 @@
+#include "ws_deque.h"
+#include <stdlib.h>
+
+/**
+ * Initializes the deque.
+ * Rounds the capacity up to a power of two so indices wrap with a mask.
+ * @param dq Pointer to the deque.
+ * @param capacity Minimum number of values the deque must hold.
+ */
+void ws_deque_init(ws_deque* dq, long capacity) {
+    long size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    atomic_init(&dq->top, 0);
+    atomic_init(&dq->bottom, 0);
+    dq->mask = size - 1;
+    dq->items = malloc(sizeof(*dq->items) * size);
+    ticketlock_init(&dq->push_lock);
+}
+
+/**
+ * Frees the deque buffer.
+ * @param dq Pointer to the deque.
+ */
+void ws_deque_destroy(ws_deque* dq) {
+    free(dq->items);
+    dq->items = NULL;
+}
+
+/**
+ * Pushes a value at the bottom of the deque.
+ * The slot is written before 'bottom' is advanced, so a taker that sees the new
+ * bottom also sees the value.
+ * @param dq Pointer to the deque.
+ * @param value The value to push.
+ * @return 1 on success, 0 if the deque is full.
+ */
+int ws_deque_push(ws_deque* dq, int64_t value) {
+    ticketlock_acquire(&dq->push_lock);
+    long b = atomic_load_explicit(&dq->bottom, memory_order_relaxed); // Only pushers write it, under push_lock.
+    long t = atomic_load_explicit(&dq->top, memory_order_acquire); // The taker of slot b - size is done reading it.
+    if (b - t > dq->mask) { // Full - the slot at b still belongs to an untaken value.
+        ticketlock_release(&dq->push_lock);
+        return 0;
+    }
+    atomic_store_explicit(&dq->items[b & dq->mask], value, memory_order_relaxed);
+    // Publish. seq_cst rather than release: callers check for idle consumers right after
+    // (a store->load handshake), and this is cheaper than a separate fence.
+    atomic_store_explicit(&dq->bottom, b + 1, memory_order_seq_cst);
+    ticketlock_release(&dq->push_lock);
+    return 1;
+}
+
+/**
+ * Takes the value at the top of the deque (the steal operation of Chase-Lev).
+ * The value is read before the CAS on 'top': while top still equals t no producer
+ * can reuse that slot, and if the CAS fails someone else took it.
+ * @param dq Pointer to the deque.
+ * @param value Out: the taken value.
+ * @return 1 if a value was taken, 0 if the deque is empty.
+ */
+int ws_deque_take(ws_deque* dq, int64_t* value) {
+    while (1) {
+        long t = atomic_load_explicit(&dq->top, memory_order_relaxed); // A stale top only fails the CAS.
+        long b = atomic_load_explicit(&dq->bottom, memory_order_acquire); // Pairs with the push that published the slot.
+        if (t >= b) {
+            return 0; // Empty.
+        }
+        int64_t v = atomic_load_explicit(&dq->items[t & dq->mask], memory_order_relaxed);
+        // Release: our read of the slot happens before a pusher reuses it.
+        if (atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1, memory_order_release, memory_order_relaxed)) {
+            *value = v;
+            return 1;
+        }
+        // Lost the race for this slot - retry with the new top.
+    }
+}
+
+/**
+ * Checks whether the deque is empty.
+ * @param dq Pointer to the deque.
+ * @return 1 if empty, 0 otherwise.
+ */
+int ws_deque_empty(ws_deque* dq) {
+    // seq_cst: the load half of the idle-consumer handshake (see ws_deque_push).
+    return atomic_load_explicit(&dq->top, memory_order_seq_cst) >= atomic_load_explicit(&dq->bottom, memory_order_seq_cst);
+}
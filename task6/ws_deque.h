@@ -0,0 +1,49 @@
+#ifndef WS_DEQUE_H
+#define WS_DEQUE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "ticket_lock.h"
+
+/*
+ * Bounded work-stealing deque (Chase-Lev circular array).
+ * In cp_pattern each consumer owns one deque that producers fill, so the bottom
+ * end is shared by several producers and serialized by 'push_lock'. The top end is
+ * lock-free: the owning consumer and idle thieves both take from it with a CAS, so a
+ * local take only ever races with a steal.
+ */
+typedef struct {
+    atomic_long top; // Next index to take (consumers, CAS).
+    atomic_long bottom; // Next index to fill (producers, under push_lock).
+    long mask; // Capacity - 1 (capacity is a power of two).
+    _Atomic int64_t* items; // Circular buffer of values.
+    ticket_lock push_lock; // Serializes producers pushing into this deque.
+} ws_deque;
+
+/*
+ * Initializes the deque with room for at least 'capacity' values.
+ */
+void ws_deque_init(ws_deque* dq, long capacity);
+
+/*
+ * Frees the deque buffer.
+ */
+void ws_deque_destroy(ws_deque* dq);
+
+/*
+ * Appends a value at the bottom. Returns 1 on success, 0 if the deque is full.
+ */
+int ws_deque_push(ws_deque* dq, int64_t value);
+
+/*
+ * Takes the oldest value from the top. Returns 1 and stores it in 'value' on success,
+ * 0 if the deque is empty. Retries internally when it loses a race with another taker.
+ */
+int ws_deque_take(ws_deque* dq, int64_t* value);
+
+/*
+ * Returns 1 if the deque currently holds no values.
+ */
+int ws_deque_empty(ws_deque* dq);
+
+#endif // WS_DEQUE_H
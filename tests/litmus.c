@@ -0,0 +1,267 @@
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stress.h"
+#include "latch.h"
+#include "fc.h"
+#include "ws_deque.h"
+#include "ms_queue.h"
+#include "local_storage.h"
+#include "eventcount.h"
+#include "sharded_counter.h"
+
+#define DEFAULT_ITERATIONS 100000L
+
+/*
+ * Litmus-style tests of the memory_order choices, one per ordering argument the code
+ * relies on. The message-passing (MP) shapes write plain data, publish it through the
+ * primitive and check it on the other side: on x86 only the compiler can break them,
+ * but a ThreadSanitizer build (-DSYNC_TSAN=ON) reports any plain access the primitive's
+ * release/acquire pair does not order. The store-buffering (SB) shapes check the seq_cst
+ * handshakes: a forbidden outcome is counted, and a lost wakeup hangs the test until
+ * CTest's timeout fails it.
+ *
+ *   mp_latch      count-downs release, latch_try_wait acquires.
+ *   mp_ws_deque   push publishes a slot with 'bottom', take acquires it.
+ *   mp_ms_queue   push links a node with a seq_cst CAS, pop reads it after an acquire.
+ *   mp_fc         'op' carries arg to the combiner and the result back (release/acquire).
+ *   sb_counter    update then sum on two threads: both missing the other's update is forbidden.
+ *   sb_eventcount flag store then notify vs prepare_wait then recheck: no lost wakeup.
+ */
+
+static long iterations;
+
+/**
+ * Two-thread rendezvous: returns once both threads called it for 'round'.
+ */
+static void pair_sync(atomic_long* arrivals, long round) {
+    atomic_fetch_add_explicit(arrivals, 1, memory_order_acq_rel);
+    while (atomic_load_explicit(arrivals, memory_order_acquire) < 2 * round) {
+        sched_yield();
+    }
+}
+
+// mp_latch: one latch and one plain word per iteration.
+static latch* mp_latches;
+static long* mp_data;
+
+/**
+ * mp_latch: thread 0 writes and counts down, thread 1 polls and reads.
+ */
+static void* mp_latch_thread(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 0; i < iterations; i++) {
+        if (id == 0) {
+            mp_data[i] = i + 1;
+            latch_count_down(&mp_latches[i]);
+        } else {
+            while (!latch_try_wait(&mp_latches[i])) {
+                sched_yield();
+            }
+            CHECK(mp_data[i] == i + 1, "mp_latch %ld: read %ld", i, mp_data[i]);
+        }
+    }
+    return NULL;
+}
+
+// mp_ws_deque / mp_ms_queue: producers write payload[i], then pass i through the structure.
+#define MP_PRODUCERS 2
+#define MP_CONSUMERS 2
+static ws_deque mp_deque;
+static ms_queue mp_queue;
+static int use_queue; // mp_ms_queue rather than mp_ws_deque.
+static long* payload;
+static atomic_long taken; // Indices taken so far, to know when consumers are done.
+
+/**
+ * mp_ws_deque / mp_ms_queue thread: ids below MP_PRODUCERS produce, the others consume.
+ */
+static void* mp_pass_thread(void* arg) {
+    long id = *(long*)arg;
+    ebr_thread reclaim;
+    if (use_queue) {
+        ebr_thread_register(&mp_queue.reclaim, &reclaim, NULL);
+    }
+    if (id < MP_PRODUCERS) {
+        for (long i = id; i < iterations; i += MP_PRODUCERS) {
+            payload[i] = i * 3 + 1;
+            if (use_queue) {
+                ms_queue_push(&mp_queue, &reclaim, i);
+            } else {
+                while (!ws_deque_push(&mp_deque, i)) {
+                    sched_yield(); // Full.
+                }
+            }
+        }
+    } else {
+        while (atomic_load_explicit(&taken, memory_order_relaxed) < iterations) {
+            int64_t i;
+            if (use_queue ? ms_queue_pop(&mp_queue, &reclaim, &i) : ws_deque_take(&mp_deque, &i)) {
+                CHECK(payload[i] == i * 3 + 1, "%s %lld: read %ld", use_queue ? "mp_ms_queue" : "mp_ws_deque",
+                      (long long)i, payload[i]);
+                payload[i] = -1; // Written by the taker: a second take of the same index would race with it.
+                atomic_fetch_add_explicit(&taken, 1, memory_order_relaxed);
+            } else {
+                sched_yield();
+            }
+        }
+    }
+    if (use_queue) {
+        ebr_thread_unregister(&reclaim);
+        tls_thread_free();
+    }
+    return NULL;
+}
+
+// mp_fc: callers hand the combiner a plain request and read a plain reply.
+typedef struct {
+    long in; // Written by the caller before fc_execute.
+    long out; // Written by whichever thread combines.
+} fc_request;
+static fc_lock mp_fc_lock;
+static long fc_total; // Plain: the protected data, only touched by combiners.
+
+/**
+ * mp_fc operation: reads the request, updates the protected total, writes the reply.
+ */
+static void* fc_add(void* ctx, void* arg) {
+    fc_request* r = arg;
+    *(long*)ctx += r->in;
+    r->out = r->in * 2;
+    return r;
+}
+
+/**
+ * mp_fc thread: each call's reply must be visible once fc_execute returns.
+ */
+static void* mp_fc_thread(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 0; i < iterations; i++) {
+        fc_request r = { id + i, 0 };
+        fc_request* done = fc_execute(&mp_fc_lock, fc_add, &r);
+        CHECK(done == &r && r.out == (id + i) * 2, "mp_fc %ld/%ld: reply %ld", id, i, r.out);
+    }
+    fc_thread_exit(&mp_fc_lock);
+    return NULL;
+}
+
+// sb_counter: per iteration, each thread adds 1 and sums. Iterations alternate between two
+// counters; thread 0 clears the idle one while both threads are on the other.
+static sharded_counter sb_counters[2];
+static long* sb_seen[2]; // Plain: sb_seen[id][i] written by thread id only, read after the join.
+static atomic_long sb_arrivals;
+
+/**
+ * sb_counter thread: add, then sum; the sums are checked after the join.
+ */
+static void* sb_counter_thread(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 0; i < iterations; i++) {
+        pair_sync(&sb_arrivals, i + 1); // Both threads are done with iteration i - 1.
+        if (id == 0) {
+            sharded_counter_init(&sb_counters[(i + 1) % 2]);
+        }
+        sharded_counter_add(&sb_counters[i % 2], 1);
+        sb_seen[id][i] = sharded_counter_sum(&sb_counters[i % 2]);
+    }
+    return NULL;
+}
+
+// sb_eventcount: thread 0 sets 'posted' to i and notifies; thread 1 waits for it and answers on 'acked'.
+static eventcount sb_ec;
+static atomic_long posted;
+static atomic_long acked;
+static long sb_payload; // Plain: written before each post, read after the wait.
+
+/**
+ * Waits on sb_ec until 'word' reaches 'value' (the eventcount protocol of eventcount.h).
+ */
+static void ec_wait_for(atomic_long* word, long value) {
+    for (;;) {
+        if (atomic_load_explicit(word, memory_order_seq_cst) >= value) {
+            return;
+        }
+        int key = eventcount_prepare_wait(&sb_ec);
+        if (atomic_load_explicit(word, memory_order_seq_cst) >= value) {
+            eventcount_cancel_wait(&sb_ec);
+            return;
+        }
+        eventcount_commit_wait(&sb_ec, key);
+    }
+}
+
+/**
+ * sb_eventcount thread: ping-pong over the eventcount; a lost wakeup hangs.
+ */
+static void* sb_eventcount_thread(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 1; i <= iterations; i++) {
+        if (id == 0) {
+            sb_payload = i;
+            atomic_store_explicit(&posted, i, memory_order_seq_cst);
+            eventcount_notify_all(&sb_ec);
+            ec_wait_for(&acked, i);
+        } else {
+            ec_wait_for(&posted, i);
+            CHECK(sb_payload == i, "sb_eventcount %ld: read %ld", i, sb_payload);
+            atomic_store_explicit(&acked, i, memory_order_seq_cst);
+            eventcount_notify_all(&sb_ec);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+
+    mp_latches = malloc(sizeof(latch) * iterations);
+    mp_data = calloc(iterations, sizeof(long));
+    for (long i = 0; i < iterations; i++) {
+        latch_init(&mp_latches[i], 1);
+    }
+    stress_run(2, mp_latch_thread);
+    free(mp_latches);
+    free(mp_data);
+
+    payload = calloc(iterations, sizeof(long));
+    ws_deque_init(&mp_deque, 64); // Small, so pushes wrap around and reuse slots.
+    stress_run(MP_PRODUCERS + MP_CONSUMERS, mp_pass_thread);
+    ws_deque_destroy(&mp_deque);
+    CHECK(atomic_load(&taken) == iterations, "mp_ws_deque: %ld of %ld taken", atomic_load(&taken), iterations);
+
+    init_storage(); // Every ms_queue thread takes a TLS entry for its reclamation slot.
+    ms_queue_init(&mp_queue, EBR_EPOCH);
+    use_queue = 1;
+    atomic_store(&taken, 0);
+    memset(payload, 0, sizeof(long) * iterations);
+    stress_run(MP_PRODUCERS + MP_CONSUMERS, mp_pass_thread);
+    ms_queue_destroy(&mp_queue);
+    CHECK(atomic_load(&taken) == iterations, "mp_ms_queue: %ld of %ld taken", atomic_load(&taken), iterations);
+    free(payload);
+
+    fc_init(&mp_fc_lock, &fc_total);
+    stress_run(4, mp_fc_thread);
+    long expected = 0;
+    for (long id = 0; id < 4; id++) {
+        expected += iterations * id + iterations * (iterations - 1) / 2;
+    }
+    CHECK(fc_total == expected, "mp_fc: total %ld, expected %ld", fc_total, expected);
+
+    sharded_counter_init(&sb_counters[0]);
+    sb_seen[0] = malloc(sizeof(long) * iterations);
+    sb_seen[1] = malloc(sizeof(long) * iterations);
+    stress_run(2, sb_counter_thread);
+    long both_missed = 0;
+    for (long i = 0; i < iterations; i++) {
+        both_missed += sb_seen[0][i] == 1 && sb_seen[1][i] == 1;
+    }
+    CHECK(both_missed == 0, "sb_counter: both threads missed the other's update %ld times", both_missed);
+    free(sb_seen[0]);
+    free(sb_seen[1]);
+
+    eventcount_init(&sb_ec);
+    stress_run(2, sb_eventcount_thread);
+
+    return stress_exit("litmus");
+}
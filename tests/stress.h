@@ -0,0 +1,66 @@
+#ifndef STRESS_H
+#define STRESS_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Helpers shared by the stress and litmus programs. Each program is a CTest target that
+ * exits 0 on success; built with -DSYNC_TSAN=ON the same runs also check that every
+ * plain access is ordered by the primitive under test, which is what the memory_order
+ * choices have to guarantee.
+ */
+
+static atomic_int stress_failures = 0; // Failed CHECKs, reported by stress_exit.
+
+/*
+ * Records a failure (without stopping, so one run reports every broken property).
+ */
+#define CHECK(cond, ...)                                                \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("FAILED %s:%d: ", __FILE__, __LINE__);               \
+            printf(__VA_ARGS__);                                        \
+            printf("\n");                                               \
+            atomic_fetch_add(&stress_failures, 1);                      \
+        }                                                               \
+    } while (0)
+
+/*
+ * Starts 'n' threads running fn(id) with ids 0..n-1 and joins them.
+ */
+static inline void stress_run(int n, void* (*fn)(void*)) {
+    pthread_t* tids = malloc(sizeof(pthread_t) * n);
+    long* ids = malloc(sizeof(long) * n);
+    for (int i = 0; i < n; i++) {
+        ids[i] = i;
+        pthread_create(&tids[i], NULL, fn, &ids[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    free(tids);
+    free(ids);
+}
+
+/*
+ * Returns 1 if 'fd' is closed, as a primitive's eventfd must be after its *_destroy.
+ */
+static inline int stress_fd_closed(int fd) {
+    return fcntl(fd, F_GETFD) == -1 && errno == EBADF;
+}
+
+/*
+ * Prints the verdict and returns the exit status for main.
+ */
+static inline int stress_exit(const char* name) {
+    int failures = atomic_load(&stress_failures);
+    printf("%s: %s\n", name, failures == 0 ? "passed" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
+
+#endif // STRESS_H
@@ -0,0 +1,85 @@
+#include <stdlib.h>
+#include "stress.h"
+#include "barrier.h"
+
+#define DEFAULT_THREADS 7 // Odd, so tree levels end in partly filled nodes.
+#define DEFAULT_ROUNDS 20000L // Episodes per barrier variant.
+
+/*
+ * Barrier stress, over many episodes of the same barrier: the central one and
+ * combining trees of several fan-ins (including one wider than the party, a lone root).
+ * Every round each thread writes its slot and waits; after the wait it must see every
+ * slot of the round, so an early release or a thread let through into the next episode
+ * shows up as a stale slot. Slots alternate between two rows, so round r + 2 only
+ * overwrites a row once everybody has passed round r + 1. Exactly one thread per
+ * episode must be told it arrived last.
+ */
+
+static barrier bar;
+static int threads;
+static long rounds;
+static long* slots[2]; // Plain: slots[r % 2][id] written by thread id in round r.
+static int* last_arrivals; // Plain: per round, bumped by the thread barrier_wait returned 1 to.
+
+/**
+ * Stress thread: writes, waits, checks, for every round.
+ */
+static void* worker(void* arg) {
+    long id = *(long*)arg;
+    for (long r = 0; r < rounds; r++) {
+        long* row = slots[r % 2];
+        row[id] = r;
+        if (barrier_wait(&bar, (int)id)) {
+            last_arrivals[r]++;
+        }
+        for (int i = 0; i < threads; i++) {
+            CHECK(row[i] == r, "round %ld: thread %ld saw slot %d at %ld", r, id, i, row[i]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Runs every round on the barrier set up by the caller, then checks the last arrivals.
+ */
+static void run(const char* name) {
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < threads; j++) {
+            slots[i][j] = -1;
+        }
+    }
+    for (long r = 0; r < rounds; r++) {
+        last_arrivals[r] = 0;
+    }
+    stress_run(threads, worker);
+    long wrong = 0;
+    for (long r = 0; r < rounds; r++) {
+        wrong += last_arrivals[r] != 1;
+    }
+    CHECK(wrong == 0, "%s: %ld episodes without exactly one last arrival", name, wrong);
+    CHECK(atomic_load(&bar.generation) == rounds, "%s: %d episodes released, expected %ld", name,
+          atomic_load(&bar.generation), rounds);
+    barrier_destroy(&bar);
+}
+
+int main(int argc, char* argv[]) {
+    threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    rounds = argc > 2 ? atol(argv[2]) : DEFAULT_ROUNDS;
+    slots[0] = malloc(sizeof(long) * threads);
+    slots[1] = malloc(sizeof(long) * threads);
+    last_arrivals = malloc(sizeof(int) * rounds);
+
+    barrier_init(&bar, threads);
+    run("central");
+    barrier_init_tree(&bar, threads, 2);
+    run("tree, fan-in 2");
+    barrier_init_tree(&bar, threads, 3);
+    run("tree, fan-in 3");
+    barrier_init_tree(&bar, threads, threads + 1);
+    run("tree, single node");
+
+    free(slots[0]);
+    free(slots[1]);
+    free(last_arrivals);
+    return stress_exit("stress_barrier");
+}
@@ -0,0 +1,147 @@
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include "stress.h"
+#include "cond_var.h"
+
+#define DEFAULT_WAITERS 8
+#define DEFAULT_ROUNDS 50L
+#define DEFAULT_ITEMS 100000L // Bounded-buffer phase: items per producer.
+#define BUFFER_SIZE 16
+#define PAIRS 3 // Bounded-buffer phase: producers and as many consumers.
+
+/*
+ * Condition variable stress. Phase one checks wait morphing: in every round all waiters
+ * park, then a broadcast under the external lock hands each of them its turn on that lock,
+ * and each waiter must sleep at most once per handoff (a requeued waiter woken by a release
+ * that doesn't serve it would park again). Phase two is a bounded buffer with signals on
+ * both conditions, checking that no item is lost or duplicated.
+ */
+
+static ticket_lock lock;
+static condition_variable cv;
+static int go; // Plain, under 'lock': this round's broadcast happened.
+static int ready; // Plain, under 'lock': waiters of this round that are waiting.
+static int woken; // Plain, under 'lock': waiters of this round that returned.
+
+/**
+ * Phase one waiter: waits for the round's broadcast.
+ */
+static void* herd_waiter(void* arg) {
+    (void)arg;
+    ticketlock_acquire(&lock);
+    ready++;
+    while (!go) {
+        condition_variable_wait(&cv, &lock);
+    }
+    woken++;
+    ticketlock_release(&lock);
+    return NULL;
+}
+
+// Phase two: a bounded buffer of item numbers.
+static condition_variable not_empty, not_full;
+static long buffer[BUFFER_SIZE]; // Plain, under 'lock'.
+static int count, head; // Plain, under 'lock'.
+static long items_per_producer;
+static char* seen; // One flag per item, set by its consumer.
+static long consumed; // Plain, under 'lock'.
+
+/**
+ * Phase two thread: ids below PAIRS produce, the others consume.
+ */
+static void* buffer_thread(void* arg) {
+    long id = *(long*)arg;
+    long total = items_per_producer * PAIRS;
+    if (id < PAIRS) {
+        for (long i = 0; i < items_per_producer; i++) {
+            ticketlock_acquire(&lock);
+            while (count == BUFFER_SIZE) {
+                condition_variable_wait(&not_full, &lock);
+            }
+            buffer[(head + count++) % BUFFER_SIZE] = id * items_per_producer + i;
+            condition_variable_signal(&not_empty);
+            ticketlock_release(&lock);
+        }
+        return NULL;
+    }
+    for (;;) {
+        ticketlock_acquire(&lock);
+        while (count == 0 && consumed < total) {
+            condition_variable_wait(&not_empty, &lock);
+        }
+        if (count == 0) { // Everything was consumed.
+            ticketlock_release(&lock);
+            return NULL;
+        }
+        long item = buffer[head];
+        head = (head + 1) % BUFFER_SIZE;
+        count--;
+        if (++consumed == total) {
+            condition_variable_broadcast(&not_empty); // Release the other consumers.
+        }
+        condition_variable_signal(&not_full);
+        ticketlock_release(&lock);
+        CHECK(!seen[item], "item %ld consumed twice", item);
+        seen[item] = 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int waiters = argc > 1 ? atoi(argv[1]) : DEFAULT_WAITERS;
+    long rounds = argc > 2 ? atol(argv[2]) : DEFAULT_ROUNDS;
+    items_per_producer = argc > 3 ? atol(argv[3]) : DEFAULT_ITEMS;
+
+    ticketlock_init(&lock);
+    condition_variable_init(&cv);
+    pthread_t* tids = malloc(sizeof(pthread_t) * waiters);
+    for (long r = 0; r < rounds; r++) {
+        go = ready = woken = 0;
+        for (int i = 0; i < waiters; i++) {
+            pthread_create(&tids[i], NULL, herd_waiter, NULL);
+        }
+        for (;;) {
+            ticketlock_acquire(&lock);
+            int all = ready == waiters;
+            ticketlock_release(&lock);
+            if (all) {
+                break;
+            }
+            sched_yield();
+        }
+        struct timespec settle = { 0, 2000000 }; // Past the waiters' spin budget, so they park.
+        nanosleep(&settle, NULL);
+        ticketlock_acquire(&lock);
+        go = 1;
+        condition_variable_broadcast(&cv);
+        ticketlock_release(&lock);
+        for (int i = 0; i < waiters; i++) {
+            pthread_join(tids[i], NULL);
+        }
+        CHECK(woken == waiters, "round %ld: %d of %d waiters returned", r, woken, waiters);
+    }
+    free(tids);
+    long handoffs, parks, spin_ns;
+    condition_variable_stats(&cv, &handoffs, &parks, &spin_ns);
+    printf("broadcast to %d waiters, %ld rounds: %ld handoffs, %.2f parks per handoff\n", waiters, rounds, handoffs,
+           handoffs ? (double)parks / handoffs : 0.0);
+    CHECK(handoffs == waiters * rounds, "%ld handoffs, expected %ld", handoffs, waiters * rounds);
+    CHECK(parks <= handoffs, "%ld parks for %ld handoffs: requeued waiters were woken out of turn", parks, handoffs);
+    int fd = condition_variable_event_fd(&cv);
+    CHECK(fd >= 0, "no eventfd");
+    condition_variable_destroy(&cv);
+    CHECK(stress_fd_closed(fd), "condition_variable_destroy left the eventfd open");
+
+    condition_variable_init(&not_empty);
+    condition_variable_init(&not_full);
+    seen = calloc(items_per_producer * PAIRS, 1);
+    stress_run(2 * PAIRS, buffer_thread);
+    CHECK(consumed == items_per_producer * PAIRS, "consumed %ld of %ld", consumed, items_per_producer * PAIRS);
+    for (long i = 0; i < items_per_producer * PAIRS; i++) {
+        CHECK(seen[i], "item %ld lost", i);
+    }
+    free(seen);
+    condition_variable_destroy(&not_empty);
+    condition_variable_destroy(&not_full);
+    return stress_exit("stress_cond_var");
+}
@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include <time.h>
+#include "stress.h"
+#include "latch.h"
+
+#define DEFAULT_THREADS 4
+#define DEFAULT_ROUNDS 300L
+#define EXTRA_WAITERS 2 // Even rounds: threads waiting besides main.
+
+/*
+ * Countdown latch stress. Each round fresh threads write their slot of a plain array and
+ * count down a heap latch; whoever waits on it must then see every slot. In odd rounds main
+ * is the only waiter and frees the latch as soon as its wait returns, while the last
+ * count-down may still be returning (latch.h allows that; ASan or TSan builds catch a
+ * count-down that touches the latch after its RMW). Even rounds add waiters with timed
+ * waits. Finally, a wait on a latch nobody counts down must time out.
+ */
+
+static int threads;
+static latch* current; // This round's latch.
+static long* slots; // Plain: slot i written by counter i before its count-down.
+static long round_number;
+
+/**
+ * Counter thread: publishes its slot, then counts down.
+ */
+static void* counter(void* arg) {
+    long id = *(long*)arg;
+    slots[id] = round_number;
+    latch_count_down(current);
+    return NULL;
+}
+
+/**
+ * Checks that every slot of this round is visible.
+ */
+static void check_slots(void) {
+    for (int i = 0; i < threads; i++) {
+        CHECK(slots[i] == round_number, "round %ld: slot %d holds %ld", round_number, i, slots[i]);
+    }
+}
+
+/**
+ * Extra waiter thread (even rounds): timed wait, then the slots.
+ */
+static void* waiter(void* arg) {
+    (void)arg;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += 60;
+    CHECK(latch_wait_until(current, &deadline) == 0, "round %ld: timed wait timed out", round_number);
+    check_slots();
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    long rounds = argc > 2 ? atol(argv[2]) : DEFAULT_ROUNDS;
+    slots = calloc(threads, sizeof(long));
+    pthread_t* tids = malloc(sizeof(pthread_t) * (threads + EXTRA_WAITERS));
+    long* ids = malloc(sizeof(long) * threads);
+
+    for (round_number = 1; round_number <= rounds; round_number++) {
+        current = malloc(sizeof(latch));
+        latch_init(current, threads);
+        int waiters = round_number % 2 == 0 ? EXTRA_WAITERS : 0;
+        for (int i = 0; i < waiters; i++) {
+            pthread_create(&tids[threads + i], NULL, waiter, NULL);
+        }
+        for (int i = 0; i < threads; i++) {
+            ids[i] = i;
+            pthread_create(&tids[i], NULL, counter, &ids[i]);
+        }
+        latch_wait(current);
+        check_slots();
+        if (waiters == 0) {
+            free(current); // Counters may still be inside latch_count_down.
+        }
+        for (int i = 0; i < threads + waiters; i++) {
+            pthread_join(tids[i], NULL);
+        }
+        if (waiters > 0) {
+            free(current);
+        }
+    }
+
+    latch never;
+    latch_init(&never, 1);
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += 10000000; // 10 ms.
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    CHECK(latch_wait_until(&never, &deadline) == -1, "wait on a closed latch returned");
+    CHECK(!latch_try_wait(&never), "closed latch reports open");
+    latch_count_down(&never);
+    CHECK(latch_try_wait(&never), "opened latch reports closed");
+
+    free(slots);
+    free(tids);
+    free(ids);
+    return stress_exit("stress_latch");
+}
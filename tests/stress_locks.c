@@ -0,0 +1,116 @@
+#include <limits.h>
+#include <stdlib.h>
+#include "stress.h"
+#include "ticket_lock.h"
+#include "tp_lock.h"
+#include "reactive_lock.h"
+
+#define DEFAULT_THREADS 8
+#define DEFAULT_OPS 20000L // Critical sections per thread and phase.
+
+/*
+ * Mutual exclusion of the ticket, time-published and reactive locks: every thread
+ * increments a plain counter and checks that nobody else is inside. The ticket lock runs
+ * a second time with its counters just short of INT_MAX, so they wrap mid-phase. The
+ * reactive lock runs a contended phase followed by a lightly contended one; with several
+ * CPUs the first switches it to RL_QUEUE and the second back, so both modes and both
+ * switches are covered (on one CPU waiters rarely find it held, and it stays in RL_TAS).
+ */
+
+#define LOCK_TICKET 0
+#define LOCK_TP 1
+#define LOCK_REACTIVE 2
+
+static ticket_lock ticket;
+static tp_lock tp;
+static reactive_lock reactive;
+static int lock_kind; // Lock under test.
+static long ops_per_thread;
+static int spread_out; // Reactive phase two: work outside the lock so it is rarely contended.
+static int work_inside = 1; // Other phases: work inside, so holders get preempted and waiters queue up.
+static long counter; // Plain: only ever touched under the lock.
+static atomic_int inside; // Threads in the critical section right now.
+
+/**
+ * Acquires the lock under test.
+ */
+static void lock(void) {
+    if (lock_kind == LOCK_TP) {
+        tp_lock_acquire(&tp);
+    } else if (lock_kind == LOCK_REACTIVE) {
+        reactive_lock_acquire(&reactive);
+    } else {
+        ticketlock_acquire(&ticket);
+    }
+}
+
+/**
+ * Releases the lock under test.
+ */
+static void unlock(void) {
+    if (lock_kind == LOCK_TP) {
+        tp_lock_release(&tp);
+    } else if (lock_kind == LOCK_REACTIVE) {
+        reactive_lock_release(&reactive);
+    } else {
+        ticketlock_release(&ticket);
+    }
+}
+
+/**
+ * Stress thread: locked increments, checking exclusion.
+ */
+static void* worker(void* arg) {
+    (void)arg;
+    for (long i = 0; i < ops_per_thread; i++) {
+        lock();
+        int others = atomic_fetch_add_explicit(&inside, 1, memory_order_relaxed);
+        CHECK(others == 0, "%d other threads inside the critical section", others);
+        counter++;
+        for (volatile int k = 0; k < work_inside * 50; k++) {
+        }
+        atomic_fetch_sub_explicit(&inside, 1, memory_order_relaxed);
+        unlock();
+        if (spread_out) {
+            for (volatile int k = 0; k < 200; k++) {
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Runs one phase and checks the final count.
+ */
+static void run(const char* name, int kind, int threads) {
+    lock_kind = kind;
+    counter = 0;
+    stress_run(threads, worker);
+    CHECK(counter == ops_per_thread * threads, "%s: counted %ld of %ld", name, counter, ops_per_thread * threads);
+}
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    ops_per_thread = argc > 2 ? atol(argv[2]) : DEFAULT_OPS;
+
+    ticketlock_init(&ticket);
+    run("ticket", LOCK_TICKET, threads);
+    ticketlock_init(&ticket);
+    atomic_store(&ticket.ticket, INT_MAX - 1000);
+    atomic_store(&ticket.cur_ticket, INT_MAX - 1000);
+    run("ticket across the wrap", LOCK_TICKET, threads);
+    tp_lock_init(&tp, 0);
+    run("tp", LOCK_TP, threads);
+
+    reactive_lock_init(&reactive);
+    run("reactive contended", LOCK_REACTIVE, threads);
+    spread_out = 1;
+    work_inside = 0;
+    run("reactive spread out", LOCK_REACTIVE, 2);
+    long tas_acquires, queue_acquires, switches;
+    reactive_lock_stats(&reactive, &tas_acquires, &queue_acquires, &switches);
+    printf("reactive: %ld TAS acquisitions, %ld queued acquisitions, %ld mode switches\n",
+           tas_acquires, queue_acquires, switches);
+    CHECK(tas_acquires + queue_acquires == ops_per_thread * (threads + 2), "reactive acquisitions don't add up");
+    return stress_exit("stress_locks");
+}
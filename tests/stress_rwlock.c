@@ -0,0 +1,85 @@
+#include <sched.h>
+#include <stdlib.h>
+#include "stress.h"
+#include "rw_lock.h"
+
+#define DEFAULT_THREADS 8
+#define DEFAULT_OPS 100000L // Lock acquisitions per thread.
+#define WRITE_EVERY 8 // One in WRITE_EVERY acquisitions is a write.
+
+/*
+ * Reader/writer exclusion of the task4 rwlock. Writers update two plain fields together
+ * and readers check they always see them equal; counters of the threads inside check that
+ * a writer is alone and that readers never overlap a writer. Every fourth acquisition of
+ * either kind goes through the try variants.
+ */
+
+static rwlock lock;
+static long ops_per_thread;
+static long first, second; // Plain: written together under the write lock.
+static long writes; // Plain: write-locked updates, checked at the end.
+static atomic_int readers_inside;
+static atomic_int writers_inside;
+
+/**
+ * Stress thread: a mix of reads and writes.
+ */
+static void* worker(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 0; i < ops_per_thread; i++) {
+        int use_try = (i + id) % 4 == 0;
+        if ((i + id) % WRITE_EVERY == 0) {
+            if (use_try) {
+                while (!rwlock_try_acquire_write(&lock)) {
+                    sched_yield();
+                }
+            } else {
+                rwlock_acquire_write(&lock);
+            }
+            int writers = atomic_fetch_add_explicit(&writers_inside, 1, memory_order_relaxed);
+            int readers = atomic_load_explicit(&readers_inside, memory_order_relaxed);
+            CHECK(writers == 0 && readers == 0, "writer with %d writers and %d readers inside", writers, readers);
+            first++;
+            second++;
+            writes++;
+            atomic_fetch_sub_explicit(&writers_inside, 1, memory_order_relaxed);
+            rwlock_release_write(&lock);
+        } else {
+            if (use_try) {
+                while (!rwlock_try_acquire_read(&lock)) {
+                    sched_yield();
+                }
+            } else {
+                rwlock_acquire_read(&lock);
+            }
+            atomic_fetch_add_explicit(&readers_inside, 1, memory_order_relaxed);
+            int writers = atomic_load_explicit(&writers_inside, memory_order_relaxed);
+            CHECK(writers == 0, "reader with %d writers inside", writers);
+            long a = first, b = second;
+            CHECK(a == b, "reader saw a torn update: %ld != %ld", a, b);
+            atomic_fetch_sub_explicit(&readers_inside, 1, memory_order_relaxed);
+            rwlock_release_read(&lock);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    ops_per_thread = argc > 2 ? atol(argv[2]) : DEFAULT_OPS;
+
+    rwlock_init(&lock);
+    stress_run(threads, worker);
+    long expected = 0;
+    for (long id = 0; id < threads; id++) {
+        for (long i = 0; i < ops_per_thread; i++) {
+            expected += (i + id) % WRITE_EVERY == 0;
+        }
+    }
+    CHECK(writes == expected && first == expected, "%ld writes, fields at %ld, expected %ld", writes, first, expected);
+    int fd = rwlock_event_fd(&lock);
+    CHECK(fd >= 0, "no eventfd");
+    rwlock_destroy(&lock);
+    CHECK(stress_fd_closed(fd), "rwlock_destroy left the eventfd open");
+    return stress_exit("stress_rwlock");
+}
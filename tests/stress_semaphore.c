@@ -0,0 +1,115 @@
+#include <sched.h>
+#include <stdlib.h>
+#include "stress.h"
+#ifdef STRESS_TAS_SEMAPHORE
+#include "tas_semaphore.h"
+#define SEMAPHORE_NAME "stress_tas_semaphore"
+#define SEMAPHORE_COUNTING 1
+#else
+#include "tl_semaphore.h"
+#define SEMAPHORE_NAME "stress_tl_semaphore"
+#define SEMAPHORE_COUNTING 0 // Serves tickets in order: a signal ends the signaller's own wait.
+#endif
+
+#define DEFAULT_THREADS 8
+#define DEFAULT_OPS 100000L // Waits per thread and phase.
+#define PERMITS 3 // Second phase: permits shared by all threads.
+
+/*
+ * Semaphore stress, built once against the task1 (TAS) and once against the task2
+ * (ticket) semaphore. Phase one uses it as a mutex around a plain counter, with a mix of
+ * waits and try_waits. The task2 semaphore admits one ticket at a time whatever its
+ * value, so only that phase applies to it. For the counting task1 semaphore, phase two
+ * checks that never more than PERMITS threads hold a permit, and a final ping-pong
+ * between two threads on two zero-permit semaphores fails (times out) if a signal can
+ * miss a sleeping waiter.
+ */
+
+static semaphore sem;
+static semaphore ping, pong;
+static long ops_per_thread;
+static int permits; // Permits in the phase being run.
+static long counter; // Plain: phase one only touches it holding the only permit.
+static atomic_int holders; // Threads holding a permit right now.
+static atomic_int most_holders; // Most holders seen at once.
+
+/**
+ * Stress thread: takes and returns permits, checking the bound.
+ */
+static void* worker(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 0; i < ops_per_thread; i++) {
+        if ((i + id) % 4 == 0) {
+            while (!semaphore_try_wait(&sem)) {
+                sched_yield();
+            }
+        } else {
+            semaphore_wait(&sem);
+        }
+        int now = atomic_fetch_add_explicit(&holders, 1, memory_order_relaxed) + 1;
+        CHECK(now <= permits, "%d holders of %d permits", now, permits);
+        int most = atomic_load_explicit(&most_holders, memory_order_relaxed);
+        while (now > most && !atomic_compare_exchange_weak_explicit(&most_holders, &most, now, memory_order_relaxed,
+                                                                    memory_order_relaxed)) {
+        }
+        if (permits == 1) {
+            counter++;
+        }
+        atomic_fetch_sub_explicit(&holders, 1, memory_order_relaxed);
+        semaphore_signal(&sem);
+    }
+    return NULL;
+}
+
+/**
+ * Ping-pong thread: id 0 signals ping and waits for pong, id 1 the other way round.
+ */
+static void* bouncer(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 0; i < ops_per_thread; i++) {
+        if (id == 0) {
+            semaphore_signal(&ping);
+            semaphore_wait(&pong);
+        } else {
+            semaphore_wait(&ping);
+            semaphore_signal(&pong);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    ops_per_thread = argc > 2 ? atol(argv[2]) : DEFAULT_OPS;
+
+    permits = 1;
+    semaphore_init(&sem, permits);
+    stress_run(threads, worker);
+    CHECK(counter == ops_per_thread * threads, "mutex phase: counted %ld of %ld", counter, ops_per_thread * threads);
+    int fd = semaphore_event_fd(&sem);
+    CHECK(fd >= 0, "no eventfd");
+    semaphore_destroy(&sem);
+    CHECK(stress_fd_closed(fd), "semaphore_destroy left the eventfd open");
+
+    if (!SEMAPHORE_COUNTING) {
+        return stress_exit(SEMAPHORE_NAME);
+    }
+    permits = PERMITS;
+    atomic_store(&most_holders, 0);
+    semaphore_init(&sem, permits);
+    stress_run(threads, worker);
+    printf("%d permits: at most %d holders at once\n", permits, atomic_load(&most_holders));
+    for (int i = 0; i < permits; i++) {
+        CHECK(semaphore_try_wait(&sem), "permit %d lost", i);
+    }
+    CHECK(!semaphore_try_wait(&sem), "more than %d permits", permits);
+    semaphore_destroy(&sem);
+
+    semaphore_init(&ping, 0);
+    semaphore_init(&pong, 0);
+    stress_run(2, bouncer);
+    CHECK(!semaphore_try_wait(&ping) && !semaphore_try_wait(&pong), "ping-pong left a permit behind");
+    semaphore_destroy(&ping);
+    semaphore_destroy(&pong);
+    return stress_exit(SEMAPHORE_NAME);
+}
@@ -0,0 +1,107 @@
+#include <sched.h>
+#include <stdlib.h>
+#include "stress.h"
+#include "token_semaphore.h"
+
+#define DEFAULT_THREADS 8
+#define DEFAULT_OPS 100000L // Waits per thread and phase.
+#define FEW_PERMITS 3 // Keeps the semaphore precise: below one batch per cache.
+#define MANY_PERMITS 256 // Lets permits sit in the per-CPU caches.
+#define SMALL_BATCH 2 // Many permits phase: refills and flushes often.
+
+/*
+ * token_semaphore stress. Phase one uses it as a mutex around a plain counter, phase two
+ * checks that never more than FEW_PERMITS threads hold a permit, and phase three runs
+ * with many permits and a small batch, so permits move between the pool and the caches
+ * (and, with several CPUs, get stolen) all the time. After each phase every permit must
+ * be recovered exactly by try_wait, wherever it ended up cached. Waits mix blocking and
+ * try_wait. A final ping-pong between two threads on two zero-permit semaphores fails
+ * (times out) if a signal can leave a permit cached while a waiter sleeps on the pool.
+ */
+
+static token_semaphore sem;
+static token_semaphore ping, pong;
+static long ops_per_thread;
+static int permits; // Permits in the phase being run.
+static long counter; // Plain: phase one only touches it holding the only permit.
+static atomic_int holders; // Threads holding a permit right now.
+static atomic_int most_holders; // Most holders seen at once.
+
+/**
+ * Stress thread: takes and returns permits, checking the bound.
+ */
+static void* worker(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 0; i < ops_per_thread; i++) {
+        if ((i + id) % 4 == 0) {
+            while (!token_semaphore_try_wait(&sem)) {
+                sched_yield();
+            }
+        } else {
+            token_semaphore_wait(&sem);
+        }
+        int now = atomic_fetch_add_explicit(&holders, 1, memory_order_relaxed) + 1;
+        CHECK(now <= permits, "%d holders of %d permits", now, permits);
+        int most = atomic_load_explicit(&most_holders, memory_order_relaxed);
+        while (now > most && !atomic_compare_exchange_weak_explicit(&most_holders, &most, now, memory_order_relaxed,
+                                                                    memory_order_relaxed)) {
+        }
+        if (permits == 1) {
+            counter++;
+        }
+        atomic_fetch_sub_explicit(&holders, 1, memory_order_relaxed);
+        token_semaphore_signal(&sem);
+    }
+    return NULL;
+}
+
+/**
+ * Ping-pong thread: id 0 signals ping and waits for pong, id 1 the other way round.
+ */
+static void* bouncer(void* arg) {
+    long id = *(long*)arg;
+    for (long i = 0; i < ops_per_thread; i++) {
+        if (id == 0) {
+            token_semaphore_signal(&ping);
+            token_semaphore_wait(&pong);
+        } else {
+            token_semaphore_wait(&ping);
+            token_semaphore_signal(&pong);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Runs the workers on a fresh semaphore and checks that exactly 'n' permits are left.
+ */
+static void run_phase(int threads, int n, int batch) {
+    permits = n;
+    atomic_store(&most_holders, 0);
+    token_semaphore_init(&sem, permits, batch);
+    stress_run(threads, worker);
+    long refills, flushes, steals;
+    token_semaphore_stats(&sem, &refills, &flushes, &steals);
+    printf("%d permits: at most %d holders at once; %ld refills, %ld flushes, %ld steals\n", permits,
+           atomic_load(&most_holders), refills, flushes, steals);
+    for (int i = 0; i < permits; i++) {
+        CHECK(token_semaphore_try_wait(&sem), "permit %d of %d lost", i, permits);
+    }
+    CHECK(!token_semaphore_try_wait(&sem), "more than %d permits", permits);
+}
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    ops_per_thread = argc > 2 ? atol(argv[2]) : DEFAULT_OPS;
+
+    run_phase(threads, 1, 0);
+    CHECK(counter == ops_per_thread * threads, "mutex phase: counted %ld of %ld", counter, ops_per_thread * threads);
+    run_phase(threads, FEW_PERMITS, 0);
+    run_phase(threads, MANY_PERMITS, SMALL_BATCH);
+
+    token_semaphore_init(&ping, 0, 0);
+    token_semaphore_init(&pong, 0, 0);
+    stress_run(2, bouncer);
+    CHECK(!token_semaphore_try_wait(&ping) && !token_semaphore_try_wait(&pong), "ping-pong left a permit behind");
+    return stress_exit("stress_token_semaphore");
+}